@@ -30,7 +30,6 @@
 #include <signal.h>
 #include <string.h>
 #include <sys/types.h>
-#include <sys/select.h>
 #include <sys/stat.h>
 
 #include <GL/gl.h>
@@ -39,16 +38,104 @@
 #include <pthread.h>
 #include <math.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 //
 // structures and functions to setup the programmable pipeline
 //
 #include "inogl.h"
 
+//
+// the lock-free handoff of the scene from the producer thread
+//
+#include "inthreads.h"
+
 //
 // hard-including some convenience functions that create a sphere
 //
 #include "axissphere.c"
 
+//
+// sizing of the paged tiles: the memory of the stream buffer that holds the
+// resident tiles, and the number of tiles on their way at a time
+//
+#define GRID_BUDGET      (96*1024*1024)
+#define GRID_INFLIGHT    8      // tiles in the producer's pipeline
+#define GRID_UPLOADERS   2      // worker contexts that upload tiles
+#define GRID_MAX_LAYERS  64     // cap on heightfield tiles (tiny in memory)
+#define GRID_MAX_INVAL   64     // invalidated tiles that can be pending
+#ifndef GRID_HFIELD
+#define GRID_HFIELD      1      // tiles are heights in layers of a texture
+#endif                          // (0: their vertices are in the stream ring)
+
+//
+// events that wake the scene producer
+//
+#define GRID_EV_VIEW     0x01   // the viewer moved
+#define GRID_EV_TILE     0x02   // a tile finished a stage, or one is free
+#define GRID_EV_ALL      0x04   // all resident tiles are to be made again
+
+//
+// cache of the levels of the sphere; it is mapped at start-up when it was
+// made from the same sizing and by the same generator, and it is (re)written
+// otherwise (bump the version when the generator changes what it makes)
+//
+#define SPHERE_CACHE     "sphere_lods.inm"
+#define SPHERE_CACHE_VERSION  2
+
+//
+// a descriptor of the dynamic scene; the producer fills one and publishes it,
+// and the renderer draws from the newest one (there are three of these)
+//
+
+struct my_scene {
+   int *rgn;          // stream region of each page; -1 if there is none
+};
+
+//
+// the position of the viewer in tile units; the renderer publishes it every
+// frame and the producer requests tiles around the newest one
+//
+
+struct my_view {
+   GLfloat cx, cy;
+};
+
+//
+// a function giving the heights of the tiles' surface at "n" nodes along a
+// row; the tile generator calls it once per row of nodes
+//
+
+typedef void (*tile_height_f)( int n, const float *x, float y, float *h );
+
+//
+// a task of generating one level of detail of a tile into memory
+//
+
+struct my_tile_job {
+   struct my_tile* t;
+   int lod;
+};
+
+//
+// a tile on its way through the stages of the scene producer
+//
+
+struct my_tile {
+   struct my_payload* p;
+   int tx, ty;
+   int ipage;          // page of the tile cache it goes into
+   unsigned int seq;   // the page's sequence number when it was taken
+   int ir;             // its stream region (or layer); -1 until it has one
+   GLfloat* scratch;   // its own memory (if the workers cannot map regions)
+   GLfloat* vdata;     // where the tile's levels go
+   int njobs;          // generation jobs still running (accessed atomically)
+   struct my_tile_job jobs[INOGL_MAX_LOD];
+   struct inogl_upload_s up;
+};
+
 //
 // a struct to allow us to access everything we need to draw and threading
 //
@@ -57,25 +144,69 @@ struct my_payload {
    pthread_t tid;
    pthread_attr_t tattr;
 // pthread_mutex_t mtx;
-   int pipefd[2];
 
    Display *xdisplay;
    Window xwindow;
    GLXWindow glxwin;
    GLXContext glxc;    // handle for the _rendering_ GL context; not the builder
-   int iuse, ichg;     // flow control of scene handle to use when rendering
-   GLuint *grid_VAO[2];   // the two VAO sets; alternating use in render/build
-   GLuint *grid_VBO[2];   // the two VBO sets; alternating use in render/build
-   unsigned char *bstat[2];  // status of the sets
-   GLfloat *grid_vdata;   // single array of a tile's grid data; temp storage
+   struct my_scene scene[3];      // triple-buffered scene descriptors
+   struct in_triple_s scene_tb;   // lock-free exchange of the descriptors
+   struct my_view view[3];        // triple-buffered viewer positions
+   struct in_triple_s view_tb;    // lock-free exchange of the positions
+   struct inogl_pager_s pager;    // producer: resident tiles and requests
+   int grid_pages;                // size of the tile cache
+   GLfloat grid_radius;           // tiles this close to the viewer are wanted
+   int *live_rgn, *seen_rgn;      // producer: last published; last seen by renderer
+   int *pend_rgn, *draw_rgn;      // renderer: newest published; being drawn
+   int *grid_rtx, *grid_rty;      // coordinates of the tile in each region
+   struct inogl_handoff_s *grid_hoff;   // fenced uploads; one per stream region
+   struct inogl_resmgr_s res;     // GL resources retired by either thread
+   int res_draw, res_make;        // their contexts: renderer and producer
+   struct in_pool_s pool;         // workers that generate the tiles
+   struct inogl_uploader_s uploader;    // worker contexts uploading the tiles
+   struct my_tile grid_tile[GRID_INFLIGHT];   // tiles in the pipeline
+   struct in_queue_s q_free, q_made, q_sent;  // free; generated; uploaded
+   unsigned int *grid_pseq;       // producer: sequence number of each page
+   int stage_gen, stage_up;       // producer: tiles generating; uploading
+   double stage_sum[4];           // producer: occupancy of the stages
+   int stage_samples;
+   struct in_events_s grid_ev;    // work posted for the producer
+   long *grid_inval;              // producer: invalidated tiles still pending
+   int num_inval;
+   GLfloat view_last[2];          // renderer: the last position posted
+   struct inogl_stream_s grid_stream;   // all tiles' vertex data lives in here
+   GLuint grid_VAO;       // single VAO to draw tiles from the stream buffer
+                          // (or the shared grid of heightfield tiles)
+   int grid_hfield;       // tiles are heightfields in layers of a texture
+   struct inogl_texpool_s grid_tex;   // the heights of all heightfield tiles
+   GLuint grid_nodeVBO;   // the shared grid (node indices) of heightfields
+   GLuint grid_infoVBO;   // tile and layer of each heightfield draw
+   GLint grid_infoLoc;    // (their attribute; one per instance)
+   int *grid_tlod;        // renderer: level each page is drawn at, or -1
+   GLint *grid_info;      // renderer: the tiles drawn, sorted by level
+   struct inogl_shader_s hprg;        // program drawing heightfield tiles
    int im, jm, grid_vertex_count;   // tile sizing
+   int grid_nlod;                   // levels of detail of the tiles
+   int grid_vertex_total;           // vertices of all levels of a tile
+   tile_height_f grid_height;       // the surface of the tiles
+   int grid_lod_first[INOGL_MAX_LOD], grid_lod_count[INOGL_MAX_LOD];
+   struct inogl_lod_s *grid_lod;    // level selection of each page
 
    struct inogl_s ogl;
    struct inogl_grp_s *groups;
    struct inogl_shader_s prg;
-
-   void* obj;
-   int num_groups;
+   struct inogl_shader_s pprg;   // program drawing procedural shapes
+   struct inogl_proc_s proc;     // (and what its draws need)
+   int num_glyphs;               // spheres drawn procedurally, on a lattice
+   struct inogl_batch_s tiles;   // draws of the tile grid; one call per frame
+   struct inogl_cull_s cull;     // bounds of the groups and tiles to be culled
+
+   struct inogl_obj_s obj;       // objects of the scene (drawing the groups)
+   int num_objs;
+   int spin_obj;                 // an object that turns (with its subtree)
+   int num_lods;                 // levels of detail of the groups
+   struct inogl_mesh_s mesh;     // the cache the levels came from (if any)
+   struct inogl_lod_s *glod;     // level selection of each object
 
    GLuint VAO, VBO;
    GLfloat* vdata;
@@ -202,11 +333,118 @@ void main() {
    vec4 viewPos = view * model * vec4(tPos, 1.0);
    gl_Position = projection * viewPos;
    vec3 lightDirection = normalize( lightPos - tPos );
-   float d = max( dot( inNormal, lightDirection ), 0.0 );
+   vec3 tNormal = normalize( vtxRot * inNormal );
+   float d = max( dot( tNormal, lightDirection ), 0.0 );
    vertexColor = d * inColor;
 }
 )glsl";
 
+// The vertex shader of heightfield tiles; it is used with the fragment shader
+// below. Its attributes are the (i,j) index of a node of the finest level, and
+// the origin and texture layer of the tile (per instance). The node's height
+// comes from the layer, the normal is made from the heights of the neighbours
+// (one-sided at the edges of the tile), and the color is fixed.
+
+const GLchar* hfieldShaderSource130 = R"glsl(
+#version 130
+#pragma optimize(off)
+uniform mat4 model; // Modelview matrix
+uniform mat4 view; // View matrix
+uniform mat4 projection; // Projection matrix
+uniform vec3 vtxTrans; // a matrix used to translate wrt the viewer
+uniform vec3 lightPos; // the 3D position of the single light in the scene
+uniform sampler2DArray heights; // a layer of heights per tile
+uniform ivec2 tileNodes; // nodes of the finest level along each direction
+in vec2 inPosition;
+in ivec3 tileInfo; // tile coordinates and layer (one per instance)
+out vec4 vertexColor;
+float height( ivec2 n ) {
+   return texelFetch( heights, ivec3( n, tileInfo.z ), 0 ).r;
+}
+void main() {
+   ivec2 node = ivec2( inPosition );
+   vec2 d = 1.0 / vec2( tileNodes - 1 );
+   vec3 pos = vec3( vec2( tileInfo.xy ) + vec2( node ) * d, height( node ) );
+   ivec2 n0 = max( node - 1, 0 );
+   ivec2 n1 = min( node + 1, tileNodes - 1 );
+   float dhx = ( height( ivec2( n1.x, node.y ) ) -
+                 height( ivec2( n0.x, node.y ) ) ) / ( float( n1.x - n0.x ) * d.x );
+   float dhy = ( height( ivec2( node.x, n1.y ) ) -
+                 height( ivec2( node.x, n0.y ) ) ) / ( float( n1.y - n0.y ) * d.y );
+   vec3 normal = normalize( vec3( -dhx, -dhy, 1.0 ) );
+   vec3 tPos = vtxTrans + pos;
+   vec4 viewPos = view * model * vec4(tPos, 1.0);
+   gl_Position = projection * viewPos;
+   vec3 lightDirection = normalize( lightPos - tPos );
+   float l = max( dot( normal, lightDirection ), 0.0 );
+   vertexColor = l * vec4( 0.5, 0.5, 0.8, 1.0 );
+}
+)glsl";
+
+// The vertex shader of procedural shapes (see "inogl.h"); it is used with
+// the fragment shader below and it has no attributes. Every vertex is a
+// corner of a quad of a copy of the shape, which are all found from the
+// vertex index; the sphere is the axis sphere (its corners are taken in the
+// order of the triangles of its indexed shells) and the grid is a flat tile.
+
+const GLchar* procShaderSource130 = R"glsl(
+#version 130
+#pragma optimize(off)
+uniform mat4 model; // Modelview matrix
+uniform mat4 view; // View matrix
+uniform mat4 projection; // Projection matrix
+uniform vec3 lightPos; // the 3D position of the single light in the scene
+uniform ivec2 procNodes; // nodes of the shape in the i and j directions
+uniform int procShape; // 1 for spheres, 2 for grids
+uniform ivec2 procInst; // copies per row of the lattice, and the first copy
+uniform vec4 procStep; // spacing of the lattice, and the size of the shape
+uniform mat4 procXform; // placement of the lattice
+out vec4 vertexColor;
+const int sphi[6] = int[6]( 0, 1, 1, 0, 1, 0 );
+const int sphj[6] = int[6]( 1, 0, 1, 0, 0, 1 );
+const int grdi[6] = int[6]( 0, 1, 0, 0, 1, 1 );
+const int grdj[6] = int[6]( 0, 0, 1, 1, 0, 1 );
+void main() {
+   int nqi = procNodes.x - 1;
+   int nq = nqi * ( procNodes.y - 1 );
+   int q = gl_VertexID / 6;
+   int c = gl_VertexID - 6*q;
+   int inst = q / nq;
+   q -= inst * nq;
+   inst += procInst.y;
+   int row = inst / procInst.x;
+   vec3 centre = procStep.xyz * vec3( float( inst - row*procInst.x ),
+                                      float( row ), 0.0 );
+   float ksi, eta;
+   vec3 pos, normal;
+   vec4 color;
+   if( procShape == 1 ) {
+      ksi = float( q - nqi*(q/nqi) + sphi[c] ) / float( procNodes.x - 1 );
+      eta = float( q/nqi + sphj[c] ) / float( procNodes.y - 1 );
+      float angle = 6.28318530718 * ksi;
+      float azimuth = 3.14159265359 * ( 1.0 - eta );
+      normal = vec3( cos( angle ) * sin( azimuth ), cos( azimuth ),
+                     sin( angle ) * sin( azimuth ) );
+      pos = centre + procStep.w * normal;
+      color = vec4( sin( azimuth ) * sin( azimuth ), sin( 2.0 * azimuth ),
+                    cos( azimuth ) * cos( azimuth ), 1.0 );
+   } else {
+      ksi = float( q - nqi*(q/nqi) + grdi[c] ) / float( procNodes.x - 1 );
+      eta = float( q/nqi + grdj[c] ) / float( procNodes.y - 1 );
+      normal = vec3( 0.0, 0.0, 1.0 );
+      pos = centre + procStep.w * vec3( ksi, eta, 0.0 );
+      color = vec4( 0.5, 0.5, 0.8, 1.0 );
+   }
+   vec4 tPos = procXform * vec4( pos, 1.0 );
+   vec3 tNormal = normalize( mat3( procXform ) * normal );
+   vec4 viewPos = view * model * tPos;
+   gl_Position = projection * viewPos;
+   vec3 lightDirection = normalize( lightPos - tPos.xyz );
+   float d = max( dot( tNormal, lightDirection ), 0.0 );
+   vertexColor = d * color;
+}
+)glsl";
+
 // Uniform variable names need to be consistent here as well
 
 const GLchar* fragmentShaderSource130 = R"glsl(
@@ -248,77 +486,105 @@ void main() {
 void prog_init( void* arg )
 {
    printf("================== INITIALIZING ======================= \n");
+   //---- query what the OpenGL context can do
+   inoglCapabilities( &( payload.ogl ) );
+
    // items related to threading
    init_threads( arg );
 
-   // some structures to create a vertex data array
-   int imm=40,jmm=20;
-   float* tmp;
-   int ierr=inMakeAxisSphereshell3( imm, jmm, &tmp );
-   payload.num_groups = 6;  // increase this to repeat the object in the scene
+   // some structures to create vertex data arrays; the sphere is made at a
+   // few resolutions (finest first) and is drawn based on its size on screen;
+   // it is made of shared vertices and a triangle strip per band of quads,
+   // with the bands joined by primitive restart when the GL has it
+   int imm[3]={40,24,12}, jmm[3]={20,12,6};
+   GLuint restart = payload.ogl.hasPrimitiveRestart ? 0xffffffffu : 0;
+   payload.num_lods = 3;
+   payload.num_objs = 6;  // increase this to repeat the object in the scene
    payload.groups = (struct inogl_grp_s*)
-               malloc( ((size_t) payload.num_groups) *
+               malloc( ((size_t) payload.num_lods) *
                                                sizeof( struct inogl_grp_s ) );
-   for(short n=0;n<payload.num_groups;++n) {
-      payload.groups[n].VAO = 0; // NO NEED
-      payload.groups[n].VBO = 0; // NO NEED
-      // to understand the following, you need to look into the code...
-      int tri_count = 2*(imm-1)*(jmm-3) + (imm-1) + (imm-1);
-          tri_count -= 0;  // use this to subtract triangles from the sphere
-                           // to see their rendering order...
-      payload.groups[n].vertex_count = 3 * tri_count;
-      payload.groups[n].vdata = (GLfloat*) tmp;
+   payload.glod = (struct inogl_lod_s*)
+               malloc( ((size_t) payload.num_objs) *
+                                               sizeof( struct inogl_lod_s ) );
+   uint64_t tag = (uint64_t) SPHERE_CACHE_VERSION;
+   tag = tag * 131 + (uint64_t) restart;
+   for(short l=0;l<payload.num_lods;++l) {
+      tag = tag * 131 + (uint64_t) imm[l];
+      tag = tag * 131 + (uint64_t) jmm[l];
+   }
+   if( inoglMeshMap( &( payload.mesh ), SPHERE_CACHE, tag ) == 0 &&
+       payload.mesh.num_groups != payload.num_lods ) {
+      inoglMeshUnmap( &( payload.mesh ) );
+   }
+   for(short l=0;l<payload.num_lods;++l) {
+      if( payload.mesh.grps != NULL ) {
+         payload.groups[l] = payload.mesh.grps[l];
+         continue;
+      }
+      struct in_shell_s sh;
+      (void) inMakeAxisSphereStrips( imm[l], jmm[l], &sh, restart, 0 );
+      struct inogl_grp_s* gp = &( payload.groups[l] );
+      inoglGroupInit( gp );
+      gp->VAO = 0; // NO NEED
+      gp->VBO = 0; // NO NEED
+      // the order in the array is: position, normal, texel, color
+      gp->nglm = sh.nglm;
+      for(int k=0;k<4;++k) gp->moff[k] = sh.moff[k];
+      gp->exist = 0x0f;
+      // one vertex per node, and the strips index them
+      gp->vertex_count = (int) sh.nv;
+      gp->first = 0;
+      gp->vdata = (GLfloat*) sh.x;
+      gp->mode = GL_TRIANGLE_STRIP;
+      gp->EBO = 0; // NO NEED
+      gp->index_count = (int) sh.ni;
+          gp->index_count -= 0;  // use this to subtract indices from the
+                                 // strips to see their rendering order...
+      gp->ifirst = 0;
+      gp->restart = restart;
+      gp->idata = (GLuint*) sh.ie;  // (in the same allocation as the vertices)
+   }
+   if( payload.mesh.grps == NULL ) {
+      (void) inoglMeshSave( SPHERE_CACHE, tag,
+                            payload.num_lods, payload.groups );
    }
 
    //---- setting up the OpenGL rendering "programmable pipeline"
-   inoglCapabilities( &( payload.ogl ) );
-
    inoglMakeProgram1( &( payload.prg ),
                       vertexShaderSource130, fragmentShaderSource130 );
+   if( payload.grid_hfield ) {
+      inoglMakeProgram1( &( payload.hprg ),
+                         hfieldShaderSource130, fragmentShaderSource130 );
+      (void) setNodeAttribs( &payload, payload.hprg.shaderProgram );
+   }
+   payload.num_glyphs = 32*32;  // (glyphs have no vertex data at all)
+   if( inoglMakeProgram1( &( payload.pprg ),
+                          procShaderSource130, fragmentShaderSource130 ) ||
+       inoglProcInit( &( payload.proc ), payload.pprg.shaderProgram ) ) {
+      payload.num_glyphs = 0;
+   }
 
 
    // construction of some fixed objects to draw with the programmable pipeline
-   for(short n=0;n<payload.num_groups;++n) {
-      struct inogl_grp_s* gp = &( payload.groups[n] );
+   // (all levels are placed in a single VBO and are wrapped by a single VAO,
+   // and all objects draw from those same levels); every object is placed
+   // relative to the one before it, so the objects make a chain of transforms
+   inoglMakeGroupsSharedVAOVBO( payload.num_lods, payload.groups );
+   inoglObjInit( &( payload.obj ), payload.num_objs );
+   for(int n=0,h=-1;n<payload.num_objs;++n) {
+      GLfloat step[3] = { 1.5f, 0.5f, 1.5f };
+      h = inoglObjAdd( &( payload.obj ), h, &( payload.groups[0] ) );
+      inoglObjPlace( &( payload.obj ), h, step, NULL );
+      inoglLodInit( &( payload.glod[h] ), payload.num_lods, 200.0f, 0.2f );
+   }
+   payload.spin_obj = payload.num_objs / 2;
 
-      // create vertex buffer object...
-      glGenVertexArrays( 1, &( gp->VAO ) );   // later delete with glDelete...()
-      glBindVertexArray( gp->VAO );
+   // a batch for drawing the tiles of the grid with multi-draw calls
+   inoglBatchInit( &( payload.tiles ), GL_TRIANGLES, 0, payload.grid_pages,
+                   &( payload.ogl ) );
 
-      glGenBuffers( 1, &( gp->VBO ) );   // later delete with glDelete...()
-      glBindBuffer( GL_ARRAY_BUFFER, gp->VBO );
-
-      // The order here is how they appear in my OBJ reader's returned data.
-      // The actual position index is dictated by the first argument.
-      GLsizei nglb = 3 + 3 + 2 + 4;
-      glBufferData( GL_ARRAY_BUFFER,
-                    ((size_t) gp->vertex_count) * nglb * sizeof(float),
-                    gp->vdata, GL_STATIC_DRAW);
-
-      glVertexAttribPointer( aPosition, 3, GL_FLOAT, GL_FALSE,
-                             nglb * sizeof(float),
-                             (void*)0);
-      glEnableVertexAttribArray( aPosition );
-
-      glVertexAttribPointer( aNormal, 3, GL_FLOAT, GL_FALSE,
-                             nglb * sizeof(float),
-                             (void*)(3 * sizeof(float)));
-      glEnableVertexAttribArray( aNormal );
-
-      glVertexAttribPointer( aTexel, 2, GL_FLOAT, GL_FALSE,
-                             nglb * sizeof(float),
-                             (void*)(6 * sizeof(float)));
-      glEnableVertexAttribArray( aTexel );
-
-      glVertexAttribPointer( aColor, 4, GL_FLOAT, GL_FALSE,
-                             nglb * sizeof(float),
-                             (void*)(8 * sizeof(float)));
-      glEnableVertexAttribArray( aColor );
-
-      // unbind VBO and VAO
-      glBindBuffer( GL_ARRAY_BUFFER, 0 );
-      glBindVertexArray(0);
-   }
+   // a list of bounding volumes of all groups and the pages of tiles
+   inoglCullInit( &( payload.cull ), payload.num_objs + payload.grid_pages );
 
    // make an intuitive object (3 triangles)
    createTriangleVAO( &( payload.VAO ), &( payload.VBO ),
@@ -330,7 +596,8 @@ void prog_init( void* arg )
 // the VAO is made here and is held permanently for this (extra) tile
   payload.vdata2 = (GLfloat*) malloc( sizeof(float) *
                            ((size_t) (12 * 2*3 * payload.im * payload.jm)) );
-  makeTileData( payload.vdata2, payload.im, payload.jm, 4 );
+  makeTileData( payload.vdata2, payload.im, payload.jm, 0, 0,
+                payload.grid_height );
   makeVBO( &(payload.VBO2 ), payload.grid_vertex_count, payload.vdata2 );
   makeVAO( &(payload.VAO2), payload.VBO2 );
 #endif
@@ -477,20 +744,145 @@ static GLfloat t = 0.0; t += 0.05*0.0;  // can move the light around
 
 // inoglDisplayUniforms( prg->shaderProgram );
 
+   // ----- deal with threading 1 -----
+   // the viewer's position in tile units goes to the producer; the modelview
+   // is a rigid motion, so the eye is at minus the transposed rotation times
+   // the translation (tiles are drawn shifted; see the tile drawing below)
+   struct my_view* view = (struct my_view*)
+                          inTripleWriteSlot( &( payload.view_tb ) );
+   view->cx = -( Mmatrix[0]*Mmatrix[12] + Mmatrix[1]*Mmatrix[13] +
+                 Mmatrix[2]*Mmatrix[14] ) + 0.5f;
+   view->cy = -( Mmatrix[4]*Mmatrix[12] + Mmatrix[5]*Mmatrix[13] +
+                 Mmatrix[6]*Mmatrix[14] ) + 0.5f;
+   (void) inTriplePublish( &( payload.view_tb ) );
+   if( view->cx != payload.view_last[0] || view->cy != payload.view_last[1] ) {
+      payload.view_last[0] = view->cx;
+      payload.view_last[1] = view->cy;
+      inEventsPost( &( payload.grid_ev ), GRID_EV_VIEW );
+   }
+
+   // take the newest scene the producer has published (this never blocks)
+   int inew;
+   struct my_scene* scene = (struct my_scene*)
+                            inTripleAcquire( &( payload.scene_tb ), &inew );
+   for(int n=0;n<payload.grid_pages;++n) {      // sweep over pages
+      int* pend = &( payload.pend_rgn[n] );
+      int* draw = &( payload.draw_rgn[n] );
+      if( inew && scene->rgn[n] != *pend ) {
+         // a newer region supersedes one that was never drawn
+         if( *pend != *draw ) {
+            releaseTile( &payload, *pend, payload.res_draw );
+         }
+         *pend = scene->rgn[n];
+      }
+      // switch once the upload has completed (this does not block); tiles
+      // that are being replaced are kept until then
+      if( *pend != *draw ) {
+         if( *pend < 0 ||
+             inoglHandoffReady( &( payload.grid_hoff[ *pend ] ), 0 ) ) {
+#ifdef _DEBUG_
+  printf(" ==<<<<<=== DRAWING stream region %d in page %d ======== \n",*pend,n);
+#endif
+            releaseTile( &payload, *draw, payload.res_draw );
+            *draw = *pend;
+         }
+      }
+   }
+
+   //----- moving objects -----
+   // (only the objects that moved, and what hangs from them, are updated)
+static GLfloat spin = 0.0; spin += 0.02*0.0;  // can turn a part of the chain
+   GLfloat step[3] = { 1.5f, 0.5f, 1.5f };
+   GLfloat turn[9] = { cosf( spin ), sinf( spin ), 0.0f,
+                      -sinf( spin ), cosf( spin ), 0.0f,
+                       0.0f, 0.0f, 1.0f };
+   if( spin != 0.0f ) {
+      inoglObjPlace( &( payload.obj ), payload.spin_obj, step, turn );
+   }
+   (void) inoglObjUpdate( &( payload.obj ) );
+
+   //----- culling -----
+   // (the view matrix is the identity, so the clip matrix is P times M; the
+   // objects' bounds are already in world space and in the order of slots)
+   GLfloat Cmatrix[16], planes[24];
+   inoglMatMul4( Cmatrix, Pmatrix, Mmatrix );
+   inoglFrustumPlanes( planes, Cmatrix );
+
+   struct inogl_cull_s* cull = &( payload.cull );
+   inoglObjCull( &( payload.obj ), cull, 0 );
+   for(int n=0;n<payload.grid_pages;++n) {
+      GLfloat bmin[3], bmax[3], bsph[4];
+      GLfloat shift[3] = { -0.5f, -0.5f, -1.2f };    // see tile drawing below
+      int ir = payload.draw_rgn[n];
+      if( ir >= 0 ) {
+         tileBounds( payload.grid_rtx[ir], payload.grid_rty[ir],
+                     bmin, bmax, bsph );
+      } else {
+         for(int i=0;i<3;++i) { bmin[i] = 0.0f; bmax[i] = 0.0f; }
+         for(int i=0;i<4;++i) bsph[i] = 0.0f;
+      }
+      inoglCullSet( cull, payload.num_objs + n, bmin, bmax, bsph, shift );
+   }
+   (void) inoglCullRun( cull, planes );
+
+   // the viewport's height is needed to get sizes on screen for picking LODs
+   GLint viewport[4];
+   glGetIntegerv( GL_VIEWPORT, viewport );
+   GLfloat height = (GLfloat) viewport[3];
+
    //----- drawing -----
-   vals[0] = 0.0f; vals[1] = 0.0f; vals[2] = 0.0f;
-   for(int n=0;n<payload.num_groups;++n) {
-      struct inogl_grp_s* gp = &( payload.groups[n] );
+   struct inogl_obj_s* obj = &( payload.obj );
+   for(int s=0;s<obj->num;++s) {
+      const struct inogl_grp_s* gp = obj->grp[s];
+      if( gp == NULL ) continue;                 // draws nothing
+      if( !cull->visible[s] ) continue;          // outside of the view
+      // pick the level of detail from the bounds in world space
+      GLfloat bsph[4] = { obj->cx[s], obj->cy[s], obj->cz[s], obj->r[s] };
+      GLfloat size = inoglProjectedSize( Mmatrix, Pmatrix, height,
+                                         bsph, NULL );
+      gp += inoglLodSelect( &( payload.glod[ obj->handle[s] ] ), size );
+      // place the object with its world transform
+      const GLfloat* w = &( obj->world[16*s] );
+      for(int j=0;j<3;++j) {
+         for(int i=0;i<3;++i) Rmatrix[j*3+i] = w[j*4+i];
+      }
+      glUniformMatrix3fv( rotLoc, 1, GL_FALSE, Rmatrix );
+      glUniform3f( transLoc, w[12], w[13], w[14] );
       glBindVertexArray( gp->VAO );
-      // move the object around
-      vals[0] += 1.5f; vals[1] += 0.5f; vals[2] += 1.5f;
-      glUniform3f( transLoc, vals[0], vals[1], vals[2] );
-      // this call takes vertices but drawstriangles in groups of 3
-      glDrawArrays( GL_TRIANGLES, 0, gp->vertex_count );
+      // this call draws the strips of the level from its indices
+      inoglDrawGroup( gp );
       glBindVertexArray(0);
    }
 
+   // glyph spheres on a lattice, made entirely in the vertex shader
+   if( payload.num_glyphs > 0 ) {
+      GLuint pp = payload.pprg.shaderProgram;
+      GLfloat step[3] = { 0.15f, 0.15f, 0.0f };
+      GLfloat xform[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                            0.0f, 1.0f, 0.0f, 0.0f,
+                            0.0f, 0.0f, 1.0f, 0.0f,
+                           -2.5f,-2.5f, 0.5f, 1.0f };
+      glUseProgram( pp );
+      glUniformMatrix4fv( glGetUniformLocation( pp, "model" ),
+                          1, GL_FALSE, Mmatrix );
+      glUniformMatrix4fv( glGetUniformLocation( pp, "view" ),
+                          1, GL_FALSE, Vmatrix );
+      glUniformMatrix4fv( glGetUniformLocation( pp, "projection" ),
+                          1, GL_FALSE, Pmatrix );
+      glUniform3f( glGetUniformLocation( pp, "lightPos" ),
+                   move[0], move[1], move[2] );
+      glUniform4f( glGetUniformLocation( pp, "uniColor" ),
+                   1.0f, 1.0f, 1.0f, 1.0f );
+      glUniform4f( glGetUniformLocation( pp, "ambColor" ),
+                   0.91f, 0.91f, 0.91f, 1.0f );
+      inoglProcDraw( &( payload.proc ), INOGL_PROC_SPHERE, 12, 7, 0.05f,
+                     payload.num_glyphs, 32, step, xform );
+      glUseProgram( prg->shaderProgram );
+   }
+
    glUniform3f( transLoc, 0.0f, 0.0f, 0.0f );   // return to datum
+   for(int i=0;i<9;++i) Rmatrix[i] = ( i % 4 == 0 ? 1.0f : 0.0f );
+   glUniformMatrix3fv( rotLoc, 1, GL_FALSE, Rmatrix );
    glBindVertexArray( payload.VAO );
    glDrawArrays( GL_TRIANGLES, 0, payload.vertex_count );
    glBindVertexArray(0);
@@ -503,42 +895,76 @@ static GLfloat t = 0.0; t += 0.05*0.0;  // can move the light around
 
    glUniform3f( transLoc,-0.5f,-0.5f,-1.2f );   // move away
 
-   // ----- deal with threading 1 -----
-   int iuse = payload.iuse, iswap=0;
-   if( iuse != payload.ichg ) {
-      payload.iuse = payload.ichg;
-      iuse = payload.iuse;
-      iswap=1;
+   int nlev[INOGL_MAX_LOD] = { 0 };
+   if( payload.grid_hfield ) {
+      // heightfield tiles have their own program, with the same view, light
+      // and colors, and are drawn by level after they are all picked
+      GLuint hp = payload.hprg.shaderProgram;
+      glUseProgram( hp );
+      glUniformMatrix4fv( glGetUniformLocation( hp, "model" ),
+                          1, GL_FALSE, Mmatrix );
+      glUniformMatrix4fv( glGetUniformLocation( hp, "view" ),
+                          1, GL_FALSE, Vmatrix );
+      glUniformMatrix4fv( glGetUniformLocation( hp, "projection" ),
+                          1, GL_FALSE, Pmatrix );
+      glUniform3f( glGetUniformLocation( hp, "lightPos" ),
+                   move[0], move[1], move[2] );
+      glUniform4f( glGetUniformLocation( hp, "uniColor" ),
+                   1.0f, 1.0f, 1.0f, 1.0f );
+      glUniform4f( glGetUniformLocation( hp, "ambColor" ),
+                   0.91f, 0.91f, 0.91f, 1.0f );
+      glUniform3f( glGetUniformLocation( hp, "vtxTrans" ),
+                   -0.5f, -0.5f, -1.2f );
+      glUniform1i( glGetUniformLocation( hp, "heights" ), 0 );
+      glUniform2i( glGetUniformLocation( hp, "tileNodes" ),
+                   payload.im, payload.jm );
+      glActiveTexture( GL_TEXTURE0 );
+      glBindTexture( GL_TEXTURE_2D_ARRAY, payload.grid_tex.tex );
+      glBindVertexArray( payload.grid_VAO );
+   } else {
+      inoglBatchReset( &( payload.tiles ) );
    }
-
-   unsigned char* bstat = payload.bstat[ iuse ];
-   GLuint* grid_VAO = payload.grid_VAO[ iuse ];
-   GLuint* grid_VBO = payload.grid_VBO[ iuse ];
-   for(int n=0;n<9;++n) {                       // sweep over tile slots
-      if( bstat[n] == 1 ) {                     // flagged for creating new VAO
-  printf(" ==<<<<<=== BUILDING Vertex Attrib Obj %d -> %d ======== \n",n,grid_VBO[n]);//HACK
-         makeVAO( &(grid_VAO[n]), grid_VBO[n] );
-//printf("Array: %d   Buffer: %d \n", grid_VAO[n], grid_VBO[n] );//HACK
-         bstat[n] = 2;                          // flag as "render this"
-      } else if( bstat[n] == 4 ) {              // flagged for deleting
-  printf(" ==<<<<<=== DELETING Vertex Attrib Obj %d ======== \n",n);//HACK
-         glDeleteVertexArrays( 1, &(grid_VAO[n]) );
-         bstat[n] = 8;                          // flag that needs VBO deletion
-      }
-
-      if( bstat[n] == 2 ) {                     // flagged as "render this"
-         glBindVertexArray( grid_VAO[n] );
-         glDrawArrays( GL_TRIANGLES, 0, payload.grid_vertex_count );
-         glBindVertexArray(0);
+   for(int n=0;n<payload.grid_pages;++n) {      // sweep over pages
+      payload.grid_tlod[n] = -1;
+      if( !cull->visible[ payload.num_objs + n ] ) continue;
+
+      int ir = payload.draw_rgn[n];
+      if( ir >= 0 ) {                           // has a tile to render
+         // pick the level of detail; all levels are in the tile's region
+         // (or in the shared grid)
+         GLfloat bmin[3], bmax[3], bsph[4];
+         GLfloat shift[3] = { -0.5f, -0.5f, -1.2f };
+         tileBounds( payload.grid_rtx[ir], payload.grid_rty[ir],
+                     bmin, bmax, bsph );
+         GLfloat size = inoglProjectedSize( Mmatrix, Pmatrix, height,
+                                            bsph, shift );
+         int l = inoglLodSelect( &( payload.grid_lod[n] ), size );
+
+         if( payload.grid_hfield ) {
+            payload.grid_tlod[n] = l;
+            ++nlev[l];
+            continue;
+         }
+
+         // all tiles are in the one buffer, so this makes a single draw call
+         inoglBatchAddArrays( &( payload.tiles ), payload.grid_VAO,
+                              inoglStreamFirst( &( payload.grid_stream ),
+                                                ir, 12 * sizeof(GLfloat) ) +
+                              payload.grid_lod_first[l],
+                              payload.grid_lod_count[l] );
       }
    }
+   if( payload.grid_hfield ) {
+      drawHeightTiles( &payload, nlev );
+      glBindVertexArray(0);
+      glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+   } else {
+      inoglBatchSubmit( &( payload.tiles ) );
+   }
 
    glUseProgram(0);  // unbind shader program
 
-   // ----- deal with threading 1 -----
-   if( iswap ) {
-      fprintf( stdout, " [INFO]  Rendering thread swapping scene \n" );
-      write( payload.pipefd[1], "X", 1 );
-   }
+   // end the frame; regions retired in frames that have completed are recycled
+   inoglResFrame( &( payload.res ), payload.res_draw );
 }
 
@@ -35,7 +35,260 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//
+// The container of the shells that the functions below make. A shell is one
+// aligned allocation, with the vertices and (after them) the indices, and a
+// descriptor of how the vertices are laid out. They are either interleaved
+// (the components of a vertex together, which is what goes to the GL) or a
+// structure of arrays (an array per component, each one aligned, which is
+// what processing on the CPU prefers), and they are floats or doubles. The
+// components are those of a position, a normal, a texel and a colour, any of
+// which may be absent. Component "c" of vertex "n" is element "n*nglm + c"
+// when interleaved, and element "c*stride + n" otherwise. Shells are made
+// with one layout and type and converted to others (see "inShellConvert()").
+//
+#define IN_SHELL_AOS     1       // interleaved
+#define IN_SHELL_SOA     2       // an array per component
+#define IN_SHELL_FLOAT   1
+#define IN_SHELL_DOUBLE  2
+#define IN_SHELL_ALIGN   64      // of the allocation and of every array
+
+struct in_shell_s {
+   int layout;                     // IN_SHELL_AOS or IN_SHELL_SOA
+   int type;                       // IN_SHELL_FLOAT or IN_SHELL_DOUBLE
+   int ncomp[4];                   // components of the position, normal,
+                                   // texel and colour (zero when absent)
+   int moff[4];                    // first component of each of them
+   int nglm;                       // components per vertex
+   size_t nv;                      // vertices
+   size_t stride;                  // elements per array (when not interleaved)
+   size_t ni;                      // indices
+   int istrip;                     // the indices make a triangle strip
+   unsigned int restart;           // primitive restart index of the strip
+   void *x;                        // vertices; the start of the allocation
+   unsigned int *ie;               // indices; NULL when there are none
+};
+
+static size_t inShellAt( const struct in_shell_s *sh, size_t n, int c )
+{
+   if( sh->layout == IN_SHELL_AOS ) return n*((size_t) sh->nglm) + (size_t) c;
+   return ((size_t) c)*sh->stride + n;
+}
+
+static double inShellGet( const struct in_shell_s *sh, size_t n, int c )
+{
+   size_t k = inShellAt( sh, n, c );
+   if( sh->type == IN_SHELL_DOUBLE ) return ((const double*) sh->x)[k];
+   return (double) ((const float*) sh->x)[k];
+}
+
+static void inShellPut( struct in_shell_s *sh, size_t n, int c, double d )
+{
+   size_t k = inShellAt( sh, n, c );
+   if( sh->type == IN_SHELL_DOUBLE ) {
+      ((double*) sh->x)[k] = d;
+   } else {
+      ((float*) sh->x)[k] = (float) d;
+   }
+}
+
+//
+// Function to allocate a shell of "nv" vertices with the given components
+// (position, normal, texel, colour) and "ni" indices
+//
+
+int inShellAlloc( struct in_shell_s *sh, int layout, int type,
+                  size_t nv, const int *ncomp, size_t ni )
+{
+   memset( sh, 0, sizeof(struct in_shell_s) );
+   sh->layout = layout;
+   sh->type = type;
+   for(int k=0;k<4;++k) {
+      sh->ncomp[k] = ncomp[k];
+      sh->moff[k] = sh->nglm;
+      sh->nglm += ncomp[k];
+   }
+   sh->nv = nv;
+   sh->ni = ni;
+
+   // every array of a structure of arrays starts at an aligned address
+   size_t isize = ( type == IN_SHELL_DOUBLE ) ? sizeof(double) : sizeof(float);
+   size_t na = IN_SHELL_ALIGN / sizeof(float);
+   sh->stride = ( nv + na - 1 ) / na * na;
+   size_t nbytes = ( layout == IN_SHELL_AOS ? nv : sh->stride ) *
+                   ((size_t) sh->nglm) * isize;
+   nbytes = ( nbytes + IN_SHELL_ALIGN - 1 ) / IN_SHELL_ALIGN * IN_SHELL_ALIGN;
+
+   void *mem = NULL;
+   if( posix_memalign( &mem, IN_SHELL_ALIGN,
+                       nbytes + ni*sizeof(unsigned int) + IN_SHELL_ALIGN ) ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      memset( sh, 0, sizeof(struct in_shell_s) );
+      return 1;
+   }
+   sh->x = mem;
+   if( ni > 0 ) sh->ie = (unsigned int*) ( ((char*) mem) + nbytes );
+
+   return 0;
+}
+
+//
+// Function to free a shell
+//
+
+void inShellFree( struct in_shell_s *sh )
+{
+   if( sh->x != NULL ) free( sh->x );
+   memset( sh, 0, sizeof(struct in_shell_s) );
+}
+
+//
+// Function that returns the address of component "c" of the first vertex;
+// the component of consecutive vertices is "inShellStep()" elements apart
+//
+
+void* inShellComp( const struct in_shell_s *sh, int c )
+{
+   size_t isize = ( sh->type == IN_SHELL_DOUBLE ) ? sizeof(double) :
+                                                    sizeof(float);
+   return (void*) ( ((char*) sh->x) + inShellAt( sh, 0, c )*isize );
+}
+
+size_t inShellStep( const struct in_shell_s *sh )
+{
+   return ( sh->layout == IN_SHELL_AOS ) ? (size_t) sh->nglm : 1;
+}
+
+//
+// Conversion of the vertices between layouts and types. Blocks of vertices
+// and components are loaded as rows (of a component over a few vertices, or
+// of a vertex over a few components), transposed when the layouts differ,
+// and stored; doubles are converted to floats (and back) in registers, and
+// doubles that stay doubles are moved in blocks of two. What is not covered
+// by whole blocks is done one element at a time. The results are the same as
+// those of casting every element.
+//
+#ifdef __SSE2__
+static size_t inShellRow( const struct in_shell_s *sh, size_t n, int c, int k )
+{
+   return ( sh->layout == IN_SHELL_SOA ) ? inShellAt( sh, n, c+k ) :
+                                           inShellAt( sh, n+(size_t) k, c );
+}
+
+static __m128 inShellLoad4( const struct in_shell_s *sh, size_t k )
+{
+   if( sh->type == IN_SHELL_DOUBLE ) {
+      const double *d = &( ((const double*) sh->x)[k] );
+      return _mm_movelh_ps( _mm_cvtpd_ps( _mm_loadu_pd( d ) ),
+                            _mm_cvtpd_ps( _mm_loadu_pd( d+2 ) ) );
+   }
+   return _mm_loadu_ps( &( ((const float*) sh->x)[k] ) );
+}
+
+static void inShellStore4( struct in_shell_s *sh, size_t k, __m128 r )
+{
+   if( sh->type == IN_SHELL_DOUBLE ) {
+      double *d = &( ((double*) sh->x)[k] );
+      _mm_storeu_pd( d, _mm_cvtps_pd( r ) );
+      _mm_storeu_pd( d+2, _mm_cvtps_pd( _mm_movehl_ps( r, r ) ) );
+   } else {
+      _mm_storeu_ps( &( ((float*) sh->x)[k] ), r );
+   }
+}
+#endif
+
+static void inShellCopy( struct in_shell_s *dst, const struct in_shell_s *src )
+{
+   size_t nv = src->nv;
+   int nglm = src->nglm;
+   size_t nb = 0;        // vertices done in blocks
+   int cb = 0;           // components done in blocks
+
+#ifdef __SSE2__
+   int itrans = ( src->layout != dst->layout );
+   if( src->type == IN_SHELL_DOUBLE && dst->type == IN_SHELL_DOUBLE ) {
+      const double *s = (const double*) src->x;
+      double *d = (double*) dst->x;
+      cb = nglm & ~1;
+      for(nb=0;nb+2<=nv;nb+=2) {
+         for(int c=0;c<cb;c+=2) {
+            __m128d r0 = _mm_loadu_pd( &( s[ inShellRow( src, nb, c, 0 ) ] ) );
+            __m128d r1 = _mm_loadu_pd( &( s[ inShellRow( src, nb, c, 1 ) ] ) );
+            if( itrans ) {
+               __m128d t = _mm_unpacklo_pd( r0, r1 );
+               r1 = _mm_unpackhi_pd( r0, r1 );
+               r0 = t;
+            }
+            _mm_storeu_pd( &( d[ inShellRow( dst, nb, c, 0 ) ] ), r0 );
+            _mm_storeu_pd( &( d[ inShellRow( dst, nb, c, 1 ) ] ), r1 );
+         }
+      }
+   } else {
+      cb = nglm & ~3;
+      for(nb=0;nb+4<=nv;nb+=4) {
+         for(int c=0;c<cb;c+=4) {
+            __m128 r0 = inShellLoad4( src, inShellRow( src, nb, c, 0 ) );
+            __m128 r1 = inShellLoad4( src, inShellRow( src, nb, c, 1 ) );
+            __m128 r2 = inShellLoad4( src, inShellRow( src, nb, c, 2 ) );
+            __m128 r3 = inShellLoad4( src, inShellRow( src, nb, c, 3 ) );
+            if( itrans ) _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+            inShellStore4( dst, inShellRow( dst, nb, c, 0 ), r0 );
+            inShellStore4( dst, inShellRow( dst, nb, c, 1 ), r1 );
+            inShellStore4( dst, inShellRow( dst, nb, c, 2 ), r2 );
+            inShellStore4( dst, inShellRow( dst, nb, c, 3 ), r3 );
+         }
+      }
+   }
+#endif
+
+   for(size_t n=0;n<nv;++n) {
+      for(int c=( n < nb ? cb : 0 );c<nglm;++c) {
+         inShellPut( dst, n, c, inShellGet( src, n, c ) );
+      }
+   }
+}
+
+//
+// Function to make a copy of a shell in another layout and type
+//
+
+int inShellConvert( struct in_shell_s *dst, const struct in_shell_s *src,
+                    int layout, int type )
+{
+   if( inShellAlloc( dst, layout, type, src->nv, src->ncomp, src->ni ) ) {
+      return 1;
+   }
+   dst->istrip = src->istrip;
+   dst->restart = src->restart;
+   if( src->ni > 0 ) {
+      memcpy( dst->ie, src->ie, src->ni*sizeof(unsigned int) );
+   }
+
+   if( layout == src->layout && type == src->type ) {
+      size_t isize = ( type == IN_SHELL_DOUBLE ) ? sizeof(double) :
+                                                   sizeof(float);
+      size_t ne = ( layout == IN_SHELL_AOS ? src->nv : src->stride ) *
+                  ((size_t) src->nglm);
+      memcpy( dst->x, src->x, ne*isize );
+   } else {
+      inShellCopy( dst, src );
+   }
+
+   return 0;
+}
+
 
 //
 // Function that makes a spherical shell surface of structured quadrilaterals
@@ -45,42 +298,29 @@
 // overlaps the first of the structured grid.
 //
 
-int inMakeAxisSphereshell1( int im, int jm,
-                            double **x, double **y, double **z,
-                            double **u, double **v, double **w,
-                            float **s, float **t )
+int inMakeAxisSphereshell1( int im, int jm, struct in_shell_s *sh )
 {
    int i,j,n;
    size_t isize;
    double pi,angle,azimuth;
    double ksi,eta;
+   static const int ncomp[4] = { 3, 3, 2, 0 };
 
 
    pi = acos(-1.0);
 
    isize = im*jm;
-   *x = (double *) malloc(isize*sizeof(double));
-   *y = (double *) malloc(isize*sizeof(double));
-   *z = (double *) malloc(isize*sizeof(double));
-   *u = (double *) malloc(isize*sizeof(double));
-   *v = (double *) malloc(isize*sizeof(double));
-   *w = (double *) malloc(isize*sizeof(double));
-   *s = (float *) malloc(isize*sizeof(float));
-   *t = (float *) malloc(isize*sizeof(float));
-   if( *x == NULL || *y == NULL || *z == NULL ||
-       *u == NULL || *v == NULL || *w == NULL ||
-       *s == NULL || *t == NULL ) {
-      fprintf( stdout," Error: could not allocate arrays \n" );
-      if( *x != NULL ) free( *x );
-      if( *y != NULL ) free( *y );
-      if( *z != NULL ) free( *z );
-      if( *u != NULL ) free( *u );
-      if( *v != NULL ) free( *v );
-      if( *w != NULL ) free( *w );
-      if( *s != NULL ) free( *s );
-      if( *t != NULL ) free( *t );
+   if( inShellAlloc( sh, IN_SHELL_SOA, IN_SHELL_DOUBLE, isize, ncomp, 0 ) ) {
       return 1;
    }
+   double *x = (double*) inShellComp( sh, 0 );
+   double *y = (double*) inShellComp( sh, 1 );
+   double *z = (double*) inShellComp( sh, 2 );
+   double *u = (double*) inShellComp( sh, 3 );
+   double *v = (double*) inShellComp( sh, 4 );
+   double *w = (double*) inShellComp( sh, 5 );
+   double *s = (double*) inShellComp( sh, 6 );
+   double *t = (double*) inShellComp( sh, 7 );
 
    for(i=0;i<im;++i) {
       ksi = ((double) i)/ ((double) (im-1));
@@ -92,16 +332,16 @@ int inMakeAxisSphereshell1( int im, int jm,
 
          n = i*jm + j;
 
-         (*x)[n] = cos(angle)*sin(azimuth);
-         (*y)[n] = cos(azimuth);
-         (*z)[n] = sin(angle)*sin(azimuth);
+         x[n] = cos(angle)*sin(azimuth);
+         y[n] = cos(azimuth);
+         z[n] = sin(angle)*sin(azimuth);
          // normals
-         (*u)[n] = (*x)[n];
-         (*v)[n] = (*y)[n];
-         (*w)[n] = (*z)[n];
+         u[n] = x[n];
+         v[n] = y[n];
+         w[n] = z[n];
          // texels
-         (*s)[n] = (float) ksi;
-         (*t)[n] = (float) eta;
+         s[n] = ksi;
+         t[n] = eta;
 
       }
    }
@@ -115,11 +355,9 @@ int inMakeAxisSphereshell1( int im, int jm,
 //
 
 int inDumpTecplotShell1( char *fname, int im, int jm,
-                         const double *x, const double *y, const double *z,
-                         const double *u, const double *v, const double *w,
-                         const float *s, const float *t )
+                         const struct in_shell_s *sh )
 {
-   int i,j;
+   int i,j,k;
    FILE *fp;
 
    fp = fopen( fname, "w" );
@@ -133,11 +371,13 @@ int inDumpTecplotShell1( char *fname, int im, int jm,
 
    for(j=0;j<jm;++j) {
       for(i=0;i<im;++i) {
-         int n = i*jm + j;
+         size_t n = (size_t) (i*jm + j);
+         double d[8];
+         for(k=0;k<8;++k) d[k] = inShellGet( sh, n, k );
 
-         fprintf( fp," %lf %lf %lf \n", x[n], y[n], z[n] );
-         fprintf( fp," %lf %lf %lf \n", u[n], v[n], w[n] );
-         fprintf( fp," %f %f \n", s[n], t[n] );
+         fprintf( fp," %lf %lf %lf \n", d[0], d[1], d[2] );
+         fprintf( fp," %lf %lf %lf \n", d[3], d[4], d[5] );
+         fprintf( fp," %f %f \n", d[6], d[7] );
       }
    }
 
@@ -156,44 +396,30 @@ int inDumpTecplotShell1( char *fname, int im, int jm,
 // triangles of zero area (at the ends along the degenerate axis).
 //
 
-int inMakeAxisSphereshell2( int im, int jm,
-                            double **x, double **y, double **z,
-                            double **u, double **v, double **w,
-                            float **s, float **t, int **ie )
+int inMakeAxisSphereshell2( int im, int jm, struct in_shell_s *sh )
 {
    int i,j,n;
    size_t isize;
    double pi,angle,azimuth;
    double ksi,eta;
+   static const int ncomp[4] = { 3, 3, 2, 0 };
 
 
    pi = acos(-1.0);
 
    isize = im*jm;
-   *x = (double*) malloc(isize*sizeof(double));
-   *y = (double*) malloc(isize*sizeof(double));
-   *z = (double*) malloc(isize*sizeof(double));
-   *u = (double*) malloc(isize*sizeof(double));
-   *v = (double*) malloc(isize*sizeof(double));
-   *w = (double*) malloc(isize*sizeof(double));
-   *s = (float*) malloc(isize*sizeof(float));
-   *t = (float*) malloc(isize*sizeof(float));
-   *ie = (int*) malloc( 2 * isize * 3 * sizeof(float) );
-   if( *x == NULL || *y == NULL || *z == NULL ||
-       *u == NULL || *v == NULL || *w == NULL ||
-       *s == NULL || *t == NULL|| *ie == NULL ) {
-      fprintf( stdout," Error: could not allocate arrays \n" );
-      if( *x != NULL ) free( *x );
-      if( *y != NULL ) free( *y );
-      if( *z != NULL ) free( *z );
-      if( *u != NULL ) free( *u );
-      if( *v != NULL ) free( *v );
-      if( *w != NULL ) free( *w );
-      if( *s != NULL ) free( *s );
-      if( *t != NULL ) free( *t );
-      if( *ie != NULL ) free( *ie );
+   if( inShellAlloc( sh, IN_SHELL_SOA, IN_SHELL_DOUBLE, isize, ncomp,
+                     6*((size_t) (im-1))*((size_t) (jm-1)) ) ) {
       return 1;
    }
+   double *x = (double*) inShellComp( sh, 0 );
+   double *y = (double*) inShellComp( sh, 1 );
+   double *z = (double*) inShellComp( sh, 2 );
+   double *u = (double*) inShellComp( sh, 3 );
+   double *v = (double*) inShellComp( sh, 4 );
+   double *w = (double*) inShellComp( sh, 5 );
+   double *s = (double*) inShellComp( sh, 6 );
+   double *t = (double*) inShellComp( sh, 7 );
 
    for(i=0;i<im;++i) {
       ksi = ((double) i)/ ((double) (im-1));
@@ -205,21 +431,21 @@ int inMakeAxisSphereshell2( int im, int jm,
 
          n = i*jm + j;
 
-         (*x)[n] = cos(angle)*sin(azimuth);
-         (*y)[n] = cos(azimuth);
-         (*z)[n] = sin(angle)*sin(azimuth);
+         x[n] = cos(angle)*sin(azimuth);
+         y[n] = cos(azimuth);
+         z[n] = sin(angle)*sin(azimuth);
          // normals
-         (*u)[n] = (*x)[n];
-         (*v)[n] = (*y)[n];
-         (*w)[n] = (*z)[n];
+         u[n] = x[n];
+         v[n] = y[n];
+         w[n] = z[n];
          // texels
-         (*s)[n] = (float) ksi;
-         (*t)[n] = (float) eta;
+         s[n] = ksi;
+         t[n] = eta;
 
       }
    }
 
-   int* ic = *ie;
+   unsigned int* ic = sh->ie;
    int ne=0;
    for(i=0;i<im-1;++i) {
       for(j=0;j<jm-1;++j) {
@@ -246,11 +472,10 @@ int inMakeAxisSphereshell2( int im, int jm,
 //
 
 int inDumpTecplotShell2( char *fname, int im, int jm,
-                         const double *x, const double *y, const double *z,
-                         const double *u, const double *v, const double *w,
-                         const float *s, const float *t, const int* ie )
+                         const struct in_shell_s *sh )
 {
    int n, ne = 2*(im-1)*(jm-1);
+   const unsigned int *ie = sh->ie;
    FILE *fp;
 
    fp = fopen( fname, "w" );
@@ -264,12 +489,14 @@ int inDumpTecplotShell2( char *fname, int im, int jm,
    fprintf( fp, "     ZONETYPE=FETRIANGLE, DATAPACKING=POINT \n" );
 
    for(n=0;n<im*jm;++n) {
-      fprintf( fp," %f %f %f   ", x[n], y[n], z[n] );
-      fprintf( fp," %f %f %f   ", u[n], v[n], w[n] );
-      fprintf( fp," %f %f \n", s[n], t[n] );
+      double d[8];
+      for(int k=0;k<8;++k) d[k] = inShellGet( sh, (size_t) n, k );
+      fprintf( fp," %f %f %f   ", d[0], d[1], d[2] );
+      fprintf( fp," %f %f %f   ", d[3], d[4], d[5] );
+      fprintf( fp," %f %f \n", d[6], d[7] );
    }
    for(n=0;n<ne;++n) {
-      fprintf( fp," %d %d %d \n", ie[3*n]+1, ie[3*n+1]+1, ie[3*n+2]+1 );
+      fprintf( fp," %u %u %u \n", ie[3*n]+1, ie[3*n+1]+1, ie[3*n+2]+1 );
    }
 
    fclose( fp );
@@ -285,11 +512,10 @@ int inDumpTecplotShell2( char *fname, int im, int jm,
 // node counts in the i and j directions; the last index in each direction
 // overlaps the first of the structured grid. However, the triangles are all
 // independent and there are none with zero area. The returned array stores
-// positions, color, normal vector components, and texels. Connectivity is
-// also returned.
+// positions, color, normal vector components, and texels (interleaved).
 //
 
-int inMakeAxisSphereshell3( int im, int jm, float **x )
+int inMakeAxisSphereshell3( int im, int jm, struct in_shell_s *sh )
 {
    int i,j;
    size_t isize,ioff;
@@ -303,9 +529,8 @@ int inMakeAxisSphereshell3( int im, int jm, float **x )
    int ne = 2*(im-1)*(jm-1 -2) + 2*(im-1);
    isize = (size_t) ne;
    ioff = 3 + 3 + 2 + 4;   // 3 pos. + 3 normal + 2 texel + 4 color (RGBA)
-   *x = (float*) malloc( 3 * isize * ioff * sizeof(float) );
-   if( *x == NULL ) {
-      fprintf( stdout," Error: could not allocate arrays \n" );
+   static const int ncomp[4] = { 3, 3, 2, 4 };
+   if( inShellAlloc( sh, IN_SHELL_AOS, IN_SHELL_FLOAT, 3*isize, ncomp, 0 ) ) {
       return 1;
    }
 #ifdef _DEBUG_
@@ -314,7 +539,7 @@ int inMakeAxisSphereshell3( int im, int jm, float **x )
 #endif
 
 #define HACKJOB 0
-   float* xx = *x;
+   float* xx = (float*) sh->x;
    size_t nn=0,k;
    for(i=0;i<im-1;++i) {
       for(j=0;j<jm-1;++j) {
@@ -394,9 +619,9 @@ int inMakeAxisSphereshell3( int im, int jm, float **x )
 // Function to plot the Gl-rendering formatted data in TecPlot or ParaView
 //
 
-int inDumpTecplotShell3( char *fname, int ne, const float *x )
+int inDumpTecplotShell3( char *fname, const struct in_shell_s *sh )
 {
-   int n;
+   int n, ne = (int) (sh->nv/3);
    FILE *fp;
 
    fp = fopen( fname, "w" );
@@ -411,11 +636,12 @@ int inDumpTecplotShell3( char *fname, int ne, const float *x )
 
    for(n=0;n<ne;++n) {
       for(int k=0;k<3;++k) {
-         int m = (3*n + k)*12;
-         fprintf( fp," %f %f %f   ", x[m], x[m+1], x[m+2] );
-         fprintf( fp," %f %f %f   ", x[m+3], x[m+4], x[m+5] );
-         fprintf( fp," %f %f   ", x[m+6], x[m+7] );
-         fprintf( fp," %f %f %f %f \n", x[m+8], x[m+9], x[m+10], x[m+11] );
+         double x[12];
+         for(int m=0;m<12;++m) x[m] = inShellGet( sh, (size_t) (3*n + k), m );
+         fprintf( fp," %f %f %f   ", x[0], x[1], x[2] );
+         fprintf( fp," %f %f %f   ", x[3], x[4], x[5] );
+         fprintf( fp," %f %f   ", x[6], x[7] );
+         fprintf( fp," %f %f %f %f \n", x[8], x[9], x[10], x[11] );
      }
    }
    for(n=0;n<ne;++n) {
@@ -428,28 +654,1626 @@ int inDumpTecplotShell3( char *fname, int ne, const float *x )
 }
 
 
-// Compile this file with "-DMAIN" to run it standalone
-#ifdef _DRIVER_
-int main() {
-   int im = 40,jm = 20;
-   double *x,*y,*z;
-   double *u,*v,*w;
-   float  *s,*t;
-   int *ie;
+//
+// The functions above evaluate the same few trigonometric functions at every
+// node (and shell 3 does so four times per quad), although they only depend
+// on the index along one direction. The functions below make tables of them
+// once, per i-line (the angle) and per j-line (the azimuth), and fill the
+// nodes in parallel with a fixed number of threads, each taking a contiguous
+// range of i-lines; the output is the same, bit for bit, as that of the
+// functions they replace. A thread count of less than one means one thread
+// per core.
+//
+
+struct in_sphere_trig_s {
+   int im, jm;
+   double *ksi, *ca, *sa;          // per i: parameter, cos and sin of angle
+   double *eta, *cz, *sz, *s2z;    // per j: parameter, cos, sin, sin(2 az)
+};
+
+struct in_sphere_work_s {
+   const struct in_sphere_trig_s *tr;
+   int i0, i1;                     // range of i-lines of this thread
+   int ishell;                     // shell kind to fill (1, 2, 3, 4 or 5)
+   double *x, *y, *z, *u, *v, *w, *s, *t;
+   float *xx;
+   unsigned int *ui;               // indices of shells 2, 4 and 5
+   size_t istride;                 // indices per band of shell 5 (strips)
+};
+
+static void inSphereTrigFree( struct in_sphere_trig_s *tr )
+{
+   if( tr->ksi != NULL ) free( tr->ksi );
+   if( tr->eta != NULL ) free( tr->eta );
+   memset( tr, 0, sizeof(struct in_sphere_trig_s) );
+}
+
+static int inSphereTrigInit( struct in_sphere_trig_s *tr, int im, int jm )
+{
+   double pi = acos(-1.0);
+
+   memset( tr, 0, sizeof(struct in_sphere_trig_s) );
+   tr->im = im;
+   tr->jm = jm;
+   tr->ksi = (double*) malloc( 3*((size_t) im)*sizeof(double) );
+   tr->eta = (double*) malloc( 4*((size_t) jm)*sizeof(double) );
+   if( tr->ksi == NULL || tr->eta == NULL ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      inSphereTrigFree( tr );
+      return 1;
+   }
+   tr->ca = &( tr->ksi[im] );
+   tr->sa = &( tr->ksi[2*im] );
+   tr->cz = &( tr->eta[jm] );
+   tr->sz = &( tr->eta[2*jm] );
+   tr->s2z = &( tr->eta[3*jm] );
+
+   for(int i=0;i<im;++i) {
+      double ksi = ((double) i)/ ((double) (im-1));
+      double angle = 2.0*pi * ksi;
+      tr->ksi[i] = ksi;
+      tr->ca[i] = cos(angle);
+      tr->sa[i] = sin(angle);
+   }
+   for(int j=0;j<jm;++j) {
+      double eta = ((double) j)/ ((double) (jm-1));
+      double azimuth = pi * (1.0 - eta);
+      tr->eta[j] = eta;
+      tr->cz[j] = cos(azimuth);
+      tr->sz[j] = sin(azimuth);
+      tr->s2z[j] = sin(2.0*azimuth);
+   }
+
+   return 0;
+}
+
+//
+// nodes (and elements) of shells 1 and 2 for a range of i-lines
+//
+static void inSphereNodes( struct in_sphere_work_s *wk )
+{
+   const struct in_sphere_trig_s *tr = wk->tr;
+   int jm = tr->jm;
+
+   for(int i=wk->i0;i<wk->i1;++i) {
+      for(int j=0;j<jm;++j) {
+         int n = i*jm + j;
+         double xn = tr->ca[i]*tr->sz[j];
+         double yn = tr->cz[j];
+         double zn = tr->sa[i]*tr->sz[j];
+
+         wk->x[n] = xn;
+         wk->y[n] = yn;
+         wk->z[n] = zn;
+         // normals
+         wk->u[n] = xn;
+         wk->v[n] = yn;
+         wk->w[n] = zn;
+         // texels
+         wk->s[n] = tr->ksi[i];
+         wk->t[n] = tr->eta[j];
+      }
+
+      if( wk->ishell != 2 || i == tr->im-1 ) continue;
+      unsigned int* ic = &( wk->ui[ 3*2*i*(jm-1) ] );
+      for(int j=0;j<jm-1;++j) {
+         unsigned int n = (unsigned int) (i*jm + j);
+
+         ic[0] = n;
+         ic[1] = n + jm;
+         ic[2] = n + 1;
+
+         ic[3] = n + 1;
+         ic[4] = n + jm;
+         ic[5] = n + jm + 1;
+         ic += 6;
+      }
+   }
+}
+
+//
+// independent triangles of shell 3 for a range of i-lines (quads); every
+// i-line of quads has 6*(jm-2) vertices
+//
+static void inSphereTriangles( struct in_sphere_work_s *wk )
+{
+   const struct in_sphere_trig_s *tr = wk->tr;
+   int jm = tr->jm;
+   const size_t ioff = 12;
+
+   for(int i=wk->i0;i<wk->i1;++i) {
+      float* xx = &( wk->xx[ ((size_t) i)*6*((size_t) (jm-2))*ioff ] );
+
+      for(int j=0;j<jm-1;++j) {
+         float data[4][12];
+         for(int k=0;k<4;++k) {
+            int ii = i + (k & 1);           // corners: (i,j), (i+1,j),
+            int jj = j + (k >> 1);          // (i,j+1), (i+1,j+1)
+
+            // vertex position
+            data[k][0] = (float) (tr->ca[ii]*tr->sz[jj]);
+            data[k][1] = (float) (tr->cz[jj]);
+            data[k][2] = (float) (tr->sa[ii]*tr->sz[jj]);
+            // normal
+            data[k][3] = data[0][0];
+            data[k][4] = data[0][1];
+            data[k][5] = data[0][2];
+            // texel
+            data[k][6] = (float) tr->ksi[ii];
+            data[k][7] = (float) tr->eta[jj];
+            // colour has latitudinal variations
+            data[k][8]  = (float) (tr->sz[jj] * tr->sz[jj]);
+            data[k][9]  = (float) tr->s2z[jj];
+            data[k][10] = (float) (tr->cz[jj] * tr->cz[jj]);
+            data[k][11] = 1.0; // full alpha (opaque)
+         }
+
+         static const int itri[3][6] = { { 2,1,3, -1,-1,-1 },
+                                         { 0,1,2, -1,-1,-1 },
+                                         { 0,1,2,  1, 2, 3 } };
+         int it = ( j == 0 ) ? 0 : ( j == jm-1-1 ? 1 : 2 );
+         for(int m=0;m<6 && itri[it][m] >= 0;++m) {
+            memcpy( xx, data[ itri[it][m] ], ioff*sizeof(float) );
+            xx += ioff;
+         }
+      }
+   }
+}
+
+//
+// shared vertices of shells 4 and 5 (one per node, in the interleaved layout
+// of shell 3 with a normal per node) for a range of i-lines, and either the
+// indices of independent triangles (4), or those of the triangle strips along
+// every band of quads (5); the strip of band "j" is "b0 a0 b1 a1 ..." with "a"
+// the nodes of line "j" and "b" those of line "j+1", and the triangles wind
+// the same way as those of shell 4
+//
+static void inSphereIndexed( struct in_sphere_work_s *wk )
+{
+   const struct in_sphere_trig_s *tr = wk->tr;
+   int jm = tr->jm;
+   const size_t ioff = 12;
+
+   for(int i=wk->i0;i<wk->i1;++i) {
+      float* xx = &( wk->xx[ ((size_t) i)*((size_t) jm)*ioff ] );
+      for(int j=0;j<jm;++j) {
+         // vertex position and normal
+         xx[0] = (float) (tr->ca[i]*tr->sz[j]);
+         xx[1] = (float) (tr->cz[j]);
+         xx[2] = (float) (tr->sa[i]*tr->sz[j]);
+         xx[3] = xx[0];
+         xx[4] = xx[1];
+         xx[5] = xx[2];
+         // texel
+         xx[6] = (float) tr->ksi[i];
+         xx[7] = (float) tr->eta[j];
+         // colour has latitudinal variations
+         xx[8]  = (float) (tr->sz[j] * tr->sz[j]);
+         xx[9]  = (float) tr->s2z[j];
+         xx[10] = (float) (tr->cz[j] * tr->cz[j]);
+         xx[11] = 1.0; // full alpha (opaque)
+         xx += ioff;
+      }
+
+      unsigned int n0 = (unsigned int) (i*jm);
+      if( wk->ishell == 5 ) {
+         for(int j=0;j<jm-1;++j) {
+            unsigned int* ic = &( wk->ui[ ((size_t) j)*wk->istride +
+                                          2*((size_t) i) ] );
+            ic[0] = n0 + (unsigned int) (j+1);
+            ic[1] = n0 + (unsigned int) j;
+         }
+         continue;
+      }
+
+      if( i == tr->im-1 ) continue;
+      unsigned int* ic = &( wk->ui[ ((size_t) i)*6*((size_t) (jm-2)) ] );
+      for(int j=0;j<jm-1;++j) {
+         unsigned int n = n0 + (unsigned int) j;
+         unsigned int nc[4] = { n, n + (unsigned int) jm,
+                                n + 1, n + (unsigned int) jm + 1 };
+         // the poles are nodes that coincide, so their bands have one
+         // triangle per quad (no zero-area triangles)
+         if( j != jm-1-1 ) {
+            *(ic++) = nc[2]; *(ic++) = nc[1]; *(ic++) = nc[3];
+         }
+         if( j != 0 ) {
+            *(ic++) = nc[0]; *(ic++) = nc[1]; *(ic++) = nc[2];
+         }
+      }
+   }
+}
+
+static void* inSphereWorker( void *arg )
+{
+   struct in_sphere_work_s *wk = (struct in_sphere_work_s*) arg;
+
+   if( wk->ishell == 3 ) {
+      inSphereTriangles( wk );
+   } else if( wk->ishell >= 4 ) {
+      inSphereIndexed( wk );
+   } else {
+      inSphereNodes( wk );
+   }
+
+   return NULL;
+}
+
+//
+// splits "num" i-lines over the threads and runs them (small shells are not
+// worth many threads); a thread that cannot be started is run by the caller
+//
+static void inSphereRun( const struct in_sphere_work_s *wk, int num,
+                         int num_threads )
+{
+   if( num_threads < 1 ) num_threads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+   if( num_threads < 1 ) num_threads = 1;
+   if( num_threads > (num+31)/32 ) num_threads = (num+31)/32;  // (32 lines)
+   if( num_threads > 64 ) num_threads = 64;
+
+   pthread_t tid[64];
+   struct in_sphere_work_s wks[64];
+   int istarted[64];
+   for(int n=0;n<num_threads;++n) {
+      wks[n] = *wk;
+      wks[n].i0 = (int) ( ((long) num) * n / num_threads );
+      wks[n].i1 = (int) ( ((long) num) * (n+1) / num_threads );
+      istarted[n] = 0;
+      if( n > 0 ) {
+         istarted[n] = ( pthread_create( &( tid[n] ), NULL, inSphereWorker,
+                                         (void*) &( wks[n] ) ) == 0 );
+      }
+   }
+   for(int n=0;n<num_threads;++n) {
+      if( !istarted[n] ) (void) inSphereWorker( (void*) &( wks[n] ) );
+   }
+   for(int n=1;n<num_threads;++n) {
+      if( istarted[n] ) pthread_join( tid[n], NULL );
+   }
+}
+
+
+//
+// nodes of shell 1, and also the elements of shell 2
+//
+static int inSphereShellmt( int im, int jm, struct in_shell_s *sh,
+                            int ishell, int num_threads )
+{
+   static const int ncomp[4] = { 3, 3, 2, 0 };
+   struct in_sphere_trig_s tr;
+   if( inSphereTrigInit( &tr, im, jm ) ) return 1;
+
+   size_t isize = ((size_t) im)*((size_t) jm);
+   size_t ni = 0;
+   if( ishell == 2 ) ni = 6*((size_t) (im-1))*((size_t) (jm-1));
+   if( inShellAlloc( sh, IN_SHELL_SOA, IN_SHELL_DOUBLE, isize, ncomp, ni ) ) {
+      inSphereTrigFree( &tr );
+      return 1;
+   }
+
+   struct in_sphere_work_s wk;
+   memset( &wk, 0, sizeof(struct in_sphere_work_s) );
+   wk.tr = &tr;
+   wk.ishell = ishell;
+   wk.x = (double*) inShellComp( sh, 0 );
+   wk.y = (double*) inShellComp( sh, 1 );
+   wk.z = (double*) inShellComp( sh, 2 );
+   wk.u = (double*) inShellComp( sh, 3 );
+   wk.v = (double*) inShellComp( sh, 4 );
+   wk.w = (double*) inShellComp( sh, 5 );
+   wk.s = (double*) inShellComp( sh, 6 );
+   wk.t = (double*) inShellComp( sh, 7 );
+   wk.ui = sh->ie;
+   inSphereRun( &wk, im, num_threads );
+
+   inSphereTrigFree( &tr );
+   return 0;
+}
+
+
+//
+// shared vertices and the indices of triangles (or of strips) of shells 4
+// and 5; the poles are nodes that coincide as in the other shells
+//
+static int inSphereIndexedmt( int im, int jm, struct in_shell_s *sh,
+                              int istrip, unsigned int restart,
+                              int num_threads )
+{
+   if( im < 2 || jm < 3 ) {
+      fprintf( stdout," Error: sphere of %d x %d nodes is too small \n",
+               im, jm );
+      return 2;
+   }
+
+   struct in_sphere_trig_s tr;
+   if( inSphereTrigInit( &tr, im, jm ) ) return 1;
+
+   size_t nv = ((size_t) im)*((size_t) jm);
+   static const int ncomp[4] = { 3, 3, 2, 4 };   // pos., normal, texel, RGBA
+   size_t njoin = ( restart != 0 ) ? 1 : 2;
+   size_t istride = 2*((size_t) im) + njoin;
+   size_t ni = 6*((size_t) (im-1))*((size_t) (jm-2));
+   if( istrip ) ni = ((size_t) (jm-1))*istride - njoin;
+   if( inShellAlloc( sh, IN_SHELL_AOS, IN_SHELL_FLOAT, nv, ncomp, ni ) ) {
+      inSphereTrigFree( &tr );
+      return 1;
+   }
+   sh->istrip = istrip;
+   sh->restart = restart;
+
+   struct in_sphere_work_s wk;
+   memset( &wk, 0, sizeof(struct in_sphere_work_s) );
+   wk.tr = &tr;
+   wk.ishell = istrip ? 5 : 4;
+   wk.xx = (float*) sh->x;
+   wk.ui = sh->ie;
+   wk.istride = istride;
+   inSphereRun( &wk, im, num_threads );
+
+   // join the strips of the bands
+   for(int j=0;istrip && j<jm-1-1;++j) {
+      unsigned int* ic = &( sh->ie[ ((size_t) (j+1))*istride - njoin ] );
+      if( restart != 0 ) {
+         ic[0] = restart;
+      } else {
+         ic[0] = ic[-1];
+         ic[1] = ic[2];
+      }
+   }
+
+   inSphereTrigFree( &tr );
+   return 0;
+}
+
+
+//
+// Function that makes the same shell as "inMakeAxisSphereshell1()" in
+// parallel from tables
+//
+
+int inMakeAxisSphereshell1mt( int im, int jm, struct in_shell_s *sh,
+                              int num_threads )
+{
+   return inSphereShellmt( im, jm, sh, 1, num_threads );
+}
+
+
+//
+// Function that makes the same shell as "inMakeAxisSphereshell2()" in
+// parallel from tables
+//
+
+int inMakeAxisSphereshell2mt( int im, int jm, struct in_shell_s *sh,
+                              int num_threads )
+{
+   return inSphereShellmt( im, jm, sh, 2, num_threads );
+}
+
 
-// (void) inMakeAxisSphereshell1(im,jm,&x,&y,&z,&u,&v,&w,&s,&t);
-// (void) inDumpTecplotShell1("shell1.dat",im,jm,x,y,z, u,v,w, s,t);
-// free(x); free(y); free(z); free(u); free(v); free(w); free(s); free(t);
+//
+// Function that makes the same triangles as "inMakeAxisSphereshell3()" in
+// parallel from tables (there must be at least 3 nodes in j)
+//
+
+int inMakeAxisSphereshell3mt( int im, int jm, struct in_shell_s *sh,
+                              int num_threads )
+{
+   if( im < 2 || jm < 3 ) {
+      fprintf( stdout," Error: sphere of %d x %d nodes is too small \n",
+               im, jm );
+      return 2;
+   }
 
-// (void) inMakeAxisSphereshell2(im,jm,&x,&y,&z,&u,&v,&w,&s,&t,&ie);
-// (void) inDumpTecplotShell2("shell2.dat",im,jm,x,y,z, u,v,w, s,t,ie);
-// free(x); free(y); free(z); free(u); free(v); free(w); free(s); free(t);
-// free(ie);
+   struct in_sphere_trig_s tr;
+   if( inSphereTrigInit( &tr, im, jm ) ) return 1;
 
-   inMakeAxisSphereshell3( im, jm, &s );
    int ne = 2*(im-1)*(jm-1 -2) + 2*(im-1);
-   (void) inDumpTecplotShell3("shell3.dat",ne,s);
-   free(s);
+   size_t isize = (size_t) ne;
+   static const int ncomp[4] = { 3, 3, 2, 4 };   // pos., normal, texel, RGBA
+   if( inShellAlloc( sh, IN_SHELL_AOS, IN_SHELL_FLOAT, 3*isize, ncomp, 0 ) ) {
+      inSphereTrigFree( &tr );
+      return 1;
+   }
+
+   struct in_sphere_work_s wk;
+   memset( &wk, 0, sizeof(struct in_sphere_work_s) );
+   wk.tr = &tr;
+   wk.ishell = 3;
+   wk.xx = (float*) sh->x;
+   inSphereRun( &wk, im-1, num_threads );
+
+   inSphereTrigFree( &tr );
+   return 0;
+}
+
+
+//
+// Function that makes a shell of shared vertices (one per node; "im*jm" of
+// them in the interleaved layout of shell 3) and the indices of its triangles
+// (there are as many as in shell 3, and they wind the same way); this is what
+// indexed draws of GL_TRIANGLES take
+//
+
+int inMakeAxisSphereIndexed( int im, int jm, struct in_shell_s *sh,
+                             int num_threads )
+{
+   return inSphereIndexedmt( im, jm, sh, 0, 0, num_threads );
+}
+
+
+//
+// Function that makes a shell of shared vertices (as above) and the indices
+// of a triangle strip per band of quads; bands are joined by the primitive
+// restart index "restart", or, if it is zero, by repeating the last index of
+// a band and the first of the next (the degenerate triangles draw nothing).
+// This is what indexed draws of GL_TRIANGLE_STRIP take.
+//
+
+int inMakeAxisSphereStrips( int im, int jm, struct in_shell_s *sh,
+                            unsigned int restart, int num_threads )
+{
+   return inSphereIndexedmt( im, jm, sh, 1, restart, num_threads );
+}
+
+
+//
+// Spheres of nearly uniform triangles. The axis sphere puts most of its
+// triangles near the poles, where the bands of quads shrink, while a
+// subdivided icosahedron and a cube with its faces projected onto the sphere
+// spread them evenly; they approximate the sphere as well (by the largest
+// distance of a triangle from it) with fewer triangles. Both make shared
+// vertices in the interleaved layout of shell 3 (with the texels and colour
+// that the axis sphere has at the same place) and the indices of triangles
+// that wind as those of shell 4. Vertices on the seam of the texture (where
+// "s" wraps from 1 to 0) are doubled for the triangles that cross it, and a
+// vertex on a pole is given to each of its triangles with the "s" of the
+// triangle, such that no triangle is stretched over the texture.
+//
+
+struct in_sphere_mesh_s {
+   int nv, maxv;
+   float *xx;                      // vertices (12 floats each)
+   int ni, maxi;
+   unsigned int *ui;               // indices of triangles
+};
+
+static int inSphereMeshGrow( struct in_sphere_mesh_s *m, int nv, int ni )
+{
+   if( nv > m->maxv ) {
+      float* p = (float*) realloc( m->xx, ((size_t) nv)*12*sizeof(float) );
+      if( p == NULL ) return 1;
+      m->xx = p;
+      m->maxv = nv;
+   }
+   if( ni > m->maxi ) {
+      unsigned int* p = (unsigned int*)
+                    realloc( m->ui, ((size_t) ni)*sizeof(unsigned int) );
+      if( p == NULL ) return 1;
+      m->ui = p;
+      m->maxi = ni;
+   }
+   return 0;
+}
+
+//
+// a vertex on the unit sphere along a direction (which is normalized here)
+//
+static unsigned int inSphereVertex( struct in_sphere_mesh_s *m,
+                                    double x, double y, double z )
+{
+   double pi = acos(-1.0);
+   double r = sqrt( x*x + y*y + z*z );
+   x /= r; y /= r; z /= r;
+
+   // the angle around the axis and the azimuth from the axis (as in the
+   // tables of the axis sphere)
+   double ksi = atan2( z, x ) / (2.0*pi);
+   if( ksi < 0.0 ) ksi += 1.0;
+   double cz = y;
+   double sz = sqrt( fmax( 1.0 - y*y, 0.0 ) );
+
+   float* xx = &( m->xx[ ((size_t) m->nv)*12 ] );
+   // vertex position and normal
+   xx[0] = (float) x;
+   xx[1] = (float) y;
+   xx[2] = (float) z;
+   xx[3] = xx[0];
+   xx[4] = xx[1];
+   xx[5] = xx[2];
+   // texel
+   xx[6] = (float) ksi;
+   xx[7] = (float) ( 1.0 - acos( fmax( fmin( y, 1.0 ), -1.0 ) )/pi );
+   // colour has latitudinal variations
+   xx[8]  = (float) (sz * sz);
+   xx[9]  = (float) (2.0 * sz * cz);
+   xx[10] = (float) (cz * cz);
+   xx[11] = 1.0; // full alpha (opaque)
+
+   return (unsigned int) ( m->nv++ );
+}
+
+//
+// a triangle that winds as those of shell 4 (clockwise seen from outside)
+//
+static void inSphereTriangle( struct in_sphere_mesh_s *m,
+                              unsigned int a, unsigned int b, unsigned int c )
+{
+   const float *pa = &( m->xx[ ((size_t) a)*12 ] );
+   const float *pb = &( m->xx[ ((size_t) b)*12 ] );
+   const float *pc = &( m->xx[ ((size_t) c)*12 ] );
+   float u[3], v[3];
+   for(int k=0;k<3;++k) { u[k] = pb[k] - pa[k]; v[k] = pc[k] - pa[k]; }
+   float d = ( u[1]*v[2] - u[2]*v[1] ) * ( pa[0] + pb[0] + pc[0] ) +
+             ( u[2]*v[0] - u[0]*v[2] ) * ( pa[1] + pb[1] + pc[1] ) +
+             ( u[0]*v[1] - u[1]*v[0] ) * ( pa[2] + pb[2] + pc[2] );
+
+   unsigned int* ic = &( m->ui[ m->ni ] );
+   ic[0] = a;
+   ic[1] = ( d > 0.0f ) ? c : b;
+   ic[2] = ( d > 0.0f ) ? b : c;
+   m->ni += 3;
+}
+
+//
+// the texels "s" of the corners of a triangle, which corners are on a pole,
+// and the span of "s" over the corners that are not
+//
+static void inSphereSeamSpan( const struct in_sphere_mesh_s *m,
+                              const unsigned int *ic, float *s, int *ipole,
+                              float *smin, float *smax )
+{
+   *smin = 1.0f;
+   *smax = 0.0f;
+   for(int k=0;k<3;++k) {
+      const float* xx = &( m->xx[ ((size_t) ic[k])*12 ] );
+      s[k] = xx[6];
+      ipole[k] = ( fabsf( xx[1] ) >= 1.0f );
+      if( ipole[k] ) continue;
+      *smin = fminf( *smin, s[k] );
+      *smax = fmaxf( *smax, s[k] );
+   }
+}
+
+//
+// doubles the vertices of the seam and of the poles (see above)
+//
+static int inSphereSeam( struct in_sphere_mesh_s *m )
+{
+   int nv = m->nv;
+   int* idup = (int*) malloc( ((size_t) nv)*sizeof(int) );
+   if( idup == NULL ) return 1;
+   for(int n=0;n<nv;++n) idup[n] = -1;
+
+   // count the vertices to be added; at most one per corner
+   int nadd = 0;
+   for(int n=0;n<m->ni;n+=3) {
+      float s[3], smin, smax;
+      int ipole[3];
+      inSphereSeamSpan( m, &( m->ui[n] ), s, ipole, &smin, &smax );
+      for(int k=0;k<3;++k) {
+         if( ipole[k] || ( smax - smin > 0.5f && s[k] < 0.5f ) ) ++nadd;
+      }
+   }
+   if( inSphereMeshGrow( m, nv + nadd, m->ni ) ) {
+      free( idup );
+      return 1;
+   }
+
+   for(int n=0;n<m->ni;n+=3) {
+      unsigned int* ic = &( m->ui[n] );
+      float s[3], smin, smax;
+      int ipole[3];
+      inSphereSeamSpan( m, ic, s, ipole, &smin, &smax );
+
+      // the seam; these are shared by the triangles that cross it
+      for(int k=0;k<3 && smax - smin > 0.5f;++k) {
+         if( ipole[k] || s[k] >= 0.5f ) continue;
+         if( idup[ ic[k] ] < 0 ) {
+            float* xx = &( m->xx[ ((size_t) m->nv)*12 ] );
+            memcpy( xx, &( m->xx[ ((size_t) ic[k])*12 ] ), 12*sizeof(float) );
+            xx[6] += 1.0f;
+            idup[ ic[k] ] = m->nv++;
+         }
+         ic[k] = (unsigned int) idup[ ic[k] ];
+         s[k] += 1.0f;
+      }
+
+      // the poles; one per triangle
+      for(int k=0;k<3;++k) {
+         if( !ipole[k] ) continue;
+         float* xx = &( m->xx[ ((size_t) m->nv)*12 ] );
+         memcpy( xx, &( m->xx[ ((size_t) ic[k])*12 ] ), 12*sizeof(float) );
+         xx[6] = 0.5f*( s[(k+1)%3] + s[(k+2)%3] );
+         ic[k] = (unsigned int) ( m->nv++ );
+      }
+   }
+
+   free( idup );
+   return 0;
+}
+
+static void inSphereMeshFree( struct in_sphere_mesh_s *m )
+{
+   if( m->xx != NULL ) free( m->xx );
+   if( m->ui != NULL ) free( m->ui );
+   memset( m, 0, sizeof(struct in_sphere_mesh_s) );
+}
+
+//
+// the finished mesh goes to a shell (of the size it ended up with)
+//
+static int inSphereMeshShell( struct in_sphere_mesh_s *m,
+                              struct in_shell_s *sh )
+{
+   static const int ncomp[4] = { 3, 3, 2, 4 };   // pos., normal, texel, RGBA
+   int ierr = inShellAlloc( sh, IN_SHELL_AOS, IN_SHELL_FLOAT,
+                            (size_t) m->nv, ncomp, (size_t) m->ni );
+   if( ierr == 0 ) {
+      memcpy( sh->x, m->xx, ((size_t) m->nv)*12*sizeof(float) );
+      memcpy( sh->ie, m->ui, ((size_t) m->ni)*sizeof(unsigned int) );
+   }
+   inSphereMeshFree( m );
+   return ierr;
+}
+
+//
+// the midpoint of an edge of the previous level, found in (or added to) a
+// table of edges with open addressing
+//
+static unsigned int inSphereMidpoint( struct in_sphere_mesh_s *m,
+                                      uint64_t *key, unsigned int *val,
+                                      size_t mask,
+                                      unsigned int a, unsigned int b )
+{
+   if( a > b ) { unsigned int t = a; a = b; b = t; }
+   uint64_t k = ( ((uint64_t) a) << 32 | (uint64_t) b ) + 1;
+   size_t h = (size_t) ( ( k * 0x9e3779b97f4a7c15ull ) >> 20 ) & mask;
+   while( key[h] != 0 ) {
+      if( key[h] == k ) return val[h];
+      h = ( h + 1 ) & mask;
+   }
+
+   const float *pa = &( m->xx[ ((size_t) a)*12 ] );
+   const float *pb = &( m->xx[ ((size_t) b)*12 ] );
+   key[h] = k;
+   val[h] = inSphereVertex( m, (double) pa[0] + (double) pb[0],
+                               (double) pa[1] + (double) pb[1],
+                               (double) pa[2] + (double) pb[2] );
+   return val[h];
+}
+
+//
+// Function that makes an icosahedron subdivided "level" times (every triangle
+// becomes four); it has 20*4^level triangles and 10*4^level + 2 vertices
+// (and a few more on the seam and at the poles)
+//
+
+int inMakeIcoSphere( int level, struct in_shell_s *sh )
+{
+   if( level < 0 || level > 10 ) {
+      fprintf( stdout," Error: icosphere level %d is out of range \n", level );
+      return 2;
+   }
+
+   struct in_sphere_mesh_s m;
+   memset( &m, 0, sizeof(struct in_sphere_mesh_s) );
+   int nv = 10*(1 << (2*level)) + 2;
+   int nt = 20*(1 << (2*level));
+   size_t ne = 30*((size_t) 1 << (2*level));   // edges of the finest level
+   size_t nh = 1;
+   while( nh < 2*ne ) nh *= 2;
+   uint64_t* key = (uint64_t*) malloc( nh*sizeof(uint64_t) );
+   unsigned int* val = (unsigned int*) malloc( nh*sizeof(unsigned int) );
+   unsigned int* tmp = (unsigned int*) malloc( 3*((size_t) nt)*sizeof(int) );
+   if( key == NULL || val == NULL || tmp == NULL ||
+       inSphereMeshGrow( &m, nv, 3*nt ) ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      if( key != NULL ) free( key );
+      if( val != NULL ) free( val );
+      if( tmp != NULL ) free( tmp );
+      inSphereMeshFree( &m );
+      return 1;
+   }
+
+   double g = 0.5*(1.0 + sqrt(5.0));
+   static const signed char iv[12][3] = {
+      {-1, 1, 0}, { 1, 1, 0}, {-1,-1, 0}, { 1,-1, 0},
+      { 0,-1, 1}, { 0, 1, 1}, { 0,-1,-1}, { 0, 1,-1},
+      { 1, 0,-1}, { 1, 0, 1}, {-1, 0,-1}, {-1, 0, 1} };
+   static const unsigned char it[20][3] = {
+      {0,11,5}, {0,5,1}, {0,1,7}, {0,7,10}, {0,10,11},
+      {1,5,9}, {5,11,4}, {11,10,2}, {10,7,6}, {7,1,8},
+      {3,9,4}, {3,4,2}, {3,2,6}, {3,6,8}, {3,8,9},
+      {4,9,5}, {2,4,11}, {6,2,10}, {8,6,7}, {9,8,1} };
+   for(int n=0;n<12;++n) {
+      // the golden ratio goes with the non-zero coordinate after the unit one
+      double c[3];
+      for(int k=0;k<3;++k) {
+         c[k] = (double) iv[n][k];
+         if( iv[n][k] != 0 && iv[n][(k+2)%3] != 0 ) c[k] *= g;
+      }
+      (void) inSphereVertex( &m, c[0], c[1], c[2] );
+   }
+   for(int n=0;n<20;++n) inSphereTriangle( &m, it[n][0], it[n][1], it[n][2] );
+
+   // every level splits the triangles of the one before at the midpoints of
+   // their edges; the winding is kept by the order of the corners
+   for(int l=0;l<level;++l) {
+      memset( key, 0, nh*sizeof(uint64_t) );
+      int ni = m.ni;
+      memcpy( tmp, m.ui, ((size_t) ni)*sizeof(unsigned int) );
+      m.ni = 0;
+      for(int n=0;n<ni;n+=3) {
+         unsigned int a = tmp[n], b = tmp[n+1], c = tmp[n+2];
+         unsigned int ab = inSphereMidpoint( &m, key, val, nh-1, a, b );
+         unsigned int bc = inSphereMidpoint( &m, key, val, nh-1, b, c );
+         unsigned int ca = inSphereMidpoint( &m, key, val, nh-1, c, a );
+         unsigned int* ic = &( m.ui[ m.ni ] );
+         ic[0] = a;  ic[1] = ab; ic[2] = ca;
+         ic[3] = ab; ic[4] = b;  ic[5] = bc;
+         ic[6] = ca; ic[7] = bc; ic[8] = c;
+         ic[9] = ab; ic[10] = bc; ic[11] = ca;
+         m.ni += 12;
+      }
+   }
+   free( key );
+   free( val );
+   free( tmp );
+
+   if( inSphereSeam( &m ) ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      inSphereMeshFree( &m );
+      return 1;
+   }
+   return inSphereMeshShell( &m, sh );
+}
+
+//
+// Function that makes a cube of "n" by "n" quads per face projected onto the
+// sphere; it has 12*n^2 triangles and 6*(n+1)^2 vertices (the edges of the
+// faces are not shared; a few more are on the seam and at the poles). The
+// points of the cube are moved with the mapping that keeps the areas of the
+// quads nearly equal, rather than along the rays from the centre (which
+// crowds the quads at the corners of the faces). Quads are split along their
+// shorter diagonal.
+//
+
+int inMakeCubeSphere( int n, struct in_shell_s *sh )
+{
+   if( n < 1 || n > 2048 ) {
+      fprintf( stdout," Error: cube-sphere of %d quads is out of range \n", n );
+      return 2;
+   }
+
+   struct in_sphere_mesh_s m;
+   memset( &m, 0, sizeof(struct in_sphere_mesh_s) );
+   if( inSphereMeshGrow( &m, 6*(n+1)*(n+1), 6*2*3*n*n ) ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      inSphereMeshFree( &m );
+      return 1;
+   }
+
+   for(int f=0;f<6;++f) {
+      // the face is normal to axis "k" on the side "sgn"; "a" and "b" are
+      // the other two axes
+      int k = f/2, ka = (k+1)%3, kb = (k+2)%3;
+      double sgn = ( f & 1 ) ? -1.0 : 1.0;
+      unsigned int n0 = (unsigned int) m.nv;
+      for(int j=0;j<=n;++j) {
+         for(int i=0;i<=n;++i) {
+            // (integers over "n" make the same numbers on the neighbour face)
+            double c[3], p[3];
+            c[k]  = sgn;
+            c[ka] = ((double) (2*i - n)) / ((double) n);
+            c[kb] = ((double) (2*j - n)) / ((double) n);
+            for(int l=0;l<3;++l) {
+               double c1 = c[(l+1)%3]*c[(l+1)%3], c2 = c[(l+2)%3]*c[(l+2)%3];
+               p[l] = c[l] * sqrt( 1.0 - 0.5*c1 - 0.5*c2 + c1*c2/3.0 );
+            }
+            (void) inSphereVertex( &m, p[0], p[1], p[2] );
+         }
+      }
+
+      for(int j=0;j<n;++j) {
+         for(int i=0;i<n;++i) {
+            unsigned int q[4];
+            q[0] = n0 + (unsigned int) ( j*(n+1) + i );
+            q[1] = q[0] + 1;
+            q[2] = q[0] + (unsigned int) (n+1);
+            q[3] = q[2] + 1;
+            const float *p0 = &( m.xx[ ((size_t) q[0])*12 ] );
+            const float *p1 = &( m.xx[ ((size_t) q[1])*12 ] );
+            const float *p2 = &( m.xx[ ((size_t) q[2])*12 ] );
+            const float *p3 = &( m.xx[ ((size_t) q[3])*12 ] );
+            float d03 = 0.0f, d12 = 0.0f;
+            for(int l=0;l<3;++l) {
+               d03 += ( p3[l] - p0[l] )*( p3[l] - p0[l] );
+               d12 += ( p2[l] - p1[l] )*( p2[l] - p1[l] );
+            }
+            if( d03 <= d12 ) {
+               inSphereTriangle( &m, q[0], q[1], q[3] );
+               inSphereTriangle( &m, q[0], q[3], q[2] );
+            } else {
+               inSphereTriangle( &m, q[0], q[1], q[2] );
+               inSphereTriangle( &m, q[1], q[3], q[2] );
+            }
+         }
+      }
+   }
+
+   if( inSphereSeam( &m ) ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      inSphereMeshFree( &m );
+      return 1;
+   }
+   return inSphereMeshShell( &m, sh );
+}
+
+
+//
+// Binary dumps of the shells for TecPlot (".plt", version 112) and ParaView
+// (VTK XML with the data appended raw; a ".vts" structured grid for shell 1
+// and ".vtp" polygonal data for the others). The ASCII dumps above format
+// every value with a call to "fprintf()"; these gather values in a large
+// buffer that goes to the file with few "write()" calls, and values are not
+// formatted. A dump can also be made by a thread of its own, such that it
+// overlaps other work: pass a job to the dump function and wait for it with
+// "inDumpWait()"; the shell must not change (or be freed) until then.
+//
+
+#define IN_DUMP_PLT      1       // TecPlot binary
+#define IN_DUMP_VTK      2       // VTK XML with appended raw data
+#define IN_DUMP_BUFFER   (4*1024*1024)
+
+struct in_dump_var_s {
+   const char *name;
+   const double *d;                // values are either double or float
+   const float *f;
+   size_t stride;                  // between values of consecutive nodes
+};
+
+struct in_dump_mesh_s {
+   int iformat;
+   char *fname;
+   int im, jm;                     // an ordered zone (node "i*jm + j") if
+   int iordered;                   // set, with "i" fastest in the file
+   int nn, ne;                     // nodes and triangles
+   const unsigned int *ie;         // triangles; NULL for independent ones
+   int nvar;
+   struct in_dump_var_s var[12];
+   int narr;                       // VTK arrays of consecutive variables;
+   int ncomp[4];                   // the first is the points
+   const char *aname[4];
+};
+
+struct in_dump_job_s {
+   pthread_t tid;
+   int istarted;
+   int ierr;
+   struct in_dump_mesh_s m;
+};
+
+struct in_dump_buf_s {
+   int fd;
+   int ierr;
+   size_t used;
+   char *buf;
+};
+
+static void inDumpFlush( struct in_dump_buf_s *b )
+{
+   size_t n = 0;
+   while( n < b->used && !b->ierr ) {
+      ssize_t k = write( b->fd, b->buf + n, b->used - n );
+      if( k < 0 && errno == EINTR ) continue;
+      if( k <= 0 ) b->ierr = 1;
+      else n += (size_t) k;
+   }
+   b->used = 0;
+}
+
+static void inDumpBytes( struct in_dump_buf_s *b, const void *p, size_t n )
+{
+   const char *c = (const char*) p;
+   while( n > 0 ) {
+      if( b->used == IN_DUMP_BUFFER ) inDumpFlush( b );
+      size_t k = IN_DUMP_BUFFER - b->used;
+      if( k > n ) k = n;
+      memcpy( b->buf + b->used, c, k );
+      b->used += k;
+      c += k;
+      n -= k;
+   }
+}
+
+static void inDumpI32( struct in_dump_buf_s *b, int32_t i )
+{
+   inDumpBytes( b, &i, sizeof(i) );
+}
+
+static void inDumpF32( struct in_dump_buf_s *b, float f )
+{
+   inDumpBytes( b, &f, sizeof(f) );
+}
+
+static void inDumpF64( struct in_dump_buf_s *b, double d )
+{
+   inDumpBytes( b, &d, sizeof(d) );
+}
+
+static void inDumpU64( struct in_dump_buf_s *b, uint64_t u )
+{
+   inDumpBytes( b, &u, sizeof(u) );
+}
+
+// (TecPlot strings are a 32-bit integer per character, and a terminating 0)
+static void inDumpString( struct in_dump_buf_s *b, const char *s )
+{
+   do { inDumpI32( b, (int32_t) *s ); } while( *(s++) != '\0' );
+}
+
+static void inDumpText( struct in_dump_buf_s *b, const char *fmt, ... )
+{
+   char line[512];
+   va_list ap;
+   va_start( ap, fmt );
+   int n = vsnprintf( line, sizeof(line), fmt, ap );
+   va_end( ap );
+   if( n > 0 ) inDumpBytes( b, line, (size_t) n < sizeof(line) ?
+                                     (size_t) n : sizeof(line)-1 );
+}
+
+//
+// node "p" in the order of the file
+//
+static size_t inDumpNode( const struct in_dump_mesh_s *m, size_t p )
+{
+   if( !m->iordered ) return p;
+   size_t i = p % (size_t) m->im;
+   size_t j = p / (size_t) m->im;
+   return i*((size_t) m->jm) + j;
+}
+
+//
+// values of "nc" consecutive variables, interleaved per node, in their type
+//
+static void inDumpValues( struct in_dump_buf_s *b,
+                          const struct in_dump_mesh_s *m, int iv, int nc )
+{
+   char tmp[8*1024];
+   size_t k = 0;
+   for(size_t p=0;p<(size_t) m->nn;++p) {
+      size_t n = inDumpNode( m, p );
+      for(int c=0;c<nc;++c) {
+         const struct in_dump_var_s *v = &( m->var[iv+c] );
+         if( v->d != NULL ) {
+            memcpy( tmp + k, &( v->d[ n*v->stride ] ), sizeof(double) );
+            k += sizeof(double);
+         } else {
+            memcpy( tmp + k, &( v->f[ n*v->stride ] ), sizeof(float) );
+            k += sizeof(float);
+         }
+      }
+      if( k > sizeof(tmp) - 4*sizeof(double) ) {
+         inDumpBytes( b, tmp, k );
+         k = 0;
+      }
+   }
+   inDumpBytes( b, tmp, k );
+}
+
+//
+// the triangles (zero-based) or, for VTK, their offsets
+//
+static void inDumpTriangles( struct in_dump_buf_s *b,
+                             const struct in_dump_mesh_s *m, int ioffsets )
+{
+   int32_t tmp[3*1024];
+   size_t k = 0;
+   for(int n=0;n<m->ne;++n) {
+      if( ioffsets ) {
+         tmp[k++] = 3*(n+1);
+      } else if( m->ie != NULL ) {
+         tmp[k++] = m->ie[3*n];
+         tmp[k++] = m->ie[3*n+1];
+         tmp[k++] = m->ie[3*n+2];
+      } else {
+         tmp[k++] = 3*n;
+         tmp[k++] = 3*n+1;
+         tmp[k++] = 3*n+2;
+      }
+      if( k > 3*1024 - 3 ) {
+         inDumpBytes( b, tmp, k*sizeof(int32_t) );
+         k = 0;
+      }
+   }
+   inDumpBytes( b, tmp, k*sizeof(int32_t) );
+}
+
+static void inDumpPLT( struct in_dump_buf_s *b, const struct in_dump_mesh_s *m )
+{
+   // header section
+   inDumpBytes( b, "#!TDV112", 8 );
+   inDumpI32( b, 1 );                  // byte order
+   inDumpI32( b, 0 );                  // full file (grid and solution)
+   inDumpString( b, "sphere shell" );
+   inDumpI32( b, m->nvar );
+   for(int iv=0;iv<m->nvar;++iv) inDumpString( b, m->var[iv].name );
+
+   inDumpF32( b, 299.0f );             // zone marker
+   inDumpString( b, "sphere shell" );
+   inDumpI32( b, -1 );                 // parent zone
+   inDumpI32( b, -1 );                 // strand (static zone)
+   inDumpF64( b, 0.0 );                // solution time
+   inDumpI32( b, -1 );                 // (not used)
+   inDumpI32( b, m->iordered ? 0 : 2 );   // ordered or FE-triangle
+   inDumpI32( b, 0 );                  // all variables at the nodes
+   inDumpI32( b, 0 );                  // no face neighbours
+   inDumpI32( b, 0 );                  // no user face connections
+   if( m->iordered ) {
+      inDumpI32( b, m->im );
+      inDumpI32( b, m->jm );
+      inDumpI32( b, 1 );
+   } else {
+      inDumpI32( b, m->nn );
+      inDumpI32( b, m->ne );
+      inDumpI32( b, 0 );
+      inDumpI32( b, 0 );
+      inDumpI32( b, 0 );
+   }
+   inDumpI32( b, 0 );                  // no auxiliary data
+   inDumpF32( b, 357.0f );             // end of header
+
+   // data section (always in blocks of one variable)
+   inDumpF32( b, 299.0f );
+   for(int iv=0;iv<m->nvar;++iv) inDumpI32( b, m->var[iv].d != NULL ? 2 : 1 );
+   inDumpI32( b, 0 );                  // no passive variables
+   inDumpI32( b, 0 );                  // no variable sharing
+   inDumpI32( b, -1 );                 // no connectivity sharing
+   for(int iv=0;iv<m->nvar;++iv) {
+      const struct in_dump_var_s *v = &( m->var[iv] );
+      double vmin = 0.0, vmax = 0.0;
+      for(size_t n=0;n<(size_t) m->nn;++n) {
+         double d = ( v->d != NULL ) ? v->d[ n*v->stride ] :
+                                       (double) v->f[ n*v->stride ];
+         if( n == 0 || d < vmin ) vmin = d;
+         if( n == 0 || d > vmax ) vmax = d;
+      }
+      inDumpF64( b, vmin );
+      inDumpF64( b, vmax );
+   }
+   for(int iv=0;iv<m->nvar;++iv) inDumpValues( b, m, iv, 1 );
+   if( !m->iordered ) inDumpTriangles( b, m, 0 );
+}
+
+static void inDumpVTK( struct in_dump_buf_s *b, const struct in_dump_mesh_s *m )
+{
+   uint16_t one = 1;
+   const char *order = ( *((const char*) &one) == 1 ) ?
+                       "LittleEndian" : "BigEndian";
+   const char *kind = m->iordered ? "StructuredGrid" : "PolyData";
+
+   inDumpText( b, "<?xml version=\"1.0\"?>\n" );
+   inDumpText( b, "<VTKFile type=\"%s\" version=\"1.0\" byte_order=\"%s\" "
+                  "header_type=\"UInt64\">\n", kind, order );
+   if( m->iordered ) {
+      inDumpText( b, " <StructuredGrid WholeExtent=\"0 %d 0 %d 0 0\">\n",
+                  m->im-1, m->jm-1 );
+      inDumpText( b, "  <Piece Extent=\"0 %d 0 %d 0 0\">\n", m->im-1, m->jm-1 );
+   } else {
+      inDumpText( b, " <PolyData>\n" );
+      inDumpText( b, "  <Piece NumberOfPoints=\"%d\" NumberOfVerts=\"0\" "
+                     "NumberOfLines=\"0\" NumberOfStrips=\"0\" "
+                     "NumberOfPolys=\"%d\">\n", m->nn, m->ne );
+   }
+
+   // the arrays are described in the order that they are appended
+   uint64_t off = 0;
+   uint64_t size[4];
+   for(int ia=0,iv=0;ia<m->narr;iv+=m->ncomp[ia],++ia) {
+      int id = ( m->var[iv].d != NULL );
+      size[ia] = ((uint64_t) m->nn) * ((uint64_t) m->ncomp[ia]) *
+                 ( id ? sizeof(double) : sizeof(float) );
+      if( ia == 0 ) {
+         inDumpText( b, "   <Points>\n" );
+      } else if( ia == 1 ) {
+         inDumpText( b, "   <PointData>\n" );
+      }
+      inDumpText( b, "    <DataArray type=\"%s\" Name=\"%s\" "
+                     "NumberOfComponents=\"%d\" format=\"appended\" "
+                     "offset=\"%llu\"/>\n", id ? "Float64" : "Float32",
+                  m->aname[ia], m->ncomp[ia], (unsigned long long) off );
+      if( ia == 0 ) inDumpText( b, "   </Points>\n" );
+      if( ia > 0 && ia == m->narr-1 ) inDumpText( b, "   </PointData>\n" );
+      off += sizeof(uint64_t) + size[ia];
+   }
+   if( !m->iordered ) {
+      inDumpText( b, "   <Polys>\n" );
+      inDumpText( b, "    <DataArray type=\"Int32\" Name=\"connectivity\" "
+                     "format=\"appended\" offset=\"%llu\"/>\n",
+                  (unsigned long long) off );
+      off += sizeof(uint64_t) + 3*((uint64_t) m->ne)*sizeof(int32_t);
+      inDumpText( b, "    <DataArray type=\"Int32\" Name=\"offsets\" "
+                     "format=\"appended\" offset=\"%llu\"/>\n",
+                  (unsigned long long) off );
+      inDumpText( b, "   </Polys>\n" );
+   }
+   inDumpText( b, "  </Piece>\n" );
+   inDumpText( b, " </%s>\n", kind );
+
+   inDumpText( b, " <AppendedData encoding=\"raw\">\n_" );
+   for(int ia=0,iv=0;ia<m->narr;iv+=m->ncomp[ia],++ia) {
+      inDumpU64( b, size[ia] );
+      inDumpValues( b, m, iv, m->ncomp[ia] );
+   }
+   if( !m->iordered ) {
+      inDumpU64( b, 3*((uint64_t) m->ne)*sizeof(int32_t) );
+      inDumpTriangles( b, m, 0 );
+      inDumpU64( b, ((uint64_t) m->ne)*sizeof(int32_t) );
+      inDumpTriangles( b, m, 1 );
+   }
+   inDumpText( b, "\n </AppendedData>\n" );
+   inDumpText( b, "</VTKFile>\n" );
+}
+
+static int inDumpMesh( const struct in_dump_mesh_s *m )
+{
+   struct in_dump_buf_s b;
+   b.ierr = 0;
+   b.used = 0;
+   b.buf = (char*) malloc( IN_DUMP_BUFFER );
+   if( b.buf == NULL ) {
+      fprintf( stdout," Error: could not allocate arrays \n" );
+      return 1;
+   }
+   b.fd = open( m->fname, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+   if( b.fd < 0 ) {
+      fprintf( stdout, " Error: could not create file \"%s\" \n", m->fname );
+      free( b.buf );
+      return 1;
+   }
+
+   if( m->iformat == IN_DUMP_PLT ) {
+      inDumpPLT( &b, m );
+   } else {
+      inDumpVTK( &b, m );
+   }
+   inDumpFlush( &b );
+   if( close( b.fd ) != 0 ) b.ierr = 1;
+   if( b.ierr ) {
+      fprintf( stdout, " Error: could not write file \"%s\" \n", m->fname );
+   }
+
+   free( b.buf );
+   return b.ierr;
+}
+
+static void* inDumpThread( void *arg )
+{
+   struct in_dump_job_s *job = (struct in_dump_job_s*) arg;
+   job->ierr = inDumpMesh( &( job->m ) );
+   return NULL;
+}
+
+//
+// dumps the mesh now, or with a thread if there is a job (which keeps a copy
+// of the description and of the name); a thread that cannot be started is
+// replaced by dumping now
+//
+static int inDumpRun( struct in_dump_mesh_s *m, const char *fname, int iformat,
+                      struct in_dump_job_s *job )
+{
+   if( iformat != IN_DUMP_PLT && iformat != IN_DUMP_VTK ) {
+      fprintf( stdout, " Error: unknown dump format %d \n", iformat );
+      return 2;
+   }
+   m->iformat = iformat;
+
+   if( job == NULL ) {
+      m->fname = (char*) fname;
+      return inDumpMesh( m );
+   }
+
+   job->istarted = 0;
+   job->ierr = 0;
+   job->m = *m;
+   job->m.fname = strdup( fname );
+   if( job->m.fname == NULL ) return 1;
+   if( pthread_create( &( job->tid ), NULL, inDumpThread, (void*) job ) == 0 ) {
+      job->istarted = 1;
+   } else {
+      (void) inDumpThread( (void*) job );
+   }
+   return 0;
+}
+
+//
+// Function to wait for a dump that is made by a thread; returns its status
+//
+
+int inDumpWait( struct in_dump_job_s *job )
+{
+   if( job->istarted ) pthread_join( job->tid, NULL );
+   job->istarted = 0;
+   if( job->m.fname != NULL ) free( job->m.fname );
+   job->m.fname = NULL;
+   return job->ierr;
+}
+
+static void inDumpVar( struct in_dump_mesh_s *m, const char *name,
+                       const double *d, const float *f, size_t stride )
+{
+   struct in_dump_var_s *v = &( m->var[ m->nvar++ ] );
+   v->name = name;
+   v->d = d;
+   v->f = f;
+   v->stride = stride;
+}
+
+//
+// the variables of the nodes, which are the components of a shell
+//
+static void inDumpNodesShell( struct in_dump_mesh_s *m,
+                              const struct in_shell_s *sh )
+{
+   static const char *names[12] = { "x", "y", "z", "u", "v", "w", "s", "t",
+                                    "R", "G", "B", "A" };
+   static const char *anames[4] = { "points", "normal", "texel", "color" };
+   static const int ifirst[4] = { 0, 3, 6, 8 }, nmax[4] = { 3, 3, 2, 4 };
+
+   memset( m, 0, sizeof(struct in_dump_mesh_s) );
+   m->nn = (int) sh->nv;
+   for(int k=0;k<4;++k) {
+      for(int c=0;c<sh->ncomp[k] && c < nmax[k];++c) {
+         const void *p = inShellComp( sh, sh->moff[k] + c );
+         if( sh->type == IN_SHELL_DOUBLE ) {
+            inDumpVar( m, names[ ifirst[k] + c ], (const double*) p, NULL,
+                       inShellStep( sh ) );
+         } else {
+            inDumpVar( m, names[ ifirst[k] + c ], NULL, (const float*) p,
+                       inShellStep( sh ) );
+         }
+      }
+      if( sh->ncomp[k] == 0 ) continue;
+      m->ncomp[ m->narr ] = sh->ncomp[k];
+      m->aname[ m->narr ] = anames[k];
+      ++( m->narr );
+   }
+}
+
+//
+// Function to dump the structured manifold (shell 1) in binary
+//
+
+int inDumpShell1( const char *fname, int iformat, int im, int jm,
+                  const struct in_shell_s *sh, struct in_dump_job_s *job )
+{
+   struct in_dump_mesh_s m;
+   inDumpNodesShell( &m, sh );
+   m.im = im;
+   m.jm = jm;
+   m.iordered = 1;
+   return inDumpRun( &m, fname, iformat, job );
+}
+
+//
+// Function to dump a shell of triangles with indices (shells 2 and 4, and the
+// icosphere and cube-sphere) in binary
+//
+
+int inDumpShell2( const char *fname, int iformat,
+                  const struct in_shell_s *sh, struct in_dump_job_s *job )
+{
+   if( sh->ie == NULL || sh->istrip ) {
+      fprintf( stdout, " Error: the shell has no indexed triangles \n" );
+      return 2;
+   }
+   struct in_dump_mesh_s m;
+   inDumpNodesShell( &m, sh );
+   m.ne = (int) (sh->ni/3);
+   m.ie = sh->ie;
+   return inDumpRun( &m, fname, iformat, job );
+}
+
+//
+// Function to dump the GL-rendering formatted data (shell 3) in binary
+//
+
+int inDumpShell3( const char *fname, int iformat,
+                  const struct in_shell_s *sh, struct in_dump_job_s *job )
+{
+   struct in_dump_mesh_s m;
+   inDumpNodesShell( &m, sh );
+   m.ne = (int) (sh->nv/3);
+   return inDumpRun( &m, fname, iformat, job );
+}
+
+
+// Compile this file with "-DMAIN" to run it standalone
+#ifdef _DRIVER_
+#include <time.h>
+
+static double inBenchSeconds( void )
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (double) ts.tv_sec + 1.0e-9 * (double) ts.tv_nsec;
+}
+
+//
+// whether two shells hold the same values, byte for byte
+//
+static int inBenchShellSame( const struct in_shell_s *a,
+                             const struct in_shell_s *b )
+{
+   if( a->layout != b->layout || a->type != b->type || a->nv != b->nv ||
+       a->nglm != b->nglm || a->ni != b->ni ) return 0;
+   size_t isize = ( a->type == IN_SHELL_DOUBLE ) ? sizeof(double) :
+                                                   sizeof(float);
+   size_t nb = a->nv*isize;
+   int nc = 1;
+   if( a->layout == IN_SHELL_AOS ) nb *= (size_t) a->nglm; else nc = a->nglm;
+   for(int c=0;c<nc;++c) {
+      if( memcmp( inShellComp( a, c ), inShellComp( b, c ), nb ) ) return 0;
+   }
+   if( a->ni > 0 && memcmp( a->ie, b->ie, a->ni*sizeof(unsigned int) ) ) {
+      return 0;
+   }
+   return 1;
+}
+
+//
+// Benchmark of the table-driven parallel generators against the original
+// ones; the outputs are compared byte for byte
+// (Run as "./a.out bench [im jm threads]".)
+//
+
+int inBenchAxisSphere( int im, int jm, int num_threads )
+{
+   struct in_shell_s sh, sh2;
+   size_t isize = ((size_t) im)*((size_t) jm);
+   double c0, c1, c2;
+   int idiff;
+
+   fprintf( stdout, " Sphere of %d x %d nodes (%zu), %d threads \n",
+            im, jm, isize, num_threads );
+
+   c0 = inBenchSeconds();
+   if( inMakeAxisSphereshell1( im, jm, &sh ) ) return 1;
+   c1 = inBenchSeconds();
+   if( inMakeAxisSphereshell1mt( im, jm, &sh2, num_threads ) ) return 1;
+   c2 = inBenchSeconds();
+   idiff = !inBenchShellSame( &sh, &sh2 );
+   fprintf( stdout, "  shell 1: %9.4lf s  tables: %9.4lf s  (x%.1lf) %s \n",
+            c1-c0, c2-c1, (c1-c0)/(c2-c1), idiff ? "DIFFERENT" : "same" );
+   inShellFree( &sh ); inShellFree( &sh2 );
+
+   c0 = inBenchSeconds();
+   if( inMakeAxisSphereshell2( im, jm, &sh ) ) return 1;
+   c1 = inBenchSeconds();
+   if( inMakeAxisSphereshell2mt( im, jm, &sh2, num_threads ) ) return 1;
+   c2 = inBenchSeconds();
+   idiff = !inBenchShellSame( &sh, &sh2 );
+   fprintf( stdout, "  shell 2: %9.4lf s  tables: %9.4lf s  (x%.1lf) %s \n",
+            c1-c0, c2-c1, (c1-c0)/(c2-c1), idiff ? "DIFFERENT" : "same" );
+   inShellFree( &sh ); inShellFree( &sh2 );
+
+   size_t nf = 3 * (size_t) ( 2*(im-1)*(jm-1 -2) + 2*(im-1) ) * 12;
+   c0 = inBenchSeconds();
+   if( inMakeAxisSphereshell3( im, jm, &sh ) ) return 1;
+   c1 = inBenchSeconds();
+   if( inMakeAxisSphereshell3mt( im, jm, &sh2, num_threads ) ) return 1;
+   c2 = inBenchSeconds();
+   idiff = !inBenchShellSame( &sh, &sh2 );
+   fprintf( stdout, "  shell 3: %9.4lf s  tables: %9.4lf s  (x%.1lf) %s \n",
+            c1-c0, c2-c1, (c1-c0)/(c2-c1), idiff ? "DIFFERENT" : "same" );
+   inShellFree( &sh ); inShellFree( &sh2 );
+
+   // shared vertices with indices (the size is what goes to the GL)
+   c0 = inBenchSeconds();
+   if( inMakeAxisSphereIndexed( im, jm, &sh, num_threads ) ) return 1;
+   c1 = inBenchSeconds();
+   if( inMakeAxisSphereStrips( im, jm, &sh2, 0xffffffffu,
+                               num_threads ) ) return 1;
+   c2 = inBenchSeconds();
+   fprintf( stdout, "  indexed: %9.4lf s  strips: %9.4lf s \n", c1-c0, c2-c1 );
+   fprintf( stdout, "  bytes: shell 3 %zu  indexed %zu  strips %zu \n",
+            nf*sizeof(float),
+            isize*12*sizeof(float) + sh.ni*sizeof(unsigned int),
+            isize*12*sizeof(float) + sh2.ni*sizeof(unsigned int) );
+   inShellFree( &sh ); inShellFree( &sh2 );
+
+   return 0;
+}
+
+//
+// Benchmark of the conversions between layouts and types against casting
+// every element; the results are compared value for value
+// (Run as "./a.out convert [im jm]".)
+//
+
+int inBenchShellConvert( int im, int jm )
+{
+   static const int ilay[2] = { IN_SHELL_AOS, IN_SHELL_SOA };
+   static const int ityp[2] = { IN_SHELL_FLOAT, IN_SHELL_DOUBLE };
+   static const char *names[2][2] = { { "AoS float ", "AoS double" },
+                                      { "SoA float ", "SoA double" } };
+   struct in_shell_s src, dst, ref;
+
+   // indexed vertices have all four attributes (12 components)
+   if( inMakeAxisSphereIndexed( im, jm, &ref, 0 ) ) return 1;
+   fprintf( stdout, " Conversions of %zu vertices \n", ref.nv );
+
+   for(int n=0;n<4;++n) {
+      if( inShellConvert( &src, &ref, ilay[n/2], ityp[n%2] ) ) return 1;
+      for(int m=0;m<4;++m) {
+         double c0 = inBenchSeconds();
+         if( inShellConvert( &dst, &src, ilay[m/2], ityp[m%2] ) ) return 1;
+         double c1 = inBenchSeconds();
+
+         // the same by casting every element
+         struct in_shell_s sc;
+         if( inShellAlloc( &sc, ilay[m/2], ityp[m%2], src.nv, src.ncomp,
+                           src.ni ) ) return 1;
+         for(size_t k=0;k<src.nv;++k) {
+            for(int c=0;c<src.nglm;++c) {
+               inShellPut( &sc, k, c, inShellGet( &src, k, c ) );
+            }
+         }
+         if( src.ni > 0 ) {
+            memcpy( sc.ie, src.ie, src.ni*sizeof(unsigned int) );
+         }
+         double c2 = inBenchSeconds();
+
+         fprintf( stdout, "  %s -> %s: %9.4lf s  casts: %9.4lf s  %s \n",
+                  names[n/2][n%2], names[m/2][m%2], c1-c0, c2-c1,
+                  inBenchShellSame( &dst, &sc ) ? "same" : "DIFFERENT" );
+         inShellFree( &dst );
+         inShellFree( &sc );
+      }
+      inShellFree( &src );
+   }
+   inShellFree( &ref );
+
+   return 0;
+}
+
+int inBenchDump( int im, int jm )
+{
+   struct in_shell_s sh;
+   double c0, c1, c2, c3;
+   struct in_dump_job_s job;
+
+   if( inMakeAxisSphereshell2mt( im, jm, &sh, 0 ) ) return 1;
+   c0 = inBenchSeconds();
+   (void) inDumpTecplotShell2( "shell2.dat", im, jm, &sh );
+   c1 = inBenchSeconds();
+   (void) inDumpShell2( "shell2.plt", IN_DUMP_PLT, &sh, NULL );
+   c2 = inBenchSeconds();
+   (void) inDumpShell2( "shell2.vtp", IN_DUMP_VTK, &sh, NULL );
+   c3 = inBenchSeconds();
+   fprintf( stdout, "  shell 2: ASCII %9.4lf s  plt %9.4lf s  vtp %9.4lf s \n",
+            c1-c0, c2-c1, c3-c2 );
+   inShellFree( &sh );
+
+   if( inMakeAxisSphereshell3mt( im, jm, &sh, 0 ) ) return 1;
+   c0 = inBenchSeconds();
+   (void) inDumpTecplotShell3( "shell3.dat", &sh );
+   c1 = inBenchSeconds();
+   (void) inDumpShell3( "shell3.plt", IN_DUMP_PLT, &sh, NULL );
+   c2 = inBenchSeconds();
+   (void) inDumpShell3( "shell3.vtp", IN_DUMP_VTK, &sh, &job );
+   c3 = inBenchSeconds();     // (the caller is free from here on)
+   int ierr = inDumpWait( &job );
+   fprintf( stdout, "  shell 3: ASCII %9.4lf s  plt %9.4lf s  vtp started "
+            "in %9.4lf s, done in %9.4lf s (%d) \n",
+            c1-c0, c2-c1, c3-c2, inBenchSeconds()-c2, ierr );
+   inShellFree( &sh );
+
+   return 0;
+}
+
+//
+// Comparison of the spheres by the number of vertices and triangles against
+// the largest distance of a triangle from the sphere (the gap at the foot of
+// the perpendicular from the centre) and the spread of the triangles' areas
+// (Run as "./a.out kinds".)
+//
+
+static void inBenchSphereStats( const char *name,
+                                const struct in_shell_s *sh )
+{
+   const float *x = (const float*) sh->x;
+   const unsigned int *ie = sh->ie;
+   int nv = (int) sh->nv, ni = (int) sh->ni;
+   double gap = 0.0, amin = 1.0e30, amax = 0.0;
+   int iwrong = 0;
+   for(int n=0;n<ni;n+=3) {
+      const float *a = &( x[ ((size_t) ie[n  ])*12 ] );
+      const float *b = &( x[ ((size_t) ie[n+1])*12 ] );
+      const float *c = &( x[ ((size_t) ie[n+2])*12 ] );
+      double u[3], v[3], w[3];
+      for(int k=0;k<3;++k) { u[k] = b[k] - a[k]; v[k] = c[k] - a[k]; }
+      w[0] = u[1]*v[2] - u[2]*v[1];
+      w[1] = u[2]*v[0] - u[0]*v[2];
+      w[2] = u[0]*v[1] - u[1]*v[0];
+      double l = sqrt( w[0]*w[0] + w[1]*w[1] + w[2]*w[2] );
+      if( l == 0.0 ) continue;
+      double d = ( w[0]*a[0] + w[1]*a[1] + w[2]*a[2] ) / l;
+      if( d > 0.0 ) ++iwrong;
+      gap = fmax( gap, 1.0 - fabs( d ) );
+      amin = fmin( amin, 0.5*l );
+      amax = fmax( amax, 0.5*l );
+   }
+   fprintf( stdout, "  %-18s %8d vertices %8d triangles  gap %.5lf  "
+            "area ratio %6.1lf %s \n", name, nv, ni/3, gap, amax/amin,
+            iwrong ? "WRONG WINDING" : "" );
+}
+
+int inBenchSphereKinds( void )
+{
+   struct in_shell_s sh;
+   char name[32];
+
+   static const int imm[4] = { 12, 24, 40, 80 }, jmm[4] = { 6, 12, 20, 40 };
+   for(int l=0;l<4;++l) {
+      if( inMakeAxisSphereIndexed( imm[l], jmm[l], &sh, 1 ) ) return 1;
+      snprintf( name, 32, "axis %d x %d", imm[l], jmm[l] );
+      inBenchSphereStats( name, &sh );
+      inShellFree( &sh );
+   }
+   for(int l=1;l<=4;++l) {
+      if( inMakeIcoSphere( l, &sh ) ) return 1;
+      snprintf( name, 32, "icosphere %d", l );
+      inBenchSphereStats( name, &sh );
+      inShellFree( &sh );
+   }
+   static const int nn[4] = { 3, 5, 8, 16 };
+   for(int l=0;l<4;++l) {
+      if( inMakeCubeSphere( nn[l], &sh ) ) return 1;
+      snprintf( name, 32, "cube-sphere %d", nn[l] );
+      inBenchSphereStats( name, &sh );
+      inShellFree( &sh );
+   }
+
+   return 0;
+}
+
+int main( int argc, char *argv[] ) {
+   int im = 40,jm = 20;
+   struct in_shell_s sh;
+
+   if( argc > 1 && strcmp( argv[1], "bench" ) == 0 ) {
+      int ib = 2000, jb = 1000, nt = 0;
+      if( argc > 3 ) { ib = atoi( argv[2] ); jb = atoi( argv[3] ); }
+      if( argc > 4 ) nt = atoi( argv[4] );
+      return inBenchAxisSphere( ib, jb, nt );
+   }
+   if( argc > 1 && strcmp( argv[1], "kinds" ) == 0 ) {
+      return inBenchSphereKinds();
+   }
+   if( argc > 1 && strcmp( argv[1], "convert" ) == 0 ) {
+      int ib = 2000, jb = 1000;
+      if( argc > 3 ) { ib = atoi( argv[2] ); jb = atoi( argv[3] ); }
+      return inBenchShellConvert( ib, jb );
+   }
+   if( argc > 1 && strcmp( argv[1], "dump" ) == 0 ) {
+      int ib = 400, jb = 200;
+      if( argc > 3 ) { ib = atoi( argv[2] ); jb = atoi( argv[3] ); }
+      return inBenchDump( ib, jb );
+   }
+
+// (void) inMakeAxisSphereshell1(im,jm,&sh);
+// (void) inDumpTecplotShell1("shell1.dat",im,jm,&sh);
+// inShellFree(&sh);
+
+// (void) inMakeAxisSphereshell2(im,jm,&sh);
+// (void) inDumpTecplotShell2("shell2.dat",im,jm,&sh);
+// inShellFree(&sh);
+
+   if( inMakeAxisSphereshell3( im, jm, &sh ) ) return 1;
+   (void) inDumpTecplotShell3("shell3.dat",&sh);
+   inShellFree(&sh);
 
    return 0;
 }
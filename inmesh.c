@@ -0,0 +1,1801 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "inthreads.h"
+#include "inmesh.h"
+
+
+//
+// What is gathered from a file before the vertices are made: the arrays of
+// values (positions and colours go together) and three indices per corner of
+// every triangle (position, texel, normal; -1 when the corner has none)
+//
+struct inmesh_load_s {
+   const char *base;          // the mapped file
+   size_t size;
+   long num[4];               // positions, texels, normals, triangles
+   float *pos, *tex, *nrm;    // 3, 2 and 3 values per item
+   float *col;                // 4 values per position (or NULL)
+   int32_t *corner;           // 9 values per triangle
+   int icolor;                // positions have colours (OBJ)
+   int iswap;                 // binary PLY of the other byte order (1), of
+                              // this byte order (0), or text (-1)
+   int ierr;                  // set by tasks (accessed atomically)
+};
+
+//
+// a chunk of work: lines of text or a range of records; the first pass
+// counts the items of the chunk and the second puts them in place starting
+// from the chunk's first of each kind
+//
+struct inmesh_task_s {
+   struct inmesh_load_s *ld;
+   const void *elem;          // PLY element of the chunk
+   const char *p0, *p1;       // bytes of the chunk
+   long n0, n1;               // records of the chunk (binary PLY)
+   int ipass;
+   long cnt[4];               // items of the chunk
+   long first[4];             // first item of the chunk in the arrays
+   const int32_t *uc;         // corners of the vertices (indexed groups)
+   struct inogl_grp_s *gp;
+};
+
+#define INMESH_SPACE(c)  ( (c) == ' ' || (c) == '\t' || (c) == '\r' )
+#define INMESH_CHUNK     (1024*1024)     // bytes in a chunk of text (min)
+
+
+//
+// Functions to parse numbers from text that is not terminated; they return
+// past the number, or NULL if there is none before the end
+//
+
+static const char* inMeshSkip( const char *p, const char *e )
+{
+   while( p < e && INMESH_SPACE(*p) ) ++p;
+   return p;
+}
+
+static const char* inMeshFloat( const char *p, const char *e, float *f )
+{
+   static const double p10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+           1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+           1e19, 1e20, 1e21, 1e22 };
+
+   p = inMeshSkip( p, e );
+   const char *s = p;
+   int ineg = 0;
+   if( p < e && ( *p == '-' || *p == '+' ) ) ineg = ( *(p++) == '-' );
+
+   uint64_t m = 0;
+   int nd = 0, nx = 0, ex = 0;
+   for(;p < e && *p >= '0' && *p <= '9';++p,++nx) {
+      if( nd < 19 ) {
+         m = m*10 + (uint64_t) (*p - '0');
+         if( m > 0 ) ++nd;
+      } else {
+         ++ex;
+      }
+   }
+   if( p < e && *p == '.' ) {
+      for(++p;p < e && *p >= '0' && *p <= '9';++p,++nx) {
+         if( nd < 19 ) {
+            m = m*10 + (uint64_t) (*p - '0');
+            if( m > 0 ) ++nd;
+            --ex;
+         }
+      }
+   }
+   if( nx == 0 ) {
+      // not a plain number (inf, nan, ...); the slow way
+      char tmp[64];
+      size_t n = 0;
+      while( s+n < e && n < sizeof(tmp)-1 && !INMESH_SPACE( s[n] ) &&
+             s[n] != '\n' ) { tmp[n] = s[n]; ++n; }
+      tmp[n] = '\0';
+      char *q;
+      double d = strtod( tmp, &q );
+      if( q == tmp ) return NULL;
+      *f = (float) d;
+      return s + (q - tmp);
+   }
+   if( p < e && ( *p == 'e' || *p == 'E' ) ) {
+      const char *q = p + 1;
+      int ixneg = 0, x = 0, ix = 0;
+      if( q < e && ( *q == '-' || *q == '+' ) ) ixneg = ( *(q++) == '-' );
+      for(;q < e && *q >= '0' && *q <= '9';++q,++ix) {
+         if( x < 10000 ) x = x*10 + (*q - '0');
+      }
+      if( ix > 0 ) {
+         ex += ixneg ? -x : x;
+         p = q;
+      }
+   }
+
+   double d = (double) m;
+   if( m != 0 ) {
+      if( ex > 0 ) {
+         d = ( ex <= 22 ) ? d * p10[ex] : d * pow( 10.0, (double) ex );
+      } else if( ex < 0 ) {
+         d = ( ex >= -22 ) ? d / p10[-ex] : d * pow( 10.0, (double) ex );
+      }
+   }
+   *f = (float) ( ineg ? -d : d );
+   return p;
+}
+
+static const char* inMeshInt( const char *p, const char *e, long *i )
+{
+   p = inMeshSkip( p, e );
+   int ineg = 0;
+   if( p < e && ( *p == '-' || *p == '+' ) ) ineg = ( *(p++) == '-' );
+   if( p >= e || *p < '0' || *p > '9' ) return NULL;
+   long n = 0;
+   for(;p < e && *p >= '0' && *p <= '9';++p) n = n*10 + (long) (*p - '0');
+   *i = ineg ? -n : n;
+   return p;
+}
+
+// past the end of the token (whatever it is)
+static const char* inMeshToken( const char *p, const char *e )
+{
+   p = inMeshSkip( p, e );
+   while( p < e && !INMESH_SPACE(*p) ) ++p;
+   return p;
+}
+
+// the end of a line, and the start of the next
+static const char* inMeshLine( const char *p, const char *e, const char **next )
+{
+   const char *le = (const char*) memchr( p, '\n', (size_t) (e - p) );
+   if( le == NULL ) {
+      *next = e;
+      return e;
+   }
+   *next = le + 1;
+   return le;
+}
+
+
+//
+// Functions to cut text in chunks of whole lines and to run tasks (in the
+// pool, or in the caller when there is no pool)
+//
+
+static int inMeshSplit( struct inmesh_load_s *ld, const char *p0,
+                        const char *p1, int num, struct inmesh_task_s *tk )
+{
+   size_t len = (size_t) (p1 - p0);
+   if( (size_t) num > len / INMESH_CHUNK + 1 ) num = (int) (len/INMESH_CHUNK) + 1;
+
+   const char *p = p0;
+   for(int n=0;n<num;++n) {
+      const char *e = p1;
+      if( n < num-1 ) {
+         e = p0 + len / ((size_t) num) * ((size_t) (n+1));
+         if( e < p ) e = p;
+         if( e > p0 && e[-1] != '\n' ) (void) inMeshLine( e, p1, &e );
+      }
+      memset( &( tk[n] ), 0, sizeof(struct inmesh_task_s) );
+      tk[n].ld = ld;
+      tk[n].p0 = p;
+      tk[n].p1 = e;
+      p = e;
+   }
+   return num;
+}
+
+static void inMeshRun( struct in_pool_s *pool, void (*func)( void *arg ),
+                       struct inmesh_task_s *tk, int num, int ipass )
+{
+   for(int n=0;n<num;++n) {
+      tk[n].ipass = ipass;
+      if( pool == NULL || inPoolSubmit( pool, func, (void*) &( tk[n] ) ) ) {
+         func( (void*) &( tk[n] ) );
+      }
+   }
+   if( pool != NULL ) inPoolWait( pool );
+}
+
+// the items before each chunk, and in all chunks
+static void inMeshPrefix( struct inmesh_load_s *ld,
+                          struct inmesh_task_s *tk, int num, int k0, int k1 )
+{
+   for(int k=k0;k<=k1;++k) {
+      long n = 0;
+      for(int m=0;m<num;++m) {
+         tk[m].first[k] = n;
+         n += tk[m].cnt[k];
+      }
+      ld->num[k] = n;
+   }
+}
+
+static void inMeshError( struct inmesh_load_s *ld )
+{
+   __atomic_store_n( &( ld->ierr ), 1, __ATOMIC_RELAXED );
+}
+
+
+//
+// Wavefront OBJ: "v x y z [r g b]", "vt s [t]", "vn x y z" and "f" with
+// corners as "v", "v/t", "v//n" or "v/t/n" (indices from 1, or negative and
+// relative to the items before the line); everything else is skipped
+//
+
+// a corner of a face; "before" are the items before the line
+static const char* inMeshObjCorner( const char *p, const char *e,
+                                    const long *before, int32_t *c )
+{
+   p = inMeshSkip( p, e );
+   if( p >= e ) return NULL;
+
+   long idx[3] = { 0, 0, 0 };
+   int ibad = 0;
+   for(int k=0;k<3;++k) {
+      if( k > 0 ) {
+         if( p >= e || *p != '/' ) break;
+         ++p;
+         if( p < e && *p == '/' ) continue;        // no texel
+      }
+      const char *q = inMeshInt( p, e, &( idx[k] ) );
+      if( q == NULL ) {
+         ibad = ( k == 0 );
+         break;
+      }
+      p = q;
+   }
+
+   // (from one, or relative; -1 for none and -2 for an invalid index)
+   for(int k=0;k<3;++k) {
+      long i = idx[k];
+      if( i > 0 ) {
+         c[k] = (int32_t) (i - 1);
+      } else if( i < 0 ) {
+         c[k] = ( before[k] + i >= 0 ) ? (int32_t) (before[k] + i) : -2;
+      } else {
+         c[k] = ( k == 0 ) ? -2 : -1;
+      }
+   }
+   if( ibad ) c[0] = -2;
+
+   while( p < e && !INMESH_SPACE(*p) ) ++p;     // (past what is left of it)
+   return p;
+}
+
+static void inMeshObjTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   struct inmesh_load_s *ld = tk->ld;
+   long cnt[4] = { 0, 0, 0, 0 };
+
+   const char *p = tk->p0, *e = tk->p1;
+   while( p < e ) {
+      const char *l = p;
+      const char *le = inMeshLine( p, e, &p );
+      l = inMeshSkip( l, le );
+      if( le - l < 2 ) continue;
+
+      int kind = -1;
+      if( l[0] == 'v' ) {
+         if( INMESH_SPACE( l[1] ) ) {
+            kind = 0;
+         } else if( le - l > 2 && INMESH_SPACE( l[2] ) ) {
+            if( l[1] == 't' ) kind = 1;
+            if( l[1] == 'n' ) kind = 2;
+         }
+      } else if( l[0] == 'f' && INMESH_SPACE( l[1] ) ) {
+         kind = 3;
+      }
+      if( kind < 0 ) continue;
+      l += ( kind == 0 || kind == 3 ) ? 1 : 2;
+
+      if( tk->ipass == 0 ) {
+         if( kind < 3 ) {
+            ++cnt[kind];
+         } else {
+            long k = 0;
+            for(const char *q=inMeshSkip(l,le);q<le;q=inMeshSkip(q,le)) {
+               q = inMeshToken( q, le );
+               ++k;
+            }
+            if( k >= 3 ) cnt[3] += k - 2;
+         }
+         continue;
+      }
+
+      long n = tk->first[kind] + cnt[kind];
+      if( kind == 0 ) {
+         float *v = &( ld->pos[3*n] );
+         for(int k=0;k<3 && l != NULL;++k) l = inMeshFloat( l, le, &( v[k] ) );
+         if( l == NULL ) inMeshError( ld );
+         if( ld->icolor ) {
+            float *c = &( ld->col[4*n] );
+            c[0] = 1.0f; c[1] = 1.0f; c[2] = 1.0f; c[3] = 1.0f;
+            for(int k=0;k<3 && l != NULL;++k) l = inMeshFloat( l, le, &( c[k] ) );
+         }
+         ++cnt[0];
+      } else if( kind == 1 ) {
+         float *t = &( ld->tex[2*n] );
+         t[1] = 0.0f;
+         l = inMeshFloat( l, le, &( t[0] ) );
+         if( l == NULL ) inMeshError( ld );
+         else (void) inMeshFloat( l, le, &( t[1] ) );
+         ++cnt[1];
+      } else if( kind == 2 ) {
+         float *v = &( ld->nrm[3*n] );
+         for(int k=0;k<3 && l != NULL;++k) l = inMeshFloat( l, le, &( v[k] ) );
+         if( l == NULL ) inMeshError( ld );
+         ++cnt[2];
+      } else {
+         long before[3] = { tk->first[0] + cnt[0], tk->first[1] + cnt[1],
+                            tk->first[2] + cnt[2] };
+         int32_t c0[3], cp[3], c[3];
+         int k = 0;
+         while( ( l = inMeshObjCorner( l, le, before, c ) ) != NULL ) {
+            if( k == 0 ) {
+               memcpy( c0, c, sizeof(c0) );
+            } else if( k >= 2 ) {
+               int32_t *t = &( ld->corner[ 9*(tk->first[3] + cnt[3]) ] );
+               memcpy( t, c0, sizeof(c0) );
+               memcpy( t+3, cp, sizeof(cp) );
+               memcpy( t+6, c, sizeof(c) );
+               ++cnt[3];
+            }
+            memcpy( cp, c, sizeof(cp) );
+            ++k;
+         }
+      }
+   }
+
+   memcpy( tk->cnt, cnt, sizeof(cnt) );
+}
+
+static int inMeshObj( struct inmesh_load_s *ld, struct in_pool_s *pool,
+                      int num_tasks )
+{
+   // colours come with the positions (six numbers in the first "v" line)
+   const char *p = ld->base, *e = ld->base + ld->size;
+   while( p < e ) {
+      const char *l = p;
+      const char *le = inMeshLine( p, e, &p );
+      l = inMeshSkip( l, le );
+      if( le - l < 2 || l[0] != 'v' || !INMESH_SPACE( l[1] ) ) continue;
+      int k = 0;
+      float f;
+      for(l=l+1;l != NULL;++k) l = inMeshFloat( l, le, &f );
+      ld->icolor = ( k-1 == 6 );
+      break;
+   }
+
+   struct inmesh_task_s *tk = (struct inmesh_task_s*)
+                  malloc( ((size_t) num_tasks) * sizeof(struct inmesh_task_s) );
+   if( tk == NULL ) return -1;
+   int num = inMeshSplit( ld, ld->base, e, num_tasks, tk );
+
+   inMeshRun( pool, inMeshObjTask, tk, num, 0 );
+   inMeshPrefix( ld, tk, num, 0, 3 );
+
+   ld->pos = (float*) malloc( ((size_t) ld->num[0] + 1) * 3*sizeof(float) );
+   ld->tex = (float*) malloc( ((size_t) ld->num[1] + 1) * 2*sizeof(float) );
+   ld->nrm = (float*) malloc( ((size_t) ld->num[2] + 1) * 3*sizeof(float) );
+   if( ld->icolor ) {
+      ld->col = (float*) malloc( ((size_t) ld->num[0] + 1) * 4*sizeof(float) );
+   }
+   ld->corner = (int32_t*) malloc( ((size_t) ld->num[3] + 1) *
+                                   9*sizeof(int32_t) );
+   if( ld->pos == NULL || ld->tex == NULL || ld->nrm == NULL ||
+       ( ld->icolor && ld->col == NULL ) || ld->corner == NULL ) {
+      free( tk );
+      return -1;
+   }
+
+   inMeshRun( pool, inMeshObjTask, tk, num, 1 );
+   free( tk );
+
+   if( ld->num[1] == 0 ) { free( ld->tex ); ld->tex = NULL; }
+   if( ld->num[2] == 0 ) { free( ld->nrm ); ld->nrm = NULL; }
+   return 0;
+}
+
+
+//
+// PLY (ASCII, binary of either byte order): the "vertex" element with
+// properties "x y z", "nx ny nz", "s t" (or "u v", "texture_u texture_v"),
+// "red green blue alpha", and the "face" element with the list property
+// "vertex_indices" (or "vertex_index"); other properties and elements are
+// skipped (in binary files, other elements can have lists only if they come
+// after the vertices and faces)
+//
+enum inmesh_ply_type {
+   INMESH_PLY_I8 = 1,
+   INMESH_PLY_U8,
+   INMESH_PLY_I16,
+   INMESH_PLY_U16,
+   INMESH_PLY_I32,
+   INMESH_PLY_U32,
+   INMESH_PLY_F32,
+   INMESH_PLY_F64,
+};
+
+struct inmesh_plyprop_s {
+   int type;                  // of the value, or of the items of a list
+   int ctype;                 // of the count of a list; zero if not a list
+   int slot;                  // where a vertex property goes; -1 if nowhere
+};
+
+struct inmesh_plyelem_s {
+   char name[32];
+   long count;
+   int nprop;
+   struct inmesh_plyprop_s prop[32];
+   size_t size;               // of a record; zero if it has lists
+   int ilist;                 // the list of vertex indices (faces)
+   const char *p0, *p1;       // where the records are
+};
+
+static const size_t inmesh_ply_size[9] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+static int inMeshPlyType( const char *s )
+{
+   static const char *names[16] = { "char", "int8", "uchar", "uint8",
+                                    "short", "int16", "ushort", "uint16",
+                                    "int", "int32", "uint", "uint32",
+                                    "float", "float32", "double", "float64" };
+   for(int n=0;n<16;++n) {
+      if( strcmp( s, names[n] ) == 0 ) return n/2 + 1;
+   }
+   return 0;
+}
+
+static int inMeshPlySlot( const char *s )
+{
+   static const char *names[] = { "x", "y", "z", "nx", "ny", "nz",
+                                  "s", "t", "red", "green", "blue", "alpha",
+                                  "u", "v", "texture_u", "texture_v",
+                                  "texture_s", "texture_t" };
+   static const int slots[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+                                6, 7, 6, 7, 6, 7 };
+   for(size_t n=0;n<sizeof(slots)/sizeof(int);++n) {
+      if( strcmp( s, names[n] ) == 0 ) return slots[n];
+   }
+   return -1;
+}
+
+static double inMeshPlyGet( const char *p, int type, int iswap )
+{
+   unsigned char b[8];
+   size_t n = inmesh_ply_size[type];
+   if( iswap ) {
+      for(size_t k=0;k<n;++k) b[k] = (unsigned char) p[n-1-k];
+   } else {
+      memcpy( b, p, n );
+   }
+
+   switch( type ) {
+    case INMESH_PLY_I8:  { int8_t v; memcpy( &v, b, 1 ); return (double) v; }
+    case INMESH_PLY_U8:  { uint8_t v; memcpy( &v, b, 1 ); return (double) v; }
+    case INMESH_PLY_I16: { int16_t v; memcpy( &v, b, 2 ); return (double) v; }
+    case INMESH_PLY_U16: { uint16_t v; memcpy( &v, b, 2 ); return (double) v; }
+    case INMESH_PLY_I32: { int32_t v; memcpy( &v, b, 4 ); return (double) v; }
+    case INMESH_PLY_U32: { uint32_t v; memcpy( &v, b, 4 ); return (double) v; }
+    case INMESH_PLY_F32: { float v; memcpy( &v, b, 4 ); return (double) v; }
+    default:             { double v; memcpy( &v, b, 8 ); return v; }
+   }
+}
+
+// a vertex property into its place (integer colours are scaled to [0,1])
+static void inMeshPlyPut( struct inmesh_load_s *ld, long n,
+                          const struct inmesh_plyprop_s *pr, double d )
+{
+   int s = pr->slot;
+   if( s < 3 ) {
+      ld->pos[3*n + s] = (float) d;
+   } else if( s < 6 ) {
+      ld->nrm[3*n + s-3] = (float) d;
+   } else if( s < 8 ) {
+      ld->tex[2*n + s-6] = (float) d;
+   } else {
+      static const double cmax[9] = { 1.0, 127.0, 255.0, 32767.0, 65535.0,
+                                      2147483647.0, 4294967295.0, 1.0, 1.0 };
+      ld->col[4*n + s-8] = (float) ( d / cmax[ pr->type ] );
+   }
+}
+
+static void inMeshPlyDefaults( struct inmesh_load_s *ld, long n )
+{
+   if( ld->col != NULL ) {
+      float *c = &( ld->col[4*n] );
+      c[0] = 1.0f; c[1] = 1.0f; c[2] = 1.0f; c[3] = 1.0f;
+   }
+}
+
+static void inMeshPlyCorners( struct inmesh_load_s *ld, long itri,
+                              const long *v )
+{
+   int32_t *c = &( ld->corner[9*itri] );
+   for(int k=0;k<3;++k) {
+      int32_t i = ( v[k] >= 0 && v[k] < ld->num[0] ) ? (int32_t) v[k] : -2;
+      c[3*k] = i;
+      c[3*k+1] = ( ld->tex != NULL ) ? i : -1;
+      c[3*k+2] = ( ld->nrm != NULL ) ? i : -1;
+   }
+}
+
+static void inMeshPlyVertexTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   struct inmesh_load_s *ld = tk->ld;
+   const struct inmesh_plyelem_s *el =
+                             (const struct inmesh_plyelem_s*) tk->elem;
+
+   if( ld->iswap >= 0 ) {
+      // binary records
+      for(long n=tk->n0;n<tk->n1;++n) {
+         const char *p = el->p0 + ((size_t) n)*el->size;
+         inMeshPlyDefaults( ld, n );
+         for(int k=0;k<el->nprop;++k) {
+            const struct inmesh_plyprop_s *pr = &( el->prop[k] );
+            if( pr->slot >= 0 ) {
+               inMeshPlyPut( ld, n, pr, inMeshPlyGet( p, pr->type, ld->iswap ) );
+            }
+            p += inmesh_ply_size[ pr->type ];
+         }
+      }
+      return;
+   }
+
+   // lines of text
+   long cnt = 0;
+   const char *p = tk->p0, *e = tk->p1;
+   while( p < e ) {
+      const char *l = p;
+      const char *le = inMeshLine( p, e, &p );
+      if( tk->ipass == 0 ) {
+         ++cnt;
+         continue;
+      }
+      long n = tk->first[0] + cnt;
+      inMeshPlyDefaults( ld, n );
+      for(int k=0;k<el->nprop && l != NULL;++k) {
+         const struct inmesh_plyprop_s *pr = &( el->prop[k] );
+         if( pr->ctype != 0 ) {
+            long m = 0;
+            l = inMeshInt( l, le, &m );
+            for(long i=0;i<m && l != NULL;++i) l = inMeshToken( l, le );
+            continue;
+         }
+         float f;
+         l = inMeshFloat( l, le, &f );
+         if( l != NULL && pr->slot >= 0 ) inMeshPlyPut( ld, n, pr, f );
+      }
+      if( l == NULL ) inMeshError( ld );
+      ++cnt;
+   }
+   tk->cnt[0] = cnt;
+}
+
+static void inMeshPlyFaceTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   struct inmesh_load_s *ld = tk->ld;
+   const struct inmesh_plyelem_s *el =
+                             (const struct inmesh_plyelem_s*) tk->elem;
+   long cnt = 0;
+
+   if( ld->iswap >= 0 ) {
+      // binary records (the chunk starts at a record)
+      const char *p = tk->p0;
+      for(long n=tk->n0;n<tk->n1;++n) {
+         for(int k=0;k<el->nprop;++k) {
+            const struct inmesh_plyprop_s *pr = &( el->prop[k] );
+            if( pr->ctype == 0 ) {
+               p += inmesh_ply_size[ pr->type ];
+               continue;
+            }
+            long m = (long) inMeshPlyGet( p, pr->ctype, ld->iswap );
+            p += inmesh_ply_size[ pr->ctype ];
+            size_t isize = inmesh_ply_size[ pr->type ];
+            if( k == el->ilist ) {
+               long v[3];
+               for(long i=0;i<m;++i) {
+                  long iv = (long) inMeshPlyGet( p + ((size_t) i)*isize,
+                                                 pr->type, ld->iswap );
+                  if( i == 0 ) v[0] = iv;
+                  v[ i < 2 ? i : 2 ] = iv;
+                  if( i >= 2 ) {
+                     inMeshPlyCorners( ld, tk->first[3] + cnt, v );
+                     ++cnt;
+                     v[1] = v[2];
+                  }
+               }
+            }
+            p += ((size_t) m)*isize;
+         }
+      }
+      tk->cnt[3] = cnt;
+      return;
+   }
+
+   // lines of text
+   const char *p = tk->p0, *e = tk->p1;
+   while( p < e ) {
+      const char *l = p;
+      const char *le = inMeshLine( p, e, &p );
+      for(int k=0;k<el->nprop && l != NULL;++k) {
+         const struct inmesh_plyprop_s *pr = &( el->prop[k] );
+         if( pr->ctype == 0 ) {
+            l = inMeshToken( l, le );
+            continue;
+         }
+         long m = 0;
+         l = inMeshInt( l, le, &m );
+         if( k != el->ilist || l == NULL ) {
+            for(long i=0;i<m && l != NULL;++i) l = inMeshToken( l, le );
+            continue;
+         }
+         if( tk->ipass == 0 ) {
+            if( m >= 3 ) cnt += m - 2;
+            break;
+         }
+         long v[3];
+         for(long i=0;i<m && l != NULL;++i) {
+            long iv = -1;
+            l = inMeshInt( l, le, &iv );
+            if( i == 0 ) v[0] = iv;
+            v[ i < 2 ? i : 2 ] = iv;
+            if( i >= 2 ) {
+               inMeshPlyCorners( ld, tk->first[3] + cnt, v );
+               ++cnt;
+               v[1] = v[2];
+            }
+         }
+      }
+      if( l == NULL ) inMeshError( ld );
+   }
+   tk->cnt[3] = cnt;
+}
+
+// past the binary record of an element at "p" (NULL if it goes past "e");
+// the number of triangles of the record's index list is added to "ntri"
+static const char* inMeshPlyRecord( const struct inmesh_plyelem_s *el,
+                                    const char *p, const char *e, int iswap,
+                                    long *ntri )
+{
+   for(int k=0;k<el->nprop;++k) {
+      const struct inmesh_plyprop_s *pr = &( el->prop[k] );
+      if( pr->ctype == 0 ) {
+         p += inmesh_ply_size[ pr->type ];
+         continue;
+      }
+      if( p + inmesh_ply_size[ pr->ctype ] > e ) return NULL;
+      long m = (long) inMeshPlyGet( p, pr->ctype, iswap );
+      if( m < 0 ) return NULL;
+      p += inmesh_ply_size[ pr->ctype ] + ((size_t) m)*inmesh_ply_size[ pr->type ];
+      if( k == el->ilist && m >= 3 ) *ntri += m - 2;
+   }
+   return ( p <= e ) ? p : NULL;
+}
+
+static int inMeshPlyData( struct inmesh_load_s *ld, struct in_pool_s *pool,
+                          int num_tasks, struct inmesh_plyelem_s *el, int nel,
+                          const char *p, const char *e )
+{
+   struct inmesh_plyelem_s *vert = NULL, *face = NULL;
+   for(int n=0;n<nel;++n) {
+      if( strcmp( el[n].name, "vertex" ) == 0 ) vert = &( el[n] );
+      if( strcmp( el[n].name, "face" ) == 0 ) face = &( el[n] );
+   }
+   if( vert == NULL || face == NULL || face->ilist < 0 ||
+       vert->count < 1 || vert->count > 0x7fffffffL ) return 2;
+
+   int ipos = 0, inrm = 0, itex = 0, icol = 0;
+   for(int k=0;k<vert->nprop;++k) {
+      int s = vert->prop[k].slot;
+      if( s >= 0 && s < 3 ) ipos |= 1 << s;
+      if( s >= 3 && s < 6 ) inrm = 1;
+      if( s >= 6 && s < 8 ) itex = 1;
+      if( s >= 8 ) icol = 1;
+   }
+   if( ipos != 0x07 ) return 2;
+
+   struct inmesh_task_s *tk = (struct inmesh_task_s*)
+                  malloc( ((size_t) num_tasks) * sizeof(struct inmesh_task_s) );
+   if( tk == NULL ) return -1;
+   memset( tk, 0, ((size_t) num_tasks) * sizeof(struct inmesh_task_s) );
+
+   // where the elements are; the records of faces in a binary file are
+   // walked (their lists vary in length) and split in equal ranges
+   int nface = 0;
+   for(int n=0;n<nel && p != NULL;++n) {
+      struct inmesh_plyelem_s *pe = &( el[n] );
+      pe->p0 = p;
+      if( ld->iswap < 0 ) {
+         for(long m=0;m<pe->count && p < e;++m) (void) inMeshLine( p, e, &p );
+      } else {
+         size_t size = 0;
+         int ilist = 0;
+         for(int k=0;k<pe->nprop;++k) {
+            ilist |= ( pe->prop[k].ctype != 0 );
+            size += inmesh_ply_size[ pe->prop[k].type ];
+         }
+         if( !ilist ) {
+            pe->size = size;
+            p = ( ((size_t) (e - p)) / size >= (size_t) pe->count ) ?
+                p + size*((size_t) pe->count) : NULL;
+         } else if( pe == face ) {
+            long nb = ( pe->count + num_tasks - 1 ) / num_tasks;
+            long ntri = 0;
+            for(long m=0;m<pe->count && p != NULL;++m) {
+               if( nb > 0 && m % nb == 0 ) {
+                  tk[nface].ld = ld;
+                  tk[nface].elem = pe;
+                  tk[nface].p0 = p;
+                  tk[nface].n0 = m;
+                  tk[nface].n1 = ( m + nb < pe->count ) ? m + nb : pe->count;
+                  tk[nface].first[3] = ntri;
+                  ++nface;
+               }
+               p = inMeshPlyRecord( pe, p, e, ld->iswap, &ntri );
+            }
+            ld->num[3] = ntri;
+         } else if( face->p0 == NULL || vert->p0 == NULL ) {
+            // (nothing to skip it by)
+            p = NULL;
+         } else {
+            break;
+         }
+      }
+      pe->p1 = p;
+   }
+   if( p == NULL || vert->p1 == NULL || face->p1 == NULL ) {
+      free( tk );
+      return 2;
+   }
+
+   // the faces of a text file are counted
+   if( ld->iswap < 0 ) {
+      nface = inMeshSplit( ld, face->p0, face->p1, num_tasks, tk );
+      for(int n=0;n<nface;++n) tk[n].elem = face;
+      inMeshRun( pool, inMeshPlyFaceTask, tk, nface, 0 );
+      inMeshPrefix( ld, tk, nface, 3, 3 );
+   }
+
+   size_t nv = (size_t) vert->count;
+   ld->num[0] = vert->count;
+   ld->pos = (float*) malloc( nv * 3*sizeof(float) );
+   if( inrm ) ld->nrm = (float*) calloc( nv * 3, sizeof(float) );
+   if( itex ) ld->tex = (float*) calloc( nv * 2, sizeof(float) );
+   if( icol ) ld->col = (float*) malloc( nv * 4*sizeof(float) );
+   ld->corner = (int32_t*) malloc( ((size_t) ld->num[3] + 1) *
+                                   9*sizeof(int32_t) );
+   if( ld->pos == NULL || ( inrm && ld->nrm == NULL ) ||
+       ( itex && ld->tex == NULL ) || ( icol && ld->col == NULL ) ||
+       ld->corner == NULL ) {
+      free( tk );
+      return -1;
+   }
+   ld->num[1] = itex ? ld->num[0] : 0;
+   ld->num[2] = inrm ? ld->num[0] : 0;
+
+   // the faces (their counts are known)
+   inMeshRun( pool, inMeshPlyFaceTask, tk, nface, 1 );
+
+   // the vertices
+   int num;
+   if( ld->iswap < 0 ) {
+      num = inMeshSplit( ld, vert->p0, vert->p1, num_tasks, tk );
+      for(int n=0;n<num;++n) tk[n].elem = vert;
+      inMeshRun( pool, inMeshPlyVertexTask, tk, num, 0 );
+      inMeshPrefix( ld, tk, num, 0, 0 );
+      if( ld->num[0] != vert->count ) {
+         free( tk );
+         return 2;
+      }
+   } else {
+      num = num_tasks;
+      for(int n=0;n<num;++n) {
+         memset( &( tk[n] ), 0, sizeof(struct inmesh_task_s) );
+         tk[n].ld = ld;
+         tk[n].elem = vert;
+         tk[n].n0 = vert->count * n / num;
+         tk[n].n1 = vert->count * (n+1) / num;
+      }
+   }
+   inMeshRun( pool, inMeshPlyVertexTask, tk, num, 1 );
+
+   free( tk );
+   return 0;
+}
+
+
+static int inMeshPly( struct inmesh_load_s *ld, struct in_pool_s *pool,
+                      int num_tasks )
+{
+   const char *p = ld->base, *e = ld->base + ld->size;
+   struct inmesh_plyelem_s el[16];
+   int nel = 0, iend = 0;
+   ld->iswap = -1;
+
+   // the header
+   while( p < e && !iend ) {
+      const char *l = p;
+      const char *le = inMeshLine( p, e, &p );
+      char word[5][32];
+      int nw = 0;
+      for(l=inMeshSkip(l,le);l<le && nw<5;l=inMeshSkip(l,le)) {
+         const char *q = inMeshToken( l, le );
+         size_t n = (size_t) (q - l);
+         if( n > 31 ) n = 31;
+         memcpy( word[nw], l, n );
+         word[nw++][n] = '\0';
+         l = q;
+      }
+      if( nw == 0 ) continue;
+
+      if( strcmp( word[0], "end_header" ) == 0 ) {
+         iend = 1;
+      } else if( strcmp( word[0], "format" ) == 0 && nw > 1 ) {
+         uint16_t one = 1;
+         int ilittle = ( *((const char*) &one) == 1 );
+         if( strcmp( word[1], "binary_little_endian" ) == 0 ) {
+            ld->iswap = !ilittle;
+         } else if( strcmp( word[1], "binary_big_endian" ) == 0 ) {
+            ld->iswap = ilittle;
+         } else if( strcmp( word[1], "ascii" ) != 0 ) {
+            return 2;
+         }
+      } else if( strcmp( word[0], "element" ) == 0 && nw > 2 ) {
+         if( nel == 16 ) return 2;
+         struct inmesh_plyelem_s *pe = &( el[nel++] );
+         memset( pe, 0, sizeof(struct inmesh_plyelem_s) );
+         strcpy( pe->name, word[1] );
+         pe->count = atol( word[2] );
+         pe->ilist = -1;
+      } else if( strcmp( word[0], "property" ) == 0 && nel > 0 && nw > 2 ) {
+         struct inmesh_plyelem_s *pe = &( el[nel-1] );
+         if( pe->nprop == 32 ) return 2;
+         struct inmesh_plyprop_s *pr = &( pe->prop[ pe->nprop ] );
+         memset( pr, 0, sizeof(struct inmesh_plyprop_s) );
+         pr->slot = -1;
+         if( strcmp( word[1], "list" ) == 0 ) {
+            if( nw < 5 ) return 2;
+            pr->ctype = inMeshPlyType( word[2] );
+            pr->type = inMeshPlyType( word[3] );
+            if( pr->ctype == 0 || pr->ctype >= INMESH_PLY_F32 ) return 2;
+            if( strcmp( pe->name, "face" ) == 0 &&
+                ( strcmp( word[4], "vertex_indices" ) == 0 ||
+                  strcmp( word[4], "vertex_index" ) == 0 ) ) {
+               pe->ilist = pe->nprop;
+            }
+         } else {
+            pr->type = inMeshPlyType( word[1] );
+            if( strcmp( pe->name, "vertex" ) == 0 ) {
+               pr->slot = inMeshPlySlot( word[2] );
+            }
+         }
+         if( pr->type == 0 ) return 2;
+         pe->nprop += 1;
+      }
+   }
+   if( !iend ) return 2;
+
+   return inMeshPlyData( ld, pool, num_tasks, el, nel, p, e );
+}
+
+//
+// Functions that make the vertices of the group from the corners: either
+// three per triangle, or one per distinct corner and indices
+//
+
+// (returns non-zero for a corner with an invalid index)
+static int inMeshVertex( const struct inmesh_load_s *ld, const int32_t *c,
+                         const struct inogl_grp_s *gp, GLfloat *v )
+{
+   if( c[0] < 0 || c[0] >= ld->num[0] ||
+       c[1] < -1 || c[1] >= ld->num[1] || c[2] < -1 || c[2] >= ld->num[2] ) {
+      memset( v, 0, ((size_t) gp->nglm) * sizeof(GLfloat) );
+      return 1;
+   }
+
+   memcpy( v, &( ld->pos[ 3*((size_t) c[0]) ] ), 3*sizeof(GLfloat) );
+   if( ld->nrm != NULL && c[2] >= 0 ) {
+      memcpy( v + 3, &( ld->nrm[ 3*((size_t) c[2]) ] ), 3*sizeof(GLfloat) );
+   } else {
+      v[3] = 0.0f; v[4] = 0.0f; v[5] = 0.0f;
+   }
+   if( gp->exist & 0x04 ) {
+      GLfloat *t = v + gp->moff[2];
+      if( c[1] >= 0 ) {
+         memcpy( t, &( ld->tex[ 2*((size_t) c[1]) ] ), 2*sizeof(GLfloat) );
+      } else {
+         t[0] = 0.0f; t[1] = 0.0f;
+      }
+   }
+   if( gp->exist & 0x08 ) {
+      memcpy( v + gp->moff[3], &( ld->col[ 4*((size_t) c[0]) ] ),
+              4*sizeof(GLfloat) );
+   }
+   return 0;
+}
+
+// the normal of a triangle (its length is twice the area)
+static void inMeshCross( const GLfloat *a, const GLfloat *b, const GLfloat *c,
+                         float *n )
+{
+   float u[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+   float w[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+   n[0] = u[1]*w[2] - u[2]*w[1];
+   n[1] = u[2]*w[0] - u[0]*w[2];
+   n[2] = u[0]*w[1] - u[1]*w[0];
+}
+
+static void inMeshNormalize( GLfloat *n )
+{
+   float d = sqrtf( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+   if( d > 0.0f ) {
+      n[0] /= d; n[1] /= d; n[2] /= d;
+   }
+}
+
+// independent triangles; normals that are not in the file are made flat
+static void inMeshTriTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   struct inmesh_load_s *ld = tk->ld;
+   const struct inogl_grp_s *gp = tk->gp;
+   size_t nglm = (size_t) gp->nglm;
+
+   for(long t=tk->n0;t<tk->n1;++t) {
+      const int32_t *c = &( ld->corner[ 9*((size_t) t) ] );
+      GLfloat *v = gp->vdata + 3*((size_t) t)*nglm;
+      int ierr = 0;
+      for(int k=0;k<3;++k) ierr |= inMeshVertex( ld, c + 3*k, gp, v + k*nglm );
+      if( ierr ) inMeshError( ld );
+      if( ld->nrm == NULL ) {
+         float n[3];
+         inMeshCross( v, v + nglm, v + 2*nglm, n );
+         inMeshNormalize( n );
+         for(int k=0;k<3;++k) memcpy( v + k*nglm + 3, n, sizeof(n) );
+      }
+   }
+}
+
+// vertices of distinct corners
+static void inMeshNodeTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   struct inmesh_load_s *ld = tk->ld;
+   const struct inogl_grp_s *gp = tk->gp;
+   size_t nglm = (size_t) gp->nglm;
+
+   for(long i=tk->n0;i<tk->n1;++i) {
+      if( inMeshVertex( ld, tk->uc + 3*((size_t) i), gp,
+                        gp->vdata + ((size_t) i)*nglm ) ) inMeshError( ld );
+   }
+}
+
+static uint64_t inMeshHash( const void *p, size_t n )
+{
+   const unsigned char *c = (const unsigned char*) p;
+   uint64_t h = 1469598103934665603ULL;
+   for(size_t k=0;k<n;++k) {
+      h ^= (uint64_t) c[k];
+      h *= 1099511628211ULL;
+   }
+   return h ^ ( h >> 29 );
+}
+
+// open-addressing table of at least twice the items (a power of two)
+static int32_t* inMeshTable( size_t n, size_t *mask )
+{
+   size_t size = 16;
+   while( size < 2*n ) size *= 2;
+   int32_t *table = (int32_t*) malloc( size * sizeof(int32_t) );
+   if( table != NULL ) memset( table, 0xff, size * sizeof(int32_t) );
+   *mask = size - 1;
+   return table;
+}
+
+// the distinct corners and the index of each corner
+static int32_t* inMeshCorners( const struct inmesh_load_s *ld,
+                               struct inogl_grp_s *gp, long *num )
+{
+   size_t nc = 3*((size_t) ld->num[3]);
+   size_t mask;
+   int32_t *table = inMeshTable( nc, &mask );
+   int32_t *uc = (int32_t*) malloc( 3*nc*sizeof(int32_t) );
+   gp->idata = (GLuint*) malloc( nc*sizeof(GLuint) );
+   if( table == NULL || uc == NULL || gp->idata == NULL ) {
+      if( table != NULL ) free( table );
+      if( uc != NULL ) free( uc );
+      return NULL;
+   }
+
+   long nu = 0;
+   for(size_t k=0;k<nc;++k) {
+      const int32_t *c = &( ld->corner[3*k] );
+      size_t h = (size_t) inMeshHash( c, 3*sizeof(int32_t) ) & mask;
+      while( table[h] >= 0 &&
+             memcmp( &( uc[ 3*((size_t) table[h]) ] ), c,
+                     3*sizeof(int32_t) ) != 0 ) h = ( h + 1 ) & mask;
+      if( table[h] < 0 ) {
+         table[h] = (int32_t) nu;
+         memcpy( &( uc[ 3*((size_t) nu) ] ), c, 3*sizeof(int32_t) );
+         ++nu;
+      }
+      gp->idata[k] = (GLuint) table[h];
+   }
+   free( table );
+
+   *num = nu;
+   return uc;
+}
+
+// vertices that are equal bit for bit are merged (in place)
+static int inMeshWeld( struct inogl_grp_s *gp )
+{
+   size_t nv = (size_t) gp->vertex_count;
+   size_t vsize = ((size_t) gp->nglm) * sizeof(GLfloat);
+   size_t mask;
+   int32_t *table = inMeshTable( nv, &mask );
+   int32_t *remap = (int32_t*) malloc( nv*sizeof(int32_t) );
+   if( table == NULL || remap == NULL ) {
+      if( table != NULL ) free( table );
+      if( remap != NULL ) free( remap );
+      return -1;
+   }
+
+   size_t m = 0;
+   for(size_t i=0;i<nv;++i) {
+      const char *v = (const char*) gp->vdata + i*vsize;
+      size_t h = (size_t) inMeshHash( v, vsize ) & mask;
+      while( table[h] >= 0 &&
+             memcmp( (const char*) gp->vdata + ((size_t) table[h])*vsize,
+                     v, vsize ) != 0 ) h = ( h + 1 ) & mask;
+      if( table[h] < 0 ) {
+         table[h] = (int32_t) m;
+         if( m != i ) memmove( (char*) gp->vdata + m*vsize, v, vsize );
+         ++m;
+      }
+      remap[i] = table[h];
+   }
+   for(int k=0;k<gp->index_count;++k) {
+      gp->idata[k] = (GLuint) remap[ gp->idata[k] ];
+   }
+   gp->vertex_count = (int) m;
+
+   free( table );
+   free( remap );
+   return 0;
+}
+
+// smooth normals of indexed vertices (weighted by the areas of triangles)
+static void inMeshSmooth( struct inogl_grp_s *gp )
+{
+   size_t nglm = (size_t) gp->nglm;
+   for(int k=0;k<gp->index_count;k+=3) {
+      GLfloat *v[3];
+      for(int m=0;m<3;++m) v[m] = gp->vdata + ((size_t) gp->idata[k+m])*nglm;
+      float n[3];
+      inMeshCross( v[0], v[1], v[2], n );
+      for(int m=0;m<3;++m) {
+         v[m][3] += n[0]; v[m][4] += n[1]; v[m][5] += n[2];
+      }
+   }
+   for(int i=0;i<gp->vertex_count;++i) {
+      inMeshNormalize( gp->vdata + ((size_t) i)*nglm + 3 );
+   }
+}
+
+static int inMeshBuild( struct inmesh_load_s *ld, int iflags,
+                        struct in_pool_s *pool, int num_tasks,
+                        struct inogl_grp_s *gp )
+{
+   if( ld->num[3] < 1 || ld->num[3] > 0x7fffffffL / 3 ) return 2;
+
+   // the layout: position, normal, and texel and colour when there are any
+   gp->nglm = 3 + 3;
+   gp->moff[0] = 0;
+   gp->moff[1] = 3;
+   gp->exist = 0x03;
+   if( ld->tex != NULL ) {
+      gp->moff[2] = gp->nglm;
+      gp->nglm += 2;
+      gp->exist |= 0x04;
+   }
+   if( ld->col != NULL ) {
+      gp->moff[3] = gp->nglm;
+      gp->nglm += 4;
+      gp->exist |= 0x08;
+   }
+   size_t vsize = ((size_t) gp->nglm) * sizeof(GLfloat);
+
+   struct inmesh_task_s *tk = (struct inmesh_task_s*)
+                  calloc( (size_t) num_tasks, sizeof(struct inmesh_task_s) );
+   if( tk == NULL ) return -1;
+
+   long num = 3*ld->num[3];
+   int32_t *uc = NULL;
+   if( iflags & ( INMESH_INDEXED | INMESH_WELD ) ) {
+      uc = inMeshCorners( ld, gp, &num );
+      if( uc == NULL ) {
+         free( tk );
+         return -1;
+      }
+      gp->index_count = (int) (3*ld->num[3]);
+   }
+
+   gp->vertex_count = (int) num;
+   gp->vdata = (GLfloat*) malloc( ((size_t) num) * vsize );
+   if( gp->vdata == NULL ) {
+      if( uc != NULL ) free( uc );
+      free( tk );
+      return -1;
+   }
+
+   long nitem = ( uc != NULL ) ? num : ld->num[3];
+   for(int n=0;n<num_tasks;++n) {
+      tk[n].ld = ld;
+      tk[n].gp = gp;
+      tk[n].uc = uc;
+      tk[n].n0 = nitem * n / num_tasks;
+      tk[n].n1 = nitem * (n+1) / num_tasks;
+   }
+   inMeshRun( pool, ( uc != NULL ) ? inMeshNodeTask : inMeshTriTask,
+              tk, num_tasks, 1 );
+   free( tk );
+   if( uc != NULL ) free( uc );
+   if( ld->ierr ) return 2;
+
+   if( iflags & INMESH_WELD ) {
+      if( inMeshWeld( gp ) ) return -1;
+      GLfloat *v = (GLfloat*) realloc( gp->vdata,
+                                       ((size_t) gp->vertex_count) * vsize );
+      if( v != NULL ) gp->vdata = v;
+   }
+   if( gp->index_count > 0 && ld->nrm == NULL ) inMeshSmooth( gp );
+
+   inoglGroupBounds( gp );
+   return 0;
+}
+
+
+//
+// Function to load a mesh into a group; the number of threads is that of the
+// pool that parses the file (less than one means one per core, and one means
+// that the caller does it all). Returns 1 if the file cannot be read, 2 if
+// it is not understood, and -1 if memory runs out.
+//
+
+int inMeshLoad( const char *fname, int iflags, int num_threads,
+                struct inogl_grp_s *gp )
+{
+   inoglGroupInit( gp );
+
+   int fd = open( fname, O_RDONLY );
+   if( fd < 0 ) {
+      fprintf( stdout, " [Mesh]  Could not open \"%s\"\n", fname );
+      return 1;
+   }
+   struct stat st;
+   if( fstat( fd, &st ) != 0 || st.st_size < 1 ) {
+      fprintf( stdout, " [Mesh]  Could not read \"%s\"\n", fname );
+      close( fd );
+      return 1;
+   }
+
+   struct inmesh_load_s ld;
+   memset( &ld, 0, sizeof(struct inmesh_load_s) );
+   ld.size = (size_t) st.st_size;
+   void *base = mmap( NULL, ld.size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if( base == MAP_FAILED ) {
+      fprintf( stdout, " [Mesh]  Could not map \"%s\"\n", fname );
+      return 1;
+   }
+   (void) madvise( base, ld.size, MADV_WILLNEED );
+   ld.base = (const char*) base;
+
+   // a few chunks per thread, for the threads to even out
+   struct in_pool_s pool, *pp = NULL;
+   int num_tasks = 1;
+   if( num_threads != 1 && inPoolInit( &pool, num_threads ) == 0 ) {
+      pp = &pool;
+      num_tasks = 4 * pool.num_workers;
+   }
+
+   int ierr;
+   if( ld.size > 3 && memcmp( ld.base, "ply", 3 ) == 0 &&
+       ( ld.base[3] == '\n' || ld.base[3] == '\r' ) ) {
+      ierr = inMeshPly( &ld, pp, num_tasks );
+   } else {
+      ierr = inMeshObj( &ld, pp, num_tasks );
+   }
+   if( ierr == 0 && ld.ierr ) ierr = 2;
+   if( ierr == 0 ) ierr = inMeshBuild( &ld, iflags, pp, num_tasks, gp );
+
+   if( pp != NULL ) inPoolFree( pp );
+   if( ld.pos != NULL ) free( ld.pos );
+   if( ld.tex != NULL ) free( ld.tex );
+   if( ld.nrm != NULL ) free( ld.nrm );
+   if( ld.col != NULL ) free( ld.col );
+   if( ld.corner != NULL ) free( ld.corner );
+   munmap( base, ld.size );
+
+   if( ierr ) {
+      fprintf( stdout, " [Mesh]  Could not load \"%s\" (%s)\n", fname,
+               ierr < 0 ? "memory" : "format" );
+      inMeshFree( gp );
+      return ierr;
+   }
+   fprintf( stdout, " [Mesh]  \"%s\": %ld triangles, %d vertices, %d indices\n",
+            fname, ld.num[3], gp->vertex_count, gp->index_count );
+   return 0;
+}
+
+void inMeshFree( struct inogl_grp_s *gp )
+{
+   if( gp->vdata != NULL ) free( gp->vdata );
+   if( gp->idata != NULL ) free( gp->idata );
+   gp->vdata = NULL;
+   gp->idata = NULL;
+   gp->vertex_count = 0;
+   gp->index_count = 0;
+}
+
+
+//
+// Plot3D grids of structured surfaces: the blocks, each with the nodes of an
+// "im" by "jm" (by "km") grid and their coordinates as three arrays (of all
+// of "x", then "y", then "z", with "i" fastest), and possibly the blanking
+// that follows them (which is not used). The plane "k=1" of every block is
+// the surface (it is the wall of the volume grids of a CFD solver).
+//
+struct inmesh_p3d_block_s {
+   long im, jm, km;
+   const char *d;             // the coordinates of the nodes (x, y, then z)
+   size_t nn;                 // nodes per coordinate (of the surface in text)
+   size_t lsub;               // bytes of a subrecord; 0 if the record is whole
+   int type;                  // of the values (a PLY type; float or double)
+   long t0;                   // first value of the block (text only)
+};
+
+//
+// a level of the pyramid of a block: every "istep" node (and the last) along
+// both directions
+//
+struct inmesh_p3d_lod_s {
+   const struct inmesh_p3d_block_s *bk;
+   long istep;
+   long ni, nj;
+};
+
+struct inmesh_p3d_s {
+   long nb;
+   struct inmesh_p3d_block_s *bk;
+   long nhead;                // values of the header (text only)
+   int ncoord;                // values per node (4 with blanking; text only)
+   float *vals;               // the coordinates of the surfaces (text only)
+};
+
+#define INMESH_P3D_SEP(c)  ( INMESH_SPACE(c) || (c) == '\n' || (c) == ',' )
+#define INMESH_P3D_NODES   (64*1024)      // nodes made by a task (about)
+
+
+//
+// Binary files are either of plain values, or of the records of Fortran
+// (each with its size before and after it); integers are 4 bytes, values
+// are 4 or 8 bytes, and either byte order can be read. There is a header of
+// the number of blocks and their sizes, or only the size of one block. Of
+// all these what matches the size of the file exactly is taken.
+//
+// Records over 2 GiB are written by gfortran as subrecords, each with its
+// markers, where all but the last are of the same size and have a negative
+// marker before them; the values of such a block are read across the markers.
+//
+
+static long inMeshP3dInt( const char *p, int iswap )
+{
+   return (long) inMeshPlyGet( p, INMESH_PLY_I32, iswap );
+}
+
+// "num" integers (in a record); NULL if they are not there
+static const char* inMeshP3dInts( const char *p, const char *e, int ifort,
+                                  int iswap, long num, long *v )
+{
+   size_t len = 4*((size_t) num);
+   size_t m = ifort ? 4 : 0;
+   if( (size_t) (e - p) < len + 2*m ) return NULL;
+   if( ifort && inMeshP3dInt( p, iswap ) != (long) len ) return NULL;
+   p += m;
+   for(long n=0;n<num;++n) v[n] = inMeshP3dInt( p + 4*n, iswap );
+   p += len;
+   if( ifort && inMeshP3dInt( p, iswap ) != (long) len ) return NULL;
+   return p + m;
+}
+
+// the record of "len" bytes at "p" (maybe of subrecords); NULL if it is not
+static const char* inMeshP3dRecord( const char *p, const char *e, int iswap,
+                                    size_t len, size_t *lsub )
+{
+   *lsub = 0;
+   for(int n=0;;++n) {
+      if( (size_t) (e - p) < 8 ) return NULL;
+      long m = inMeshP3dInt( p, iswap );
+      size_t l = (size_t) ( m < 0 ? -m : m );
+      if( l == 0 || l > len || l > (size_t) (e - p) - 8 ) return NULL;
+      long t = inMeshP3dInt( p + 4 + l, iswap );
+      if( (size_t) ( t < 0 ? -t : t ) != l ) return NULL;
+      if( n > 0 && ( l > *lsub || ( m < 0 && l != *lsub ) ) ) return NULL;
+      p += l + 8;
+      len -= l;
+      if( m > 0 ) return len == 0 ? p : NULL;
+      if( n == 0 ) *lsub = l;
+   }
+}
+
+static int inMeshP3dTry( struct inmesh_load_s *ld, struct inmesh_p3d_s *pd,
+                         int iswap, int ifort, int imulti )
+{
+   const char *p = ld->base, *e = ld->base + ld->size;
+   long nb = 1;
+   if( imulti ) {
+      p = inMeshP3dInts( p, e, ifort, iswap, 1, &nb );
+      if( p == NULL || nb < 1 || nb > (long) (ld->size/12) ) return 2;
+   }
+   long *dims = (long*) malloc( 3*((size_t) nb)*sizeof(long) );
+   if( dims == NULL ) return -1;
+   p = inMeshP3dInts( p, e, ifort, iswap, 3*nb, dims );
+
+   // the nodes of all blocks (each of which takes 12 bytes at least)
+   double sum = 0.0;
+   for(long b=0;p != NULL && b<nb;++b) {
+      for(int k=0;k<3;++k) if( dims[3*b+k] < 1 ) p = NULL;
+      sum += (double) dims[3*b] * (double) dims[3*b+1] * (double) dims[3*b+2];
+   }
+   if( p == NULL || 12.0*sum > (double) (e - p) ) {
+      free( dims );
+      return 2;
+   }
+
+   pd->bk = (struct inmesh_p3d_block_s*)
+                       calloc( (size_t) nb, sizeof(struct inmesh_p3d_block_s) );
+   if( pd->bk == NULL ) {
+      free( dims );
+      return -1;
+   }
+
+   // the blocks one after the other, each a record of the size it should be
+   for(int n=0;n<4;++n) {
+      size_t vsize = ( n & 1 ) ? 8 : 4;
+      size_t iblank = ( n & 2 ) ? 4 : 0;
+      const char *q = p;
+      for(long b=0;q != NULL && b<nb;++b) {
+         struct inmesh_p3d_block_s *bk = &( pd->bk[b] );
+         bk->im = dims[3*b];
+         bk->jm = dims[3*b+1];
+         bk->km = dims[3*b+2];
+         bk->type = ( vsize == 8 ) ? INMESH_PLY_F64 : INMESH_PLY_F32;
+         bk->nn = (size_t) ( bk->im * bk->jm * bk->km );
+         size_t len = bk->nn*( 3*vsize + iblank );
+         if( ifort ) {
+            bk->d = q + 4;
+            q = inMeshP3dRecord( q, e, iswap, len, &( bk->lsub ) );
+         } else {
+            bk->d = q;
+            q = ( (size_t) (e - q) < len ) ? NULL : q + len;
+         }
+      }
+      if( q != e ) continue;
+
+      pd->nb = nb;
+      ld->iswap = iswap;
+      free( dims );
+      return 0;
+   }
+
+   free( pd->bk );
+   pd->bk = NULL;
+   free( dims );
+   return 2;
+}
+
+static int inMeshP3dBinary( struct inmesh_load_s *ld, struct inmesh_p3d_s *pd )
+{
+   for(int n=0;n<8;++n) {
+      int ierr = inMeshP3dTry( ld, pd, n & 1, ( n >> 1 ) & 1, !( n >> 2 ) );
+      if( ierr <= 0 ) return ierr;
+   }
+   return 2;
+}
+
+
+//
+// Text files have the same header and values as the binary files; the text
+// is cut in chunks of lines, where the first pass counts the values and the
+// second puts the coordinates of the surfaces in place, knowing which value
+// of the file the first of its chunk is
+//
+
+static void inMeshP3dTextTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   const struct inmesh_p3d_s *pd = (const struct inmesh_p3d_s*) tk->elem;
+   const char *p = tk->p0, *e = tk->p1;
+
+   if( tk->ipass == 0 ) {
+      long n = 0;
+      while( p < e ) {
+         while( p < e && INMESH_P3D_SEP(*p) ) ++p;
+         if( p == e ) break;
+         ++n;
+         while( p < e && !INMESH_P3D_SEP(*p) ) ++p;
+      }
+      tk->cnt[0] = n;
+      return;
+   }
+
+   // the block of the first value of the chunk, and the values after it
+   long t = tk->first[0] - pd->nhead;
+   long b = 0;
+   while( b < pd->nb-1 && pd->bk[b+1].t0 <= t ) ++b;
+   for(long n=0;n<tk->cnt[0];++n,++t) {
+      while( p < e && INMESH_P3D_SEP(*p) ) ++p;
+      if( t < 0 ) {
+         while( p < e && !INMESH_P3D_SEP(*p) ) ++p;
+         continue;
+      }
+      while( b < pd->nb-1 && pd->bk[b+1].t0 <= t ) ++b;
+      const struct inmesh_p3d_block_s *bk = &( pd->bk[b] );
+      long ns = bk->im * bk->jm, nn = ns * bk->km;
+      long c = ( t - bk->t0 ) / nn, i = ( t - bk->t0 ) % nn;
+      if( c < 3 && i < ns ) {
+         float f;
+         const char *q = inMeshFloat( p, e, &f );
+         if( q == NULL || ( q < e && !INMESH_P3D_SEP(*q) ) ) {
+            inMeshError( tk->ld );
+            return;
+         }
+         ((float*) bk->d)[ c*ns + i ] = f;
+         p = q;
+      } else {
+         while( p < e && !INMESH_P3D_SEP(*p) ) ++p;
+      }
+   }
+}
+
+static int inMeshP3dText( struct inmesh_load_s *ld, struct inmesh_p3d_s *pd,
+                          struct in_pool_s *pool, int num_tasks )
+{
+   const char *p = ld->base, *e = ld->base + ld->size;
+   for(const char *q=p;q<e && q<p+4096;++q) {
+      if( *q == '\0' ) return 2;
+   }
+   ld->iswap = -1;
+
+   struct inmesh_task_s *tk = (struct inmesh_task_s*)
+                  calloc( (size_t) num_tasks, sizeof(struct inmesh_task_s) );
+   if( tk == NULL ) return -1;
+   int num = inMeshSplit( ld, p, e, num_tasks, tk );
+   for(int n=0;n<num;++n) tk[n].elem = (const void*) pd;
+   inMeshRun( pool, inMeshP3dTextTask, tk, num, 0 );
+   inMeshPrefix( ld, tk, num, 0, 0 );
+   long ntot = ld->num[0];
+
+   // the header of many blocks, or of one; what accounts for all values
+   long h = 0;
+   while( p < e && INMESH_P3D_SEP(*p) ) ++p;
+   if( inMeshInt( p, e, &h ) == NULL ) h = 0;
+   int ierr = 2;
+   for(int imulti=1;imulti>=0 && ierr == 2 && h > 0;--imulti) {
+      long nb = imulti ? h : 1;
+      if( nb > ntot/4 ) continue;
+      pd->bk = (struct inmesh_p3d_block_s*)
+                       calloc( (size_t) nb, sizeof(struct inmesh_p3d_block_s) );
+      if( pd->bk == NULL ) {
+         ierr = -1;
+         break;
+      }
+      pd->nb = nb;
+      pd->nhead = 3*nb + imulti;
+
+      const char *q = p;
+      long d = 0, sum = 0;
+      for(long n=0;n<pd->nhead && q != NULL;++n) {
+         q = inMeshInt( q, e, &d );
+         while( q != NULL && q < e && INMESH_P3D_SEP(*q) ) ++q;
+         if( n < imulti ) continue;
+         if( d < 1 || d > ntot ) q = NULL;
+         struct inmesh_p3d_block_s *bk = &( pd->bk[ (n-imulti)/3 ] );
+         long m = (n-imulti) % 3;
+         if( m == 0 ) bk->im = d; else if( m == 1 ) bk->jm = d; else bk->km = d;
+      }
+      for(long b=0;q != NULL && b<nb;++b) {
+         struct inmesh_p3d_block_s *bk = &( pd->bk[b] );
+         if( (double) bk->im * (double) bk->jm * (double) bk->km >
+             (double) ntot ) q = NULL; else sum += bk->im * bk->jm * bk->km;
+      }
+      if( q != NULL ) {
+         pd->ncoord = 0;
+         if( ntot - pd->nhead == 3*sum ) pd->ncoord = 3;
+         if( ntot - pd->nhead == 4*sum ) pd->ncoord = 4;
+      }
+      if( q == NULL || pd->ncoord == 0 ) {
+         free( pd->bk );
+         pd->bk = NULL;
+         pd->nb = 0;
+         continue;
+      }
+
+      // the surfaces only are kept
+      size_t ns = 0;
+      for(long b=0;b<nb;++b) ns += (size_t) ( pd->bk[b].im * pd->bk[b].jm );
+      pd->vals = (float*) malloc( 3*ns*sizeof(float) );
+      if( pd->vals == NULL ) {
+         ierr = -1;
+         break;
+      }
+      ns = 0;
+      long t0 = 0;
+      for(long b=0;b<nb;++b) {
+         struct inmesh_p3d_block_s *bk = &( pd->bk[b] );
+         size_t n = (size_t) ( bk->im * bk->jm );
+         bk->d = (const char*) &( pd->vals[ns] );
+         bk->nn = n;
+         bk->type = INMESH_PLY_F32;
+         bk->t0 = t0;
+         ns += 3*n;
+         t0 += pd->ncoord * bk->im * bk->jm * bk->km;
+      }
+      ierr = 0;
+   }
+
+   if( ierr == 0 ) inMeshRun( pool, inMeshP3dTextTask, tk, num, 1 );
+   free( tk );
+   return ierr;
+}
+
+
+//
+// Functions that make the groups of the levels of the blocks: vertices of
+// position, normal (from the nodes around, at the spacing of the level) and
+// texel (the node's "i" and "j" over the block's), and the indices of two
+// triangles per quad that wind counter-clockwise around the normal
+//
+
+static void inMeshP3dNode( const struct inmesh_p3d_block_s *bk, int iswap,
+                           long i, long j, float *v )
+{
+   size_t vsize = inmesh_ply_size[ bk->type ];
+   size_t n = ((size_t) j)*((size_t) bk->im) + (size_t) i;
+   for(int k=0;k<3;++k) {
+      size_t o = ( k*bk->nn + n )*vsize;
+      if( bk->lsub == 0 ) {
+         v[k] = (float) inMeshPlyGet( bk->d + o, bk->type, iswap );
+         continue;
+      }
+      // a value may be split by the markers between two subrecords
+      char c[8];
+      for(size_t m=0;m<vsize;++m) c[m] = bk->d[ o+m + 8*((o+m)/bk->lsub) ];
+      v[k] = (float) inMeshPlyGet( c, bk->type, iswap );
+   }
+}
+
+static void inMeshP3dTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   const struct inmesh_p3d_lod_s *lv = (const struct inmesh_p3d_lod_s*) tk->elem;
+   const struct inmesh_p3d_block_s *bk = lv->bk;
+   const struct inogl_grp_s *gp = tk->gp;
+   int iswap = ( tk->ld->iswap > 0 );
+   long s = lv->istep, ni = lv->ni, im = bk->im, jm = bk->jm;
+
+   for(long b=tk->n0;b<tk->n1;++b) {
+      long j = b*s < jm-1 ? b*s : jm-1;
+      long j0 = j-s > 0 ? j-s : 0, j1 = j+s < jm-1 ? j+s : jm-1;
+      for(long a=0;a<ni;++a) {
+         long i = a*s < im-1 ? a*s : im-1;
+         long i0 = i-s > 0 ? i-s : 0, i1 = i+s < im-1 ? i+s : im-1;
+         GLfloat *v = gp->vdata + ((size_t) (b*ni + a))*8;
+         float p0[3], p1[3], q0[3], q1[3];
+         inMeshP3dNode( bk, iswap, i, j, v );
+         inMeshP3dNode( bk, iswap, i0, j, p0 );
+         inMeshP3dNode( bk, iswap, i1, j, p1 );
+         inMeshP3dNode( bk, iswap, i, j0, q0 );
+         inMeshP3dNode( bk, iswap, i, j1, q1 );
+         float u[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+         float w[3] = { q1[0]-q0[0], q1[1]-q0[1], q1[2]-q0[2] };
+         v[3] = u[1]*w[2] - u[2]*w[1];
+         v[4] = u[2]*w[0] - u[0]*w[2];
+         v[5] = u[0]*w[1] - u[1]*w[0];
+         inMeshNormalize( v + 3 );
+         v[6] = (GLfloat) i / (GLfloat) (im-1);
+         v[7] = (GLfloat) j / (GLfloat) (jm-1);
+      }
+
+      if( b == lv->nj-1 ) continue;
+      GLuint *ic = gp->idata + 6*((size_t) (b*(ni-1)));
+      for(long a=0;a<ni-1;++a) {
+         GLuint n = (GLuint) (b*ni + a);
+         ic[0] = n;     ic[1] = n + 1;               ic[2] = n + (GLuint) ni;
+         ic[3] = n + 1; ic[4] = n + (GLuint) ni + 1; ic[5] = n + (GLuint) ni;
+         ic += 6;
+      }
+   }
+}
+
+static void inMeshP3dBoundsTask( void *arg )
+{
+   struct inmesh_task_s *tk = (struct inmesh_task_s*) arg;
+   inoglGroupBounds( tk->gp );
+}
+
+static int inMeshP3dBuild( struct inmesh_load_s *ld, struct inmesh_p3d_s *pd,
+                           int num_levels, struct in_pool_s *pool,
+                           struct inogl_grp_s *gps )
+{
+   size_t ng = ((size_t) pd->nb)*((size_t) num_levels);
+   struct inmesh_p3d_lod_s *lv = (struct inmesh_p3d_lod_s*)
+                                 calloc( ng, sizeof(struct inmesh_p3d_lod_s) );
+   if( lv == NULL ) return -1;
+
+   // the levels and their groups (blocks of a line of nodes have none)
+   long num = 0;
+   for(size_t g=0;g<ng;++g) {
+      const struct inmesh_p3d_block_s *bk = &( pd->bk[ g/num_levels ] );
+      struct inogl_grp_s *gp = &( gps[g] );
+      lv[g].bk = bk;
+      lv[g].istep = 1L << ( g % num_levels );
+      lv[g].ni = ( bk->im - 1 + lv[g].istep - 1 )/lv[g].istep + 1;
+      lv[g].nj = ( bk->jm - 1 + lv[g].istep - 1 )/lv[g].istep + 1;
+      gp->nglm = 3 + 3 + 2;
+      gp->moff[0] = 0;
+      gp->moff[1] = 3;
+      gp->moff[2] = 6;
+      gp->exist = 0x07;
+      gp->mode = GL_TRIANGLES;
+      if( bk->im < 2 || bk->jm < 2 ) continue;
+
+      double ni = 6.0 * (double) (lv[g].ni-1) * (double) (lv[g].nj-1);
+      if( ni > (double) 0x7fffffff ) {
+         free( lv );
+         return 3;
+      }
+      gp->vertex_count = (int) ( lv[g].ni * lv[g].nj );
+      gp->index_count = (int) ni;
+      gp->vdata = (GLfloat*) malloc( ((size_t) gp->vertex_count) *
+                                     ((size_t) gp->nglm) * sizeof(GLfloat) );
+      gp->idata = (GLuint*) malloc( ((size_t) gp->index_count) *
+                                    sizeof(GLuint) );
+      if( gp->vdata == NULL || gp->idata == NULL ) {
+         free( lv );
+         return -1;
+      }
+      num += ( lv[g].ni * lv[g].nj + INMESH_P3D_NODES-1 ) / INMESH_P3D_NODES;
+   }
+
+   // tasks of a few rows of a level each, and then one per group
+   struct inmesh_task_s *tk = (struct inmesh_task_s*)
+                  calloc( (size_t) ( num > (long) ng ? num : (long) ng ),
+                          sizeof(struct inmesh_task_s) );
+   if( tk == NULL ) {
+      free( lv );
+      return -1;
+   }
+   int nt = 0;
+   for(size_t g=0;g<ng;++g) {
+      if( gps[g].vdata == NULL ) continue;
+      long nrow = INMESH_P3D_NODES / lv[g].ni;
+      if( nrow < 1 ) nrow = 1;
+      for(long b=0;b<lv[g].nj;b+=nrow) {
+         tk[nt].ld = ld;
+         tk[nt].elem = (const void*) &( lv[g] );
+         tk[nt].gp = &( gps[g] );
+         tk[nt].n0 = b;
+         tk[nt].n1 = b + nrow < lv[g].nj ? b + nrow : lv[g].nj;
+         ++nt;
+      }
+   }
+   inMeshRun( pool, inMeshP3dTask, tk, nt, 1 );
+
+   for(size_t g=0;g<ng;++g) tk[g].gp = &( gps[g] );
+   inMeshRun( pool, inMeshP3dBoundsTask, tk, (int) ng, 1 );
+
+   free( tk );
+   free( lv );
+   return 0;
+}
+
+
+//
+// Function to load a Plot3D grid of surfaces into groups; see the header.
+// Returns as "inMeshLoad()" does, or 3 if a group would be too large (of more
+// indices than an "int" counts).
+//
+
+int inMeshLoadPlot3D( const char *fname, int num_levels, int num_threads,
+                      int *num_blocks, struct inogl_grp_s **gps )
+{
+   *num_blocks = 0;
+   *gps = NULL;
+   if( num_levels < 1 || num_levels > INOGL_MAX_LOD ) {
+      fprintf( stdout, " [Mesh]  Levels must be 1 to %d\n", INOGL_MAX_LOD );
+      return 2;
+   }
+
+   int fd = open( fname, O_RDONLY );
+   if( fd < 0 ) {
+      fprintf( stdout, " [Mesh]  Could not open \"%s\"\n", fname );
+      return 1;
+   }
+   struct stat st;
+   if( fstat( fd, &st ) != 0 || st.st_size < 1 ) {
+      fprintf( stdout, " [Mesh]  Could not read \"%s\"\n", fname );
+      close( fd );
+      return 1;
+   }
+
+   struct inmesh_load_s ld;
+   memset( &ld, 0, sizeof(struct inmesh_load_s) );
+   ld.size = (size_t) st.st_size;
+   void *base = mmap( NULL, ld.size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if( base == MAP_FAILED ) {
+      fprintf( stdout, " [Mesh]  Could not map \"%s\"\n", fname );
+      return 1;
+   }
+   (void) madvise( base, ld.size, MADV_WILLNEED );
+   ld.base = (const char*) base;
+
+   struct in_pool_s pool, *pp = NULL;
+   int num_tasks = 1;
+   if( num_threads != 1 && inPoolInit( &pool, num_threads ) == 0 ) {
+      pp = &pool;
+      num_tasks = 4 * pool.num_workers;
+   }
+
+   struct inmesh_p3d_s pd;
+   memset( &pd, 0, sizeof(struct inmesh_p3d_s) );
+   int ierr = inMeshP3dBinary( &ld, &pd );
+   if( ierr == 2 ) ierr = inMeshP3dText( &ld, &pd, pp, num_tasks );
+   if( ierr == 0 && ld.ierr ) ierr = 2;
+   if( ierr == 0 && pd.nb > 0x7fffffffL / num_levels ) ierr = 3;
+   struct inogl_grp_s *g = NULL;
+   if( ierr == 0 ) {
+      g = (struct inogl_grp_s*) calloc( ((size_t) pd.nb)*((size_t) num_levels),
+                                        sizeof(struct inogl_grp_s) );
+      ierr = ( g == NULL ) ? -1 : inMeshP3dBuild( &ld, &pd, num_levels, pp, g );
+   }
+
+   if( pp != NULL ) inPoolFree( pp );
+   if( pd.bk != NULL ) free( pd.bk );
+   if( pd.vals != NULL ) free( pd.vals );
+   munmap( base, ld.size );
+
+   if( ierr ) {
+      fprintf( stdout, " [Mesh]  Could not load \"%s\" (%s)\n", fname,
+               ierr < 0 ? "memory" : ( ierr == 3 ? "too large" : "format" ) );
+      if( g != NULL ) inMeshFreePlot3D( (int) pd.nb * num_levels, g );
+      return ierr;
+   }
+   long nv = 0;
+   for(long b=0;b<pd.nb;++b) nv += g[b*num_levels].vertex_count;
+   fprintf( stdout, " [Mesh]  \"%s\": %ld blocks, %ld nodes, %d levels\n",
+            fname, pd.nb, nv, num_levels );
+   *num_blocks = (int) pd.nb;
+   *gps = g;
+   return 0;
+}
+
+void inMeshFreePlot3D( int num_groups, struct inogl_grp_s *gps )
+{
+   for(int n=0;n<num_groups;++n) inMeshFree( &( gps[n] ) );
+   free( gps );
+}
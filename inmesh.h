@@ -0,0 +1,61 @@
+#ifndef _INMESH_H_
+#define _INMESH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "inogl.h"
+
+//
+// Loading of triangle meshes from Wavefront OBJ and PLY (ASCII and binary)
+// files into a group. The file is mapped, not read, and it is cut in chunks
+// (of whole lines, or of records) that are parsed by a pool of threads; a
+// first pass counts what each chunk holds and a second pass converts values
+// straight into place. Polygons are split in fans of triangles.
+//
+// The vertices of the group are interleaved as position, normal, texel and
+// colour, with the texels and colours only when the file has them (see the
+// "exist" bits and offsets of the group); normals that are not in the file
+// are made from the triangles. The group is ready for "inoglMakeGroupVAOVBO()"
+// and it draws GL_TRIANGLES. Flags:
+//  INMESH_INDEXED  one vertex per distinct combination of position, texel and
+//                  normal of the file, and indices; independent triangles
+//                  (three vertices each) otherwise
+//  INMESH_WELD     indexed, with vertices that are equal (bit for bit) in all
+//                  their components merged into one
+//
+#define INMESH_INDEXED  0x01
+#define INMESH_WELD     0x02
+
+int inMeshLoad( const char *fname, int iflags, int num_threads,
+                struct inogl_grp_s *gp );
+
+void inMeshFree( struct inogl_grp_s *gp );
+
+//
+// Loading of Plot3D grids of structured surfaces (the multi-block and the
+// single-block kinds; in binary, of plain values or of Fortran records, of
+// floats or doubles and of either byte order, or in text; with or without
+// blanking) into groups. The file is mapped and the blocks are made into
+// groups by a pool of threads. Of a volume block the plane "k=1" is taken.
+// Records over 2 GiB (that gfortran writes as subrecords) are read as well.
+//
+// Every block makes a pyramid of "num_levels" (up to INOGL_MAX_LOD) groups
+// with the nodes of the block subsampled: level "l" takes every 2^l-th node
+// (and the last) along "i" and "j", such that the edges of the blocks stay
+// where they are. The groups are in the order of the blocks, with the levels
+// of a block together (level "l" of block "b" is group "b*num_levels + l"),
+// ready for "inoglLodSelect()" and for uploading (or streaming) coarse levels
+// first. Vertices are position, normal and texel; the groups are indexed and
+// draw GL_TRIANGLES (those of blocks of a line of nodes are empty).
+//
+int inMeshLoadPlot3D( const char *fname, int num_levels, int num_threads,
+                      int *num_blocks, struct inogl_grp_s **gps );
+
+void inMeshFreePlot3D( int num_groups, struct inogl_grp_s *gps );
+
+#endif
+
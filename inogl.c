@@ -2,6 +2,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 //
@@ -12,6 +18,10 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #include "inogl.h"
 
 
@@ -424,6 +434,50 @@ void inoglCapabilities( struct inogl_s* p )
    fprintf( stdout, " [OpenGL]  Max Uniform Block Size: %d\n",
             maxUniformBlockSize );
    p->maxUniformBlockSize = maxUniformBlockSize;
+
+   glGetIntegerv( GL_MAJOR_VERSION, &( p->majorVersion ) );
+   glGetIntegerv( GL_MINOR_VERSION, &( p->minorVersion ) );
+   int iver = 10 * p->majorVersion + p->minorVersion;
+
+   p->hasBaseVertex = ( iver >= 32 ||
+            inoglHasExtension( p, "GL_ARB_draw_elements_base_vertex" ) );
+   p->hasMultiDrawIndirect = ( iver >= 43 ||
+            inoglHasExtension( p, "GL_ARB_multi_draw_indirect" ) );
+   p->hasBufferStorage = ( iver >= 44 ||
+            inoglHasExtension( p, "GL_ARB_buffer_storage" ) );
+   fprintf( stdout, " [OpenGL]  Base-vertex draws: %d, Multi-draw indirect: %d\n",
+            p->hasBaseVertex, p->hasMultiDrawIndirect );
+   p->hasPrimitiveRestart = ( iver >= 31 );
+   fprintf( stdout, " [OpenGL]  Buffer storage: %d, Primitive restart: %d\n",
+            p->hasBufferStorage, p->hasPrimitiveRestart );
+   p->hasInstancedArrays = ( iver >= 33 || ( iver >= 31 &&
+            inoglHasExtension( p, "GL_ARB_instanced_arrays" ) ) );
+   fprintf( stdout, " [OpenGL]  Instanced arrays: %d\n",
+            p->hasInstancedArrays );
+}
+
+
+//
+// Function to check for an extension in the extensions string
+// (Names are matched as whole tokens, such that a name is not mistaken for
+// the prefix of a longer one.)
+//
+
+int inoglHasExtension( const struct inogl_s* p, const char* name )
+{
+   const char* s = (const char*) p->oglExtensions;
+   size_t len = strlen( name );
+
+   if( s == NULL || len == 0 ) return 0;
+
+   while( ( s = strstr( s, name ) ) != NULL ) {
+      if( s[len] == ' ' || s[len] == '\0' ) {
+         if( s == (const char*) p->oglExtensions || s[-1] == ' ' ) return 1;
+      }
+      s += len;
+   }
+
+   return 0;
 }
 
 
@@ -623,32 +677,16 @@ INDEBUG_BLOCK( "init() rotLoc" )
 }
 
 //
-// Function to create the VAO and VBO of a group of triangles (made of vertices)
-// This function requires 3 position and 3 normal vector components, 3 texel
-// coordinates, and 4 color components (RGBA).
-// GLsizei nglm = 3 + 3 + 2 + 4;
-// GLsizei moff[4] = {0, 3, 6, 8};
+// Function to point the vertex attributes of the currently bound VAO to the
+// members of the group's vertex layout in the currently bound VBO
 //
 
-int inoglMakeGroupVAOVBO( struct inogl_grp_s *gp )
+static void inoglGroupAttribPointers( const struct inogl_grp_s *gp )
 {
    GLsizei nglm = gp->nglm;
    GLsizei moff[4];
    memcpy( moff, gp->moff, sizeof(moff) );
 
-   // create vertex buffer object...
-   glGenVertexArrays( 1, &( gp->VAO ) );   // later delete with glDelete...()
-   glBindVertexArray( gp->VAO );
-
-   glGenBuffers( 1, &( gp->VBO ) );   // later delete with glDelete...()
-   glBindBuffer( GL_ARRAY_BUFFER, gp->VBO );
-
-   // The order here is how they appear in my OBJ reader's returned data.
-   // The actual position index is dictated by the incoming offsets array.
-   glBufferData( GL_ARRAY_BUFFER,
-                 ((size_t) gp->vertex_count) * nglm * sizeof(float),
-                 gp->vdata, GL_STATIC_DRAW );
-
    if( gp->exist & 0x01 ) {    // lsb [____ 0001]
       glVertexAttribPointer( aPosition, 3, GL_FLOAT, GL_FALSE,
                              nglm * sizeof(float),
@@ -676,10 +714,66 @@ int inoglMakeGroupVAOVBO( struct inogl_grp_s *gp )
                              (void*) (moff[3] * sizeof(float)) );
       glEnableVertexAttribArray( aColor );
    }
+}
 
-   // unbind VBO and VAO
-   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+//
+// Function to set up a group with nothing in it: no objects, no indices, and
+// independent triangles (the defaults of all that a caller does not fill)
+//
+
+void inoglGroupInit( struct inogl_grp_s *gp )
+{
+   memset( gp, 0, sizeof(struct inogl_grp_s) );
+}
+
+
+//
+// Function to create the VAO and VBO of a group of triangles (made of vertices)
+// This function requires 3 position and 3 normal vector components, 3 texel
+// coordinates, and 4 color components (RGBA).
+// GLsizei nglm = 3 + 3 + 2 + 4;
+// GLsizei moff[4] = {0, 3, 6, 8};
+//
+
+int inoglMakeGroupVAOVBO( struct inogl_grp_s *gp )
+{
+   GLsizei nglm = gp->nglm;
+
+   // create vertex buffer object...
+   glGenVertexArrays( 1, &( gp->VAO ) );   // later delete with glDelete...()
+   glBindVertexArray( gp->VAO );
+
+   glGenBuffers( 1, &( gp->VBO ) );   // later delete with glDelete...()
+   glBindBuffer( GL_ARRAY_BUFFER, gp->VBO );
+
+   // The order here is how they appear in the data of the mesh loader (see
+   // "inmesh.h").
+   // The actual position index is dictated by the incoming offsets array.
+   glBufferData( GL_ARRAY_BUFFER,
+                 ((size_t) gp->vertex_count) * nglm * sizeof(float),
+                 gp->vdata, GL_STATIC_DRAW );
+   gp->first = 0;
+   inoglGroupBounds( gp );
+
+   inoglGroupAttribPointers( gp );
+
+   // the element buffer of an indexed group is part of the VAO's state
+   gp->EBO = 0;
+   gp->ifirst = 0;
+   if( gp->idata == NULL ) gp->index_count = 0;
+   if( gp->index_count > 0 ) {
+      glGenBuffers( 1, &( gp->EBO ) );   // later delete with glDelete...()
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, gp->EBO );
+      glBufferData( GL_ELEMENT_ARRAY_BUFFER,
+                    ((size_t) gp->index_count) * sizeof(GLuint),
+                    gp->idata, GL_STATIC_DRAW );
+   }
+
+   // unbind VBO and VAO (the VAO first, as it keeps the element buffer)
    glBindVertexArray(0);
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
 
    // trap left-over issues with the GL context
 // GLenum glerr;
@@ -692,3 +786,2570 @@ int inoglMakeGroupVAOVBO( struct inogl_grp_s *gp )
 }
 
 
+//
+// Function to place a number of groups back-to-back in a single VBO that is
+// wrapped by a single VAO; the groups must all have the same vertex layout
+// (that of the first group). Each group's "first" member is set to where its
+// vertices start, such that all groups can be drawn from the one VAO, and in
+// a single multi-draw call (see the batch functions below). Groups with
+// indices (all or none of them) are likewise placed back-to-back in a single
+// element buffer; their indices are offset by the group's first vertex when
+// uploaded (not the restart index), so that they draw without a base vertex.
+//
+
+int inoglMakeGroupsSharedVAOVBO( int num, struct inogl_grp_s *gps )
+{
+   if( num < 1 ) return 1;
+
+   const struct inogl_grp_s* g0 = &( gps[0] );
+   size_t nvert = 0, nidx = 0;
+   int max_idx = 0;
+   for(int n=0;n<num;++n) {
+      const struct inogl_grp_s* gp = &( gps[n] );
+      if( gp->nglm != g0->nglm || gp->exist != g0->exist ||
+          memcmp( gp->moff, g0->moff, sizeof(gp->moff) ) != 0 ) {
+         fprintf( stdout, " [OpenGL]  Group %d layout differs from group 0\n",
+                  n );
+         return 2;
+      }
+      if( ( gp->idata != NULL ) != ( g0->idata != NULL ) ||
+          gp->restart != g0->restart ) {
+         fprintf( stdout, " [OpenGL]  Group %d indices differ from group 0\n",
+                  n );
+         return 2;
+      }
+      nvert += (size_t) gp->vertex_count;
+      nidx += (size_t) gp->index_count;
+      if( gp->index_count > max_idx ) max_idx = gp->index_count;
+   }
+   size_t vsize = ((size_t) g0->nglm) * sizeof(float);
+
+   GLuint* itmp = NULL;
+   if( g0->idata != NULL ) {
+      itmp = (GLuint*) malloc( ((size_t) max_idx + 1) * sizeof(GLuint) );
+      if( itmp == NULL ) {
+         fprintf( stdout, " [OpenGL]  Could not allocate index space\n" );
+         return -1;
+      }
+   }
+
+   GLuint vao, vbo;
+   glGenVertexArrays( 1, &vao );
+   glBindVertexArray( vao );
+
+   glGenBuffers( 1, &vbo );
+   glBindBuffer( GL_ARRAY_BUFFER, vbo );
+   glBufferData( GL_ARRAY_BUFFER, nvert * vsize, NULL, GL_STATIC_DRAW );
+
+   GLint first = 0;
+   for(int n=0;n<num;++n) {
+      struct inogl_grp_s* gp = &( gps[n] );
+      glBufferSubData( GL_ARRAY_BUFFER, ((size_t) first) * vsize,
+                       ((size_t) gp->vertex_count) * vsize, gp->vdata );
+      gp->VAO = vao;
+      gp->VBO = vbo;
+      gp->first = first;
+      first += gp->vertex_count;
+      inoglGroupBounds( gp );
+      if( itmp == NULL ) {
+         gp->EBO = 0;
+         gp->ifirst = 0;
+         gp->index_count = 0;
+      }
+   }
+
+   inoglGroupAttribPointers( g0 );
+
+   if( itmp != NULL ) {
+      GLuint ebo;
+      glGenBuffers( 1, &ebo );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebo );
+      glBufferData( GL_ELEMENT_ARRAY_BUFFER, nidx * sizeof(GLuint),
+                    NULL, GL_STATIC_DRAW );
+
+      GLint ifirst = 0;
+      for(int n=0;n<num;++n) {
+         struct inogl_grp_s* gp = &( gps[n] );
+         for(int i=0;i<gp->index_count;++i) {
+            GLuint k = gp->idata[i];
+            itmp[i] = ( gp->restart != 0 && k == gp->restart ) ?
+                      k : k + (GLuint) gp->first;
+         }
+         glBufferSubData( GL_ELEMENT_ARRAY_BUFFER,
+                          ((size_t) ifirst) * sizeof(GLuint),
+                          ((size_t) gp->index_count) * sizeof(GLuint), itmp );
+         gp->EBO = ebo;
+         gp->ifirst = ifirst;
+         ifirst += gp->index_count;
+      }
+      free( itmp );
+   }
+
+   glBindVertexArray(0);
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+   return 0;
+}
+
+
+//
+// Function to draw a group from its (currently bound) VAO; groups with
+// indices are drawn with the indices in their element buffer, and with
+// primitive restart enabled for the draw when the group has a restart index
+//
+
+void inoglDrawGroup( const struct inogl_grp_s *gp )
+{
+   GLenum mode = ( gp->mode != 0 ) ? gp->mode : GL_TRIANGLES;
+
+   if( gp->index_count <= 0 ) {
+      glDrawArrays( mode, gp->first, gp->vertex_count );
+      return;
+   }
+
+   if( gp->restart != 0 ) {
+      glEnable( GL_PRIMITIVE_RESTART );
+      glPrimitiveRestartIndex( gp->restart );
+   }
+   glDrawElements( mode, gp->index_count, GL_UNSIGNED_INT,
+                   (const void*) (((size_t) gp->ifirst) * sizeof(GLuint)) );
+   if( gp->restart != 0 ) glDisable( GL_PRIMITIVE_RESTART );
+}
+
+
+//
+// Functions for drawing parametric shapes from the vertex index alone. The
+// copies of a draw are split over as many draw calls as it takes to keep the
+// vertex index within a (signed) integer.
+//
+
+int inoglProcInit( struct inogl_proc_s *pr, GLuint program )
+{
+   memset( pr, 0, sizeof(struct inogl_proc_s) );
+
+   glGenVertexArrays( 1, &( pr->VAO ) );   // later delete with glDelete...()
+   if( pr->VAO == 0 ) {
+      fprintf( stdout, " [OpenGL]  Could not make VAO for procedural shapes \n" );
+      return 1;
+   }
+
+   pr->program = program;
+   pr->nodesLoc = glGetUniformLocation( program, "procNodes" );
+   pr->shapeLoc = glGetUniformLocation( program, "procShape" );
+   pr->instLoc = glGetUniformLocation( program, "procInst" );
+   pr->stepLoc = glGetUniformLocation( program, "procStep" );
+   pr->xformLoc = glGetUniformLocation( program, "procXform" );
+   if( pr->nodesLoc == -1 || pr->instLoc == -1 ) {
+      fprintf( stdout, " [OpenGL]  Program %d has no procedural uniforms \n",
+               program );
+   }
+
+   return 0;
+}
+
+GLsizei inoglProcVertices( int im, int jm )
+{
+   if( im < 2 || jm < 2 ) return 0;
+   return (GLsizei) ( 6*(im-1)*(jm-1) );
+}
+
+void inoglProcDraw( const struct inogl_proc_s *pr, int shape, int im, int jm,
+                    GLfloat size, long num, int per_row,
+                    const GLfloat *step, const GLfloat *xform )
+{
+   static const GLfloat identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                         0.0f, 1.0f, 0.0f, 0.0f,
+                                         0.0f, 0.0f, 1.0f, 0.0f,
+                                         0.0f, 0.0f, 0.0f, 1.0f };
+   GLsizei nv = inoglProcVertices( im, jm );
+   if( nv <= 0 || num <= 0 ) return;
+   if( per_row < 1 ) per_row = 1;
+
+   glUniform2i( pr->nodesLoc, im, jm );
+   glUniform1i( pr->shapeLoc, shape );
+   glUniform4f( pr->stepLoc, step != NULL ? step[0] : 0.0f,
+                             step != NULL ? step[1] : 0.0f,
+                             step != NULL ? step[2] : 0.0f, size );
+   glUniformMatrix4fv( pr->xformLoc, 1, GL_FALSE,
+                       xform != NULL ? xform : identity );
+
+   glBindVertexArray( pr->VAO );
+   long nmax = (long) ( 2147483647 / nv );
+   for(long n=0;n<num;n+=nmax) {
+      long k = ( num - n < nmax ) ? num - n : nmax;
+      glUniform2i( pr->instLoc, per_row, (GLint) n );
+      glDrawArrays( GL_TRIANGLES, 0, (GLsizei) ( k * nv ) );
+   }
+   glBindVertexArray(0);
+}
+
+void inoglProcFree( struct inogl_proc_s *pr )
+{
+   if( pr->VAO != 0 ) glDeleteVertexArrays( 1, &( pr->VAO ) );
+   memset( pr, 0, sizeof(struct inogl_proc_s) );
+}
+
+
+//
+// Functions to collect draws in a batch and to submit them with multi-draw
+// calls. The batch is set up once (it can grow), reset at every frame, and
+// filled with the draws that are to be made with the same shader program.
+// Consecutive draws on the same VAO are submitted together, and consecutive
+// array draws of adjacent ranges are merged into a single draw when the mode
+// is of independent primitives (joined strips, fans or loops would make one
+// primitive across the two ranges).
+//
+
+static int inoglBatchReserve( struct inogl_batch_s *b, int max )
+{
+   size_t isize = (size_t) max;
+   GLuint* vao = (GLuint*) realloc( b->vao, isize*sizeof(GLuint) );
+   if( vao != NULL ) b->vao = vao;
+   GLint* first = (GLint*) realloc( b->first, isize*sizeof(GLint) );
+   if( first != NULL ) b->first = first;
+   GLsizei* count = (GLsizei*) realloc( b->count, isize*sizeof(GLsizei) );
+   if( count != NULL ) b->count = count;
+   GLint* bv = (GLint*) realloc( b->basevertex, isize*sizeof(GLint) );
+   if( bv != NULL ) b->basevertex = bv;
+   const void** ioff = (const void**) realloc( b->ioff, isize*sizeof(void*) );
+   if( ioff != NULL ) b->ioff = ioff;
+   GLuint* cmd = (GLuint*) realloc( b->cmd, 5*isize*sizeof(GLuint) );
+   if( cmd != NULL ) b->cmd = cmd;
+
+   if( vao == NULL || first == NULL || count == NULL ||
+       bv == NULL || ioff == NULL || cmd == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate batch of %d draws\n",
+               max );
+      return 1;
+   }
+   b->max = max;
+
+   return 0;
+}
+
+int inoglBatchInit( struct inogl_batch_s *b, GLenum mode, GLenum itype,
+                    int max, const struct inogl_s* ogl )
+{
+   if( max < 1 ) max = 16;
+
+   memset( b, 0, sizeof(struct inogl_batch_s) );
+   b->mode = mode;
+   b->itype = itype;
+
+   if( ogl != NULL && ogl->hasMultiDrawIndirect ) {
+      glGenBuffers( 1, &( b->IBO ) );
+   } else if( itype != 0 && ( ogl == NULL || !ogl->hasBaseVertex ) ) {
+      fprintf( stdout, " [OpenGL]  Batch of indexed draws needs base-vertex\n" );
+      return 1;
+   }
+
+   return inoglBatchReserve( b, max );
+}
+
+void inoglBatchReset( struct inogl_batch_s *b )
+{
+   b->num = 0;
+}
+
+int inoglBatchAddArrays( struct inogl_batch_s *b,
+                         GLuint vao, GLint first, GLsizei count )
+{
+   if( count <= 0 ) return 0;
+
+   int n = b->num;
+   int imerge = ( b->mode == GL_TRIANGLES || b->mode == GL_LINES ||
+                  b->mode == GL_POINTS );
+   if( imerge && n > 0 && b->vao[n-1] == vao &&
+       b->first[n-1] + b->count[n-1] == first ) {
+      b->count[n-1] += count;
+      return 0;
+   }
+
+   if( n == b->max ) {
+      if( inoglBatchReserve( b, 2*b->max ) ) return 1;
+   }
+   b->vao[n] = vao;
+   b->first[n] = first;
+   b->count[n] = count;
+   b->basevertex[n] = 0;
+   b->num = n + 1;
+
+   return 0;
+}
+
+int inoglBatchAddElements( struct inogl_batch_s *b, GLuint vao,
+                           GLint first, GLsizei count, GLint basevertex )
+{
+   if( count <= 0 ) return 0;
+
+   int n = b->num;
+   if( n == b->max ) {
+      if( inoglBatchReserve( b, 2*b->max ) ) return 1;
+   }
+   b->vao[n] = vao;
+   b->first[n] = first;
+   b->count[n] = count;
+   b->basevertex[n] = basevertex;
+   b->num = n + 1;
+
+   return 0;
+}
+
+int inoglBatchAddGroup( struct inogl_batch_s *b,
+                        const struct inogl_grp_s *gp )
+{
+   GLenum mode = ( gp->mode != 0 ) ? gp->mode : GL_TRIANGLES;
+   if( mode != b->mode ||
+       ( gp->index_count > 0 ) != ( b->itype == GL_UNSIGNED_INT ) ) {
+      fprintf( stdout, " [OpenGL]  Group does not draw like the batch\n" );
+      return 2;
+   }
+
+   // (the indices of groups are offset by their first vertex already; any
+   // primitive restart is to be enabled by the caller around the submission)
+   if( gp->index_count > 0 ) {
+      return inoglBatchAddElements( b, gp->VAO, gp->ifirst,
+                                    (GLsizei) gp->index_count, 0 );
+   }
+   return inoglBatchAddArrays( b, gp->VAO, gp->first,
+                               (GLsizei) gp->vertex_count );
+}
+
+void inoglBatchSubmit( struct inogl_batch_s *b )
+{
+   if( b->num == 0 ) return;
+
+   size_t isize = 0;
+   if( b->IBO != 0 ) {
+      // build the commands in the layout that the GL expects and push them
+      // to the indirect buffer (it is orphaned when it needs to grow)
+      GLuint* c = b->cmd;
+      for(int n=0;n<b->num;++n) {
+         *(c++) = (GLuint) b->count[n];
+         *(c++) = 1;                          // instance count
+         *(c++) = (GLuint) b->first[n];       // first vertex or first index
+         if( b->itype != 0 ) *(c++) = (GLuint) b->basevertex[n];
+         *(c++) = 0;                          // base instance
+      }
+      isize = (size_t) (c - b->cmd) * sizeof(GLuint);
+
+      glBindBuffer( GL_DRAW_INDIRECT_BUFFER, b->IBO );
+      if( (GLsizeiptr) isize > b->ibo_size ) {
+         b->ibo_size = (GLsizeiptr) (5 * ((size_t) b->max) * sizeof(GLuint));
+         glBufferData( GL_DRAW_INDIRECT_BUFFER, b->ibo_size, NULL,
+                       GL_STREAM_DRAW );
+      }
+      glBufferSubData( GL_DRAW_INDIRECT_BUFFER, 0, isize, b->cmd );
+   } else if( b->itype != 0 ) {
+      GLsizei is = (b->itype == GL_UNSIGNED_INT ? 4 :
+                   (b->itype == GL_UNSIGNED_SHORT ? 2 : 1 ));
+      for(int n=0;n<b->num;++n) {
+         b->ioff[n] = (const void*) (((size_t) b->first[n]) * is);
+      }
+   }
+
+   // one multi-draw call per run of draws on the same VAO
+   GLsizei stride = (GLsizei) ((b->itype != 0 ? 5 : 4) * sizeof(GLuint));
+   int n0 = 0;
+   while( n0 < b->num ) {
+      int n1 = n0 + 1;
+      while( n1 < b->num && b->vao[n1] == b->vao[n0] ) ++n1;
+      GLsizei nd = (GLsizei) (n1 - n0);
+
+      glBindVertexArray( b->vao[n0] );
+      if( b->IBO != 0 ) {
+         const void* off = (const void*) (((size_t) n0) * stride);
+         if( b->itype != 0 ) {
+            glMultiDrawElementsIndirect( b->mode, b->itype, off, nd, 0 );
+         } else {
+            glMultiDrawArraysIndirect( b->mode, off, nd, 0 );
+         }
+      } else {
+         if( b->itype != 0 ) {
+            glMultiDrawElementsBaseVertex( b->mode, &( b->count[n0] ),
+                                           b->itype,
+                                           (const void* const*) &( b->ioff[n0] ),
+                                           nd, &( b->basevertex[n0] ) );
+         } else {
+            glMultiDrawArrays( b->mode, &( b->first[n0] ),
+                               &( b->count[n0] ), nd );
+         }
+      }
+      n0 = n1;
+   }
+   glBindVertexArray(0);
+
+   if( b->IBO != 0 ) glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+void inoglBatchFree( struct inogl_batch_s *b )
+{
+   if( b->IBO != 0 ) glDeleteBuffers( 1, &( b->IBO ) );
+   if( b->vao != NULL ) free( b->vao );
+   if( b->first != NULL ) free( b->first );
+   if( b->count != NULL ) free( b->count );
+   if( b->basevertex != NULL ) free( b->basevertex );
+   if( b->ioff != NULL ) free( b->ioff );
+   if( b->cmd != NULL ) free( b->cmd );
+   memset( b, 0, sizeof(struct inogl_batch_s) );
+}
+
+
+//
+// Functions to manage a streaming vertex buffer of fenced regions. The buffer
+// is created (and persistently mapped when possible) in the context that is
+// current when calling the init function. Acquiring and committing can take
+// place in a different thread with a context that shares objects with it, and
+// so can the release. Acquiring does not block: a NULL pointer is returned if
+// there is no region whose fence has signaled, and the caller tries again.
+//
+
+int inoglStreamInit( struct inogl_stream_s *s, GLsizeiptr region_size,
+                     int num_regions, const struct inogl_s* ogl )
+{
+   memset( s, 0, sizeof(struct inogl_stream_s) );
+   if( num_regions < 1 || region_size < 1 ) return 1;
+
+   s->state = (int*) malloc( ((size_t) num_regions) * sizeof(int) );
+   s->fence = (GLsync*) malloc( ((size_t) num_regions) * sizeof(GLsync) );
+   if( s->state == NULL || s->fence == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate stream regions\n" );
+      if( s->state != NULL ) free( s->state );
+      if( s->fence != NULL ) free( s->fence );
+      return 2;
+   }
+   for(int n=0;n<num_regions;++n) {
+      s->state[n] = INOGL_REGION_FREE;
+      s->fence[n] = 0;
+   }
+
+   s->num_regions = num_regions;
+   s->region_size = region_size;
+   s->size = region_size * (GLsizeiptr) num_regions;
+
+   glGenBuffers( 1, &( s->VBO ) );
+   glBindBuffer( GL_ARRAY_BUFFER, s->VBO );
+   if( ogl != NULL && ogl->hasBufferStorage ) {
+      GLbitfield flags = GL_MAP_WRITE_BIT |
+                         GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage( GL_ARRAY_BUFFER, s->size, NULL, flags );
+      s->map = (unsigned char*)
+               glMapBufferRange( GL_ARRAY_BUFFER, 0, s->size, flags );
+      if( s->map == NULL ) {
+         fprintf( stdout, " [OpenGL]  Persistent mapping failed\n" );
+         glBindBuffer( GL_ARRAY_BUFFER, 0 );
+         inoglStreamFree( s );
+         return 3;
+      }
+   } else {
+      glBufferData( GL_ARRAY_BUFFER, s->size, NULL, GL_STREAM_DRAW );
+   }
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+   fprintf( stdout, " [OpenGL]  Stream buffer %d: %d regions of %ld bytes (%s)\n",
+            s->VBO, num_regions, (long) region_size,
+            ( s->map != NULL ? "persistent" : "mapped on write" ) );
+
+   return 0;
+}
+
+void* inoglStreamAcquire( struct inogl_stream_s *s, int *region )
+{
+   for(int m=0;m<s->num_regions;++m) {
+      int n = (s->head + m) % s->num_regions;
+      int state = __atomic_load_n( &( s->state[n] ), __ATOMIC_ACQUIRE );
+
+      if( state == INOGL_REGION_FENCE ) {
+         // check the fence without blocking
+         GLenum ir = glClientWaitSync( s->fence[n], 0, 0 );
+         if( ir != GL_ALREADY_SIGNALED && ir != GL_CONDITION_SATISFIED ) {
+            continue;
+         }
+         glDeleteSync( s->fence[n] );
+         s->fence[n] = 0;
+         state = INOGL_REGION_FREE;
+      }
+      if( state != INOGL_REGION_FREE ) continue;
+
+      GLintptr off = (GLintptr) n * s->region_size;
+      void* ptr;
+      if( s->map != NULL ) {
+         ptr = (void*) (s->map + off);
+      } else {
+         // the region's fence has signaled, so the driver need not wait
+         glBindBuffer( GL_ARRAY_BUFFER, s->VBO );
+         ptr = glMapBufferRange( GL_ARRAY_BUFFER, off, s->region_size,
+                                 GL_MAP_WRITE_BIT |
+                                 GL_MAP_INVALIDATE_RANGE_BIT |
+                                 GL_MAP_UNSYNCHRONIZED_BIT );
+         glBindBuffer( GL_ARRAY_BUFFER, 0 );
+         if( ptr == NULL ) return NULL;
+         s->wmap = (unsigned char*) ptr;
+      }
+
+      __atomic_store_n( &( s->state[n] ), INOGL_REGION_WRITE,
+                        __ATOMIC_RELEASE );
+      s->head = (n + 1) % s->num_regions;
+      *region = n;
+      return ptr;
+   }
+
+   return NULL;
+}
+
+void inoglStreamCommit( struct inogl_stream_s *s, int region )
+{
+   if( s->map == NULL ) {
+      glBindBuffer( GL_ARRAY_BUFFER, s->VBO );
+      glUnmapBuffer( GL_ARRAY_BUFFER );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+      s->wmap = NULL;
+   }
+
+   __atomic_store_n( &( s->state[region] ), INOGL_REGION_USE,
+                     __ATOMIC_RELEASE );
+}
+
+void inoglStreamRelease( struct inogl_stream_s *s, int region )
+{
+   // only a region in use can be released (and only once)
+   if( __atomic_load_n( &( s->state[region] ), __ATOMIC_ACQUIRE ) !=
+       INOGL_REGION_USE ) return;
+
+   // the fence goes after the last draw that used the region, and it gets
+   // flushed to the GPU no later than the buffer swap
+   s->fence[region] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   __atomic_store_n( &( s->state[region] ), INOGL_REGION_FENCE,
+                     __ATOMIC_RELEASE );
+}
+
+//
+// hands a region back without a fence, for a caller that knows that the GPU is
+// done with it (see the resource manager); the signature is that of a recycle
+// function of the manager
+//
+void inoglStreamRecycle( void *obj, int region )
+{
+   struct inogl_stream_s *s = (struct inogl_stream_s*) obj;
+   int state = INOGL_REGION_USE;
+   __atomic_compare_exchange_n( &( s->state[region] ), &state,
+                                INOGL_REGION_FREE, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+
+GLint inoglStreamFirst( const struct inogl_stream_s *s, int region,
+                        GLsizei stride )
+{
+   return (GLint) (((GLsizeiptr) region * s->region_size) / stride);
+}
+
+void inoglStreamFree( struct inogl_stream_s *s )
+{
+   if( s->fence != NULL ) {
+      for(int n=0;n<s->num_regions;++n) {
+         if( s->fence[n] != 0 ) glDeleteSync( s->fence[n] );
+      }
+      free( s->fence );
+   }
+   if( s->state != NULL ) free( s->state );
+
+   if( s->VBO != 0 ) {
+      if( s->map != NULL ) {
+         glBindBuffer( GL_ARRAY_BUFFER, s->VBO );
+         glUnmapBuffer( GL_ARRAY_BUFFER );
+         glBindBuffer( GL_ARRAY_BUFFER, 0 );
+      }
+      glDeleteBuffers( 1, &( s->VBO ) );
+   }
+   memset( s, 0, sizeof(struct inogl_stream_s) );
+}
+
+
+//
+// Functions for a pool of texture layers. The texture has no mipmaps and is
+// sampled with "nearest" filtering (it is meant for texelFetch() of data, such
+// as heights). The number of layers is limited by what the context supports.
+//
+
+int inoglTexPoolInit( struct inogl_texpool_s *t, GLenum iformat,
+                      GLsizei width, GLsizei height, int num_layers,
+                      GLenum format, GLenum type )
+{
+   memset( t, 0, sizeof(struct inogl_texpool_s) );
+
+   GLint maxl = 0;
+   glGetIntegerv( GL_MAX_ARRAY_TEXTURE_LAYERS, &maxl );
+   if( maxl > 0 && num_layers > (int) maxl ) {
+      fprintf( stdout, " [OpenGL]  Texture pool limited to %d layers \n",
+               (int) maxl );
+      num_layers = (int) maxl;
+   }
+
+   t->state = (int*) malloc( ((size_t) num_layers) * sizeof(int) );
+   t->fence = (GLsync*) malloc( ((size_t) num_layers) * sizeof(GLsync) );
+   if( t->state == NULL || t->fence == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate texture pool \n" );
+      if( t->state != NULL ) free( t->state );
+      if( t->fence != NULL ) free( t->fence );
+      memset( t, 0, sizeof(struct inogl_texpool_s) );
+      return 1;
+   }
+   for(int n=0;n<num_layers;++n) {
+      t->state[n] = INOGL_REGION_FREE;
+      t->fence[n] = 0;
+   }
+
+   glGenTextures( 1, &( t->tex ) );
+   glBindTexture( GL_TEXTURE_2D_ARRAY, t->tex );
+   glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0 );
+   glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, (GLint) iformat,
+                 width, height, (GLsizei) num_layers, 0, format, type, NULL );
+   glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+INDEBUG_BLOCK( "inoglTexPoolInit()" )
+
+   t->width = width;
+   t->height = height;
+   t->format = format;
+   t->type = type;
+   t->num_layers = num_layers;
+   t->head = 0;
+
+   return 0;
+}
+
+int inoglTexPoolAcquire( struct inogl_texpool_s *t )
+{
+   for(int m=0;m<t->num_layers;++m) {
+      int n = (t->head + m) % t->num_layers;
+      int state = __atomic_load_n( &( t->state[n] ), __ATOMIC_ACQUIRE );
+
+      if( state == INOGL_REGION_FENCE ) {
+         GLenum ir = glClientWaitSync( t->fence[n], 0, 0 );
+         if( ir != GL_ALREADY_SIGNALED && ir != GL_CONDITION_SATISFIED ) {
+            continue;
+         }
+         glDeleteSync( t->fence[n] );
+         t->fence[n] = 0;
+         state = INOGL_REGION_FREE;
+      }
+      if( state != INOGL_REGION_FREE ) continue;
+
+      __atomic_store_n( &( t->state[n] ), INOGL_REGION_WRITE,
+                        __ATOMIC_RELEASE );
+      t->head = (n + 1) % t->num_layers;
+      return n;
+   }
+
+   return -1;
+}
+
+//
+// uploads the whole layer; the layer can be drawn from once the upload has
+// been fenced (see the handoff functions below)
+//
+void inoglTexPoolUpload( struct inogl_texpool_s *t, int layer,
+                         const void *data )
+{
+   glBindTexture( GL_TEXTURE_2D_ARRAY, t->tex );
+   glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint) layer,
+                    t->width, t->height, 1, t->format, t->type, data );
+   glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+   __atomic_store_n( &( t->state[layer] ), INOGL_REGION_USE,
+                     __ATOMIC_RELEASE );
+}
+
+//
+// marks a layer as filled by an upload that was done elsewhere (in another
+// context; the upload's own fence guards its use)
+//
+void inoglTexPoolCommit( struct inogl_texpool_s *t, int layer )
+{
+   __atomic_store_n( &( t->state[layer] ), INOGL_REGION_USE,
+                     __ATOMIC_RELEASE );
+}
+
+void inoglTexPoolRelease( struct inogl_texpool_s *t, int layer )
+{
+   if( __atomic_load_n( &( t->state[layer] ), __ATOMIC_ACQUIRE ) !=
+       INOGL_REGION_USE ) return;
+
+   t->fence[layer] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   __atomic_store_n( &( t->state[layer] ), INOGL_REGION_FENCE,
+                     __ATOMIC_RELEASE );
+}
+
+void inoglTexPoolRecycle( void *obj, int layer )
+{
+   struct inogl_texpool_s *t = (struct inogl_texpool_s*) obj;
+   int state = INOGL_REGION_USE;
+   __atomic_compare_exchange_n( &( t->state[layer] ), &state,
+                                INOGL_REGION_FREE, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+
+void inoglTexPoolFree( struct inogl_texpool_s *t )
+{
+   if( t->fence != NULL ) {
+      for(int n=0;n<t->num_layers;++n) {
+         if( t->fence[n] != 0 ) glDeleteSync( t->fence[n] );
+      }
+      free( t->fence );
+   }
+   if( t->state != NULL ) free( t->state );
+   if( t->tex != 0 ) glDeleteTextures( 1, &( t->tex ) );
+   memset( t, 0, sizeof(struct inogl_texpool_s) );
+}
+
+
+//
+// Functions of the resource manager. The slot table is fixed in size; slots
+// and queues are guarded by a mutex (they change a few times per frame),
+// while the states can be read without it.
+//
+
+int inoglResInit( struct inogl_resmgr_s *m, int max )
+{
+   memset( m, 0, sizeof(struct inogl_resmgr_s) );
+
+   m->res = (struct inogl_res_s*) malloc( ((size_t) max) *
+                                          sizeof(struct inogl_res_s) );
+   if( m->res == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate resource manager \n" );
+      return 1;
+   }
+   memset( m->res, 0, ((size_t) max) * sizeof(struct inogl_res_s) );
+   for(int n=0;n<max;++n) m->res[n].next = n+1;
+   m->res[max-1].next = -1;
+   m->free_head = 0;
+   m->max = max;
+
+   pthread_mutex_init( &( m->mtx ), NULL );
+
+   return 0;
+}
+
+//
+// registers the context of the calling thread; returns its index or -1
+//
+int inoglResContext( struct inogl_resmgr_s *m )
+{
+   pthread_mutex_lock( &( m->mtx ) );
+   int ctx = -1;
+   if( m->num_ctx < INOGL_RES_CONTEXTS ) {
+      ctx = m->num_ctx++;
+      struct inogl_resctx_s *c = &( m->ctx[ctx] );
+      memset( c, 0, sizeof(struct inogl_resctx_s) );
+      c->retired = -1;
+      c->retired_tail = -1;
+   }
+   pthread_mutex_unlock( &( m->mtx ) );
+
+   if( ctx == -1 ) fprintf( stdout, " [OpenGL]  Too many resource contexts \n" );
+   return ctx;
+}
+
+static int inoglResSlot( struct inogl_resmgr_s *m, int type, GLuint name,
+                         int owner, int state )
+{
+   pthread_mutex_lock( &( m->mtx ) );
+   int id = m->free_head;
+   if( id != -1 ) m->free_head = m->res[id].next;
+   pthread_mutex_unlock( &( m->mtx ) );
+   if( id == -1 ) {
+      fprintf( stdout, " [OpenGL]  Resource manager is full \n" );
+      return -1;
+   }
+
+   struct inogl_res_s *r = &( m->res[id] );
+   r->type = type;
+   r->name = name;
+   r->owner = owner;
+   r->frame = 0;
+   r->next = -1;
+   r->recycle = NULL;
+   r->obj = NULL;
+   __atomic_store_n( &( r->state ), state, __ATOMIC_RELEASE );
+
+   return id;
+}
+
+//
+// makes a GL object in the calling thread's context (which is "ctx"); it
+// stays in the created state until it is published
+//
+int inoglResCreate( struct inogl_resmgr_s *m, int type, int ctx )
+{
+   GLuint name = 0;
+   switch( type ) {
+    case INOGL_RES_BUFFER:  glGenBuffers( 1, &name ); break;
+    case INOGL_RES_VAO:     glGenVertexArrays( 1, &name ); break;
+    case INOGL_RES_TEXTURE: glGenTextures( 1, &name ); break;
+    default: return -1;
+   }
+
+   // (it is never seen as ready before it is published)
+   int owner = ( type == INOGL_RES_VAO ) ? ctx : -1;
+   int id = inoglResSlot( m, type, name, owner, INOGL_RES_CREATED );
+   if( id == -1 ) {
+      switch( type ) {
+       case INOGL_RES_BUFFER:  glDeleteBuffers( 1, &name ); break;
+       case INOGL_RES_VAO:     glDeleteVertexArrays( 1, &name ); break;
+       case INOGL_RES_TEXTURE: glDeleteTextures( 1, &name ); break;
+      }
+      return -1;
+   }
+
+   return id;
+}
+
+//
+// takes over an existing GL object made in context "ctx"; it is ready
+//
+int inoglResAdopt( struct inogl_resmgr_s *m, int type, GLuint name, int ctx )
+{
+   int owner = ( type == INOGL_RES_VAO ) ? ctx : -1;
+   return inoglResSlot( m, type, name, owner, INOGL_RES_READY );
+}
+
+//
+// wraps a region of some object that is in use, such that it can be retired
+//
+int inoglResRegion( struct inogl_resmgr_s *m,
+                    void (*recycle)( void *obj, int index ),
+                    void *obj, int index )
+{
+   int id = inoglResSlot( m, INOGL_RES_REGION, (GLuint) index, -1,
+                          INOGL_RES_READY );
+   if( id == -1 ) return -1;
+   m->res[id].recycle = recycle;
+   m->res[id].obj = obj;
+
+   return id;
+}
+
+GLuint inoglResName( const struct inogl_resmgr_s *m, int id )
+{
+   return m->res[id].name;
+}
+
+//
+// marks a created resource as ready; returns 1 if it was in the created state
+//
+int inoglResPublish( struct inogl_resmgr_s *m, int id )
+{
+   int state = INOGL_RES_CREATED;
+   return __atomic_compare_exchange_n( &( m->res[id].state ), &state,
+                                       INOGL_RES_READY, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+
+int inoglResReady( const struct inogl_resmgr_s *m, int id )
+{
+   return ( __atomic_load_n( &( m->res[id].state ), __ATOMIC_ACQUIRE ) ==
+            INOGL_RES_READY );
+}
+
+//
+// retires a resource that is no longer used by context "ctx" (the calling
+// one); it is queued in that context, or in the owner's context for a VAO,
+// and it is deleted after the frame in progress has completed. Returns 1 if
+// the resource was retired now (and 0 if it already was).
+//
+int inoglResRetire( struct inogl_resmgr_s *m, int id, int ctx )
+{
+   struct inogl_res_s *r = &( m->res[id] );
+
+   int state = __atomic_load_n( &( r->state ), __ATOMIC_ACQUIRE );
+   do {
+      if( state != INOGL_RES_CREATED && state != INOGL_RES_READY ) return 0;
+   } while( !__atomic_compare_exchange_n( &( r->state ), &state,
+                                          INOGL_RES_RETIRED, 0,
+                                          __ATOMIC_ACQ_REL,
+                                          __ATOMIC_ACQUIRE ) );
+
+   pthread_mutex_lock( &( m->mtx ) );
+   int q = ( r->owner >= 0 ) ? r->owner : ctx;
+   struct inogl_resctx_s *c = &( m->ctx[q] );
+   // the frame of the context the resource was used in; if it is queued
+   // elsewhere (a VAO of another context) the whole frame of the owner waits
+   r->frame = ( q == ctx ) ? m->ctx[ctx].frame : c->frame;
+   r->next = -1;
+   if( c->retired_tail == -1 ) {
+      c->retired = id;
+   } else {
+      m->res[ c->retired_tail ].next = id;
+   }
+   c->retired_tail = id;
+   pthread_mutex_unlock( &( m->mtx ) );
+
+   return 1;
+}
+
+//
+// ends a frame of context "ctx" (the calling one): the fences of earlier
+// frames are checked without blocking, the frame is fenced, and the retired
+// resources of completed frames are deleted or recycled. When the GPU is
+// INOGL_RES_FRAMES frames behind there is no fence to spare; the frame is then
+// not fenced (nothing blocks) and the fence of a later frame stands for it.
+//
+void inoglResFrame( struct inogl_resmgr_s *m, int ctx )
+{
+   struct inogl_resctx_s *c = &( m->ctx[ctx] );
+
+   int k = -1;
+   for(int n=0;n<INOGL_RES_FRAMES;++n) {
+      if( c->fence[n] != 0 ) {
+         GLenum ir = glClientWaitSync( c->fence[n], 0, 0 );
+         if( ir != GL_ALREADY_SIGNALED && ir != GL_CONDITION_SATISFIED ) {
+            continue;
+         }
+         glDeleteSync( c->fence[n] );
+         c->fence[n] = 0;
+         if( c->fframe[n] + 1 > c->done ) c->done = c->fframe[n] + 1;
+      }
+      if( k == -1 ) k = n;
+   }
+   if( k != -1 ) {
+      c->fence[k] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      c->fframe[k] = c->frame;
+   }
+   glFlush();
+
+   pthread_mutex_lock( &( m->mtx ) );
+   c->frame += 1;
+   // take the resources whose frame has completed out of the queue
+   int list = -1, *link = &( c->retired ), prev = -1;
+   while( *link != -1 ) {
+      int id = *link;
+      struct inogl_res_s *r = &( m->res[id] );
+      if( r->frame < c->done ) {
+         *link = r->next;
+         r->next = list;
+         list = id;
+      } else {
+         prev = id;
+         link = &( r->next );
+      }
+   }
+   c->retired_tail = prev;
+   pthread_mutex_unlock( &( m->mtx ) );
+
+   // delete them outside of the lock, and then free their slots
+   int id = list;
+   while( id != -1 ) {
+      struct inogl_res_s *r = &( m->res[id] );
+      int next = r->next;
+      switch( r->type ) {
+       case INOGL_RES_BUFFER:  glDeleteBuffers( 1, &( r->name ) ); break;
+       case INOGL_RES_VAO:     glDeleteVertexArrays( 1, &( r->name ) ); break;
+       case INOGL_RES_TEXTURE: glDeleteTextures( 1, &( r->name ) ); break;
+       case INOGL_RES_REGION:  r->recycle( r->obj, (int) r->name ); break;
+      }
+      __atomic_store_n( &( r->state ), INOGL_RES_FREE, __ATOMIC_RELEASE );
+      pthread_mutex_lock( &( m->mtx ) );
+      r->next = m->free_head;
+      m->free_head = id;
+      pthread_mutex_unlock( &( m->mtx ) );
+      id = next;
+   }
+}
+
+//
+// returns whether context "ctx" has retired resources waiting on its frames
+//
+int inoglResPending( struct inogl_resmgr_s *m, int ctx )
+{
+   pthread_mutex_lock( &( m->mtx ) );
+   int ir = ( m->ctx[ctx].retired != -1 );
+   pthread_mutex_unlock( &( m->mtx ) );
+
+   return ir;
+}
+
+void inoglResFree( struct inogl_resmgr_s *m )
+{
+   for(int q=0;q<m->num_ctx;++q) {
+      for(int n=0;n<INOGL_RES_FRAMES;++n) {
+         if( m->ctx[q].fence[n] != 0 ) glDeleteSync( m->ctx[q].fence[n] );
+      }
+   }
+   if( m->res != NULL ) free( m->res );
+   pthread_mutex_destroy( &( m->mtx ) );
+   memset( m, 0, sizeof(struct inogl_resmgr_s) );
+}
+
+
+//
+// Functions of the pool of uploading threads
+//
+
+static void inoglUploadRun( struct inogl_upload_s *j )
+{
+   GLuint name = j->name;
+
+   j->status = 0;
+   switch( j->type ) {
+    case INOGL_UPLOAD_BUFFER:
+      if( name == 0 ) {
+         glGenBuffers( 1, &name );
+         glBindBuffer( j->target, name );
+         glBufferData( j->target, j->size, j->data, GL_STATIC_DRAW );
+         j->name = name;
+      } else {
+         glBindBuffer( j->target, name );
+         glBufferSubData( j->target, j->offset, j->size, j->data );
+      }
+      glBindBuffer( j->target, 0 );
+    break;
+    case INOGL_UPLOAD_TEXTURE:
+      glBindTexture( j->target, name );
+      if( j->depth > 0 ) {
+         glTexSubImage3D( j->target, j->level, j->xoff, j->yoff, j->zoff,
+                          j->width, j->height, j->depth,
+                          j->format, j->dtype, j->data );
+      } else {
+         glTexSubImage2D( j->target, j->level, j->xoff, j->yoff,
+                          j->width, j->height, j->format, j->dtype, j->data );
+      }
+      glBindTexture( j->target, 0 );
+    break;
+    case INOGL_UPLOAD_PROGRAM:
+      j->status = inoglMakeProgram1( j->prog, j->vsrc, j->fsrc );
+      name = j->prog->shaderProgram;
+    break;
+    default:
+      j->status = -1;
+   }
+
+   if( glGetError() != GL_NO_ERROR && j->status == 0 ) j->status = 1;
+
+   // the fence goes after the work (this flushes); without a handoff the
+   // work is only flushed
+   if( j->h != NULL ) {
+      inoglHandoffPublish( j->h, name, j->region );
+   } else {
+      glFlush();
+   }
+
+   // (the job may be reused by whoever is told)
+   if( j->done != NULL ) j->done( j );
+}
+
+struct inogl_upload_worker_s {
+   struct inogl_uploader_s *u;
+   int n;
+};
+
+static void* inoglUploadWorker( void *arg )
+{
+   struct inogl_upload_worker_s *w = (struct inogl_upload_worker_s*) arg;
+   struct inogl_uploader_s *u = w->u;
+   int n = w->n;
+   free( w );
+
+   int ibound = ( u->bind( u->arg, n ) == 0 );
+
+   pthread_mutex_lock( &( u->mtx ) );
+   u->num_ready += 1;
+   u->num_live += ibound;
+   pthread_cond_broadcast( &( u->cv_done ) );
+   if( !ibound ) {
+      pthread_mutex_unlock( &( u->mtx ) );
+      fprintf( stdout, " [OpenGL]  Upload worker %d has no context \n", n );
+      return NULL;
+   }
+   while( 1 ) {
+      while( u->count == 0 && !u->istop ) {
+         pthread_cond_wait( &( u->cv_work ), &( u->mtx ) );
+      }
+      if( u->count == 0 ) break;            // stopping and drained
+
+      struct inogl_upload_s *j = u->queue[ u->head ];
+      u->head = (u->head + 1) % INOGL_UPLOAD_QUEUE;
+      u->count -= 1;
+      u->busy += 1;
+      pthread_mutex_unlock( &( u->mtx ) );
+
+      inoglUploadRun( j );
+
+      pthread_mutex_lock( &( u->mtx ) );
+      u->busy -= 1;
+      // wake anyone waiting for a slot in the queue or for the queue to drain
+      pthread_cond_broadcast( &( u->cv_done ) );
+   }
+   pthread_mutex_unlock( &( u->mtx ) );
+
+   (void) u->bind( u->arg, -1 );
+   return NULL;
+}
+
+//
+// starts the workers; worker "n" calls bind(arg,n) to make its context current
+// (and bind(arg,-1) when it ends). Returns 0 if at least one worker has its
+// context; otherwise there are no workers and the caller uploads by itself.
+//
+int inoglUploaderInit( struct inogl_uploader_s *u, int num_workers,
+                       int (*bind)( void *arg, int worker ), void *arg )
+{
+   memset( u, 0, sizeof(struct inogl_uploader_s) );
+   if( num_workers < 1 ) return 1;
+
+   u->tid = (pthread_t*) malloc( ((size_t) num_workers)*sizeof(pthread_t) );
+   if( u->tid == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate upload workers \n" );
+      return 2;
+   }
+   u->bind = bind;
+   u->arg = arg;
+   pthread_mutex_init( &( u->mtx ), NULL );
+   pthread_cond_init( &( u->cv_work ), NULL );
+   pthread_cond_init( &( u->cv_done ), NULL );
+
+   int n;
+   for(n=0;n<num_workers;++n) {
+      struct inogl_upload_worker_s *w = (struct inogl_upload_worker_s*)
+                                   malloc( sizeof(struct inogl_upload_worker_s) );
+      if( w == NULL ) break;
+      w->u = u;
+      w->n = n;
+      if( pthread_create( &( u->tid[n] ), NULL, inoglUploadWorker,
+                          (void*) w ) != 0 ) {
+         free( w );
+         break;
+      }
+   }
+   u->num_workers = n;
+
+   // wait for the workers to make their contexts current (or fail to)
+   pthread_mutex_lock( &( u->mtx ) );
+   while( u->num_ready < n ) pthread_cond_wait( &( u->cv_done ), &( u->mtx ) );
+   int num_live = u->num_live;
+   pthread_mutex_unlock( &( u->mtx ) );
+   fprintf( stdout, " [OpenGL]  Started %d upload workers (%d with a "
+            "context) \n", n, num_live );
+
+   if( num_live == 0 ) {
+      inoglUploaderFree( u );
+      return 3;
+   }
+   return 0;
+}
+
+//
+// queues a job; this blocks while the queue is full
+//
+int inoglUploadSubmit( struct inogl_uploader_s *u, struct inogl_upload_s *j )
+{
+   if( u->num_workers == 0 ) return 1;
+
+   pthread_mutex_lock( &( u->mtx ) );
+   if( u->num_live == 0 ) {
+      pthread_mutex_unlock( &( u->mtx ) );
+      return 1;
+   }
+   while( u->count == INOGL_UPLOAD_QUEUE ) {
+      pthread_cond_wait( &( u->cv_done ), &( u->mtx ) );
+   }
+   u->queue[ (u->head + u->count) % INOGL_UPLOAD_QUEUE ] = j;
+   u->count += 1;
+   pthread_cond_signal( &( u->cv_work ) );
+   pthread_mutex_unlock( &( u->mtx ) );
+
+   return 0;
+}
+
+//
+// waits until all queued jobs have been issued; their data may then be reused
+// (which is not to say that the GPU is done with them; see the handoffs)
+//
+void inoglUploadWait( struct inogl_uploader_s *u )
+{
+   pthread_mutex_lock( &( u->mtx ) );
+   while( u->count > 0 || u->busy > 0 ) {
+      pthread_cond_wait( &( u->cv_done ), &( u->mtx ) );
+   }
+   pthread_mutex_unlock( &( u->mtx ) );
+}
+
+//
+// checks whether a job has completed on the GPU (see inoglHandoffReady())
+//
+int inoglUploadReady( struct inogl_upload_s *j, int igpu )
+{
+   if( j->h == NULL ) return 0;
+   return inoglHandoffReady( j->h, igpu );
+}
+
+//
+// stops the workers once the queue has drained
+//
+void inoglUploaderFree( struct inogl_uploader_s *u )
+{
+   if( u->tid == NULL ) return;
+
+   pthread_mutex_lock( &( u->mtx ) );
+   u->istop = 1;
+   pthread_cond_broadcast( &( u->cv_work ) );
+   pthread_mutex_unlock( &( u->mtx ) );
+   for(int n=0;n<u->num_workers;++n) pthread_join( u->tid[n], NULL );
+
+   pthread_cond_destroy( &( u->cv_work ) );
+   pthread_cond_destroy( &( u->cv_done ) );
+   pthread_mutex_destroy( &( u->mtx ) );
+   free( u->tid );
+   memset( u, 0, sizeof(struct inogl_uploader_s) );
+}
+
+
+//
+// Functions of the render command queue; this is an intrusive multi-producer,
+// single-consumer list with a stub node: a producer swaps itself in as the
+// head and then links the previous head to itself, and the consumer follows
+// the links from the tail. Between the two steps of a producer the list looks
+// cut short, and the consumer leaves the rest for later.
+//
+
+void inoglCmdInit( struct inogl_cmdq_s *q )
+{
+   memset( q, 0, sizeof(struct inogl_cmdq_s) );
+   q->stub.next = NULL;
+   q->head = &( q->stub );
+   q->tail = &( q->stub );
+}
+
+static void inoglCmdPush( struct inogl_cmdq_s *q, struct inogl_cmd_s *c )
+{
+   __atomic_store_n( &( c->next ), NULL, __ATOMIC_RELAXED );
+   struct inogl_cmd_s *prev = __atomic_exchange_n( &( q->head ), c,
+                                                   __ATOMIC_ACQ_REL );
+   __atomic_store_n( &( prev->next ), c, __ATOMIC_RELEASE );
+}
+
+static struct inogl_cmd_s* inoglCmdPop( struct inogl_cmdq_s *q )
+{
+   struct inogl_cmd_s *tail = q->tail;
+   struct inogl_cmd_s *next = __atomic_load_n( &( tail->next ),
+                                               __ATOMIC_ACQUIRE );
+
+   if( tail == &( q->stub ) ) {
+      if( next == NULL ) return NULL;          // empty
+      q->tail = next;
+      tail = next;
+      next = __atomic_load_n( &( tail->next ), __ATOMIC_ACQUIRE );
+   }
+   if( next != NULL ) {
+      q->tail = next;
+      return tail;
+   }
+
+   // the tail is the last command, unless a producer is half-way through
+   if( tail != __atomic_load_n( &( q->head ), __ATOMIC_ACQUIRE ) ) return NULL;
+   inoglCmdPush( q, &( q->stub ) );
+   next = __atomic_load_n( &( tail->next ), __ATOMIC_ACQUIRE );
+   if( next != NULL ) {
+      q->tail = next;
+      return tail;
+   }
+
+   return NULL;
+}
+
+static struct inogl_cmd_s* inoglCmdNew( int type, size_t size )
+{
+   struct inogl_cmd_s *c = (struct inogl_cmd_s*)
+                           malloc( sizeof(struct inogl_cmd_s) + size );
+   if( c == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate a render command \n" );
+      return NULL;
+   }
+   memset( c, 0, sizeof(struct inogl_cmd_s) );
+   c->type = type;
+
+   return c;
+}
+
+//
+// posts a function to be called in the render thread
+//
+int inoglCmdPostCall( struct inogl_cmdq_s *q,
+                      void (*func)( void *arg, GLuint name ), void *arg,
+                      int *done )
+{
+   struct inogl_cmd_s *c = inoglCmdNew( INOGL_CMD_CALL, 0 );
+   if( c == NULL ) return 1;
+   c->func = func;
+   c->arg = arg;
+   c->done = done;
+   inoglCmdPush( q, c );
+
+   return 0;
+}
+
+//
+// posts the making of a VAO; while it is bound the function (if any) sets it
+// up, and its name goes to "result" (VAOs belong to the render context)
+//
+int inoglCmdPostVAO( struct inogl_cmdq_s *q,
+                     void (*setup)( void *arg, GLuint vao ), void *arg,
+                     GLuint *result, int *done )
+{
+   struct inogl_cmd_s *c = inoglCmdNew( INOGL_CMD_VAO, 0 );
+   if( c == NULL ) return 1;
+   c->func = setup;
+   c->arg = arg;
+   c->result = result;
+   c->done = done;
+   inoglCmdPush( q, c );
+
+   return 0;
+}
+
+//
+// posts the deletion of an object of one of the resource types
+//
+int inoglCmdPostDelete( struct inogl_cmdq_s *q, int type, GLuint name )
+{
+   struct inogl_cmd_s *c = inoglCmdNew( INOGL_CMD_DELETE, 0 );
+   if( c == NULL ) return 1;
+   c->target = (GLenum) type;
+   c->name = name;
+   inoglCmdPush( q, c );
+
+   return 0;
+}
+
+//
+// posts the setting of a uniform; "kind" is GL_FLOAT (with 1 to 4 components)
+// or GL_FLOAT_MAT4 (with 16)
+//
+int inoglCmdPostUniform( struct inogl_cmdq_s *q, GLuint program, GLint loc,
+                         GLenum kind, GLsizei count, const GLfloat *val )
+{
+   if( count < 1 || count > 16 ) return 2;
+   struct inogl_cmd_s *c = inoglCmdNew( INOGL_CMD_UNIFORM, 0 );
+   if( c == NULL ) return 1;
+   c->name = program;
+   c->loc = loc;
+   c->target = kind;
+   c->count = count;
+   memcpy( c->val, val, ((size_t) count)*sizeof(GLfloat) );
+   inoglCmdPush( q, c );
+
+   return 0;
+}
+
+//
+// posts an upload of a sub-range of a buffer; the data is copied
+//
+int inoglCmdPostSubData( struct inogl_cmdq_s *q, GLenum target, GLuint name,
+                         GLintptr offset, GLsizeiptr size, const void *data,
+                         int *done )
+{
+   struct inogl_cmd_s *c = inoglCmdNew( INOGL_CMD_SUBDATA, (size_t) size );
+   if( c == NULL ) return 1;
+   c->target = target;
+   c->name = name;
+   c->offset = offset;
+   c->size = size;
+   c->done = done;
+   memcpy( c->data, data, (size_t) size );
+   inoglCmdPush( q, c );
+
+   return 0;
+}
+
+static void inoglCmdExec( struct inogl_cmd_s *c )
+{
+   GLint iprg;
+
+   switch( c->type ) {
+    case INOGL_CMD_CALL:
+      c->func( c->arg, 0 );
+    break;
+    case INOGL_CMD_VAO:
+      glGenVertexArrays( 1, &( c->name ) );
+      glBindVertexArray( c->name );
+      if( c->func != NULL ) c->func( c->arg, c->name );
+      glBindVertexArray( 0 );
+      if( c->result != NULL ) *( c->result ) = c->name;
+    break;
+    case INOGL_CMD_DELETE:
+      switch( (int) c->target ) {
+       case INOGL_RES_BUFFER:  glDeleteBuffers( 1, &( c->name ) ); break;
+       case INOGL_RES_VAO:     glDeleteVertexArrays( 1, &( c->name ) ); break;
+       case INOGL_RES_TEXTURE: glDeleteTextures( 1, &( c->name ) ); break;
+      }
+    break;
+    case INOGL_CMD_UNIFORM:
+      glGetIntegerv( GL_CURRENT_PROGRAM, &iprg );
+      glUseProgram( c->name );
+      if( c->target == GL_FLOAT_MAT4 ) {
+         glUniformMatrix4fv( c->loc, 1, GL_FALSE, c->val );
+      } else {
+         switch( c->count ) {
+          case 1: glUniform1fv( c->loc, 1, c->val ); break;
+          case 2: glUniform2fv( c->loc, 1, c->val ); break;
+          case 3: glUniform3fv( c->loc, 1, c->val ); break;
+          case 4: glUniform4fv( c->loc, 1, c->val ); break;
+         }
+      }
+      glUseProgram( (GLuint) iprg );
+    break;
+    case INOGL_CMD_SUBDATA:
+      glBindBuffer( c->target, c->name );
+      glBufferSubData( c->target, c->offset, c->size, c->data );
+      glBindBuffer( c->target, 0 );
+    break;
+   }
+
+   if( c->done != NULL ) __atomic_store_n( c->done, 1, __ATOMIC_RELEASE );
+}
+
+//
+// runs the queued commands (in the render thread) until the queue is empty
+// or the budget of time (in microseconds) is spent; one command always runs,
+// so the queue makes progress. Returns the number of commands that ran.
+//
+int inoglCmdRun( struct inogl_cmdq_s *q, long budget_us )
+{
+   struct timespec t0, t1;
+   struct inogl_cmd_s *c;
+   int n=0;
+
+   clock_gettime( CLOCK_MONOTONIC, &t0 );
+   while(( c = inoglCmdPop( q ) ) != NULL ) {
+      inoglCmdExec( c );
+      free( c );
+      ++n;
+
+      clock_gettime( CLOCK_MONOTONIC, &t1 );
+      long us = (long) ( t1.tv_sec - t0.tv_sec ) * 1000000 +
+                (long) ( t1.tv_nsec - t0.tv_nsec ) / 1000;
+      if( us >= budget_us ) {
+         if( __atomic_load_n( &( q->tail->next ), __ATOMIC_ACQUIRE ) != NULL ||
+             q->tail != &( q->stub ) ) q->num_late += 1;
+         break;
+      }
+   }
+   q->num_run += (unsigned long) n;
+
+   return n;
+}
+
+//
+// drops the commands still queued without running them (nothing may post)
+//
+void inoglCmdFree( struct inogl_cmdq_s *q )
+{
+   struct inogl_cmd_s *c;
+   while(( c = inoglCmdPop( q ) ) != NULL ) free( c );
+   inoglCmdInit( q );
+}
+
+
+//
+// Functions to hand an object over from the uploading context to the drawing
+// context without stalling either thread. The producer calls the publish
+// function right after issuing the upload commands; the fence is flushed such
+// that it can signal while another context is waiting on it. The consumer
+// calls the ready function every time before it would first use the object:
+// with "igpu" set, the GPU of the consumer's context is made to wait on the
+// fence (the call returns immediately), otherwise the fence is checked without
+// blocking, and the object is not ready until the upload has completed.
+//
+
+void inoglHandoffPublish( struct inogl_handoff_s *h, GLuint name, int region )
+{
+   if( h->fence != 0 ) glDeleteSync( h->fence );   // was never consumed
+   h->name = name;
+   h->region = region;
+   h->fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   glFlush();
+   __atomic_store_n( &( h->state ), INOGL_HANDOFF_FENCED, __ATOMIC_RELEASE );
+}
+
+int inoglHandoffReady( struct inogl_handoff_s *h, int igpu )
+{
+   int state = __atomic_load_n( &( h->state ), __ATOMIC_ACQUIRE );
+   if( state == INOGL_HANDOFF_READY ) return 1;
+   if( state == INOGL_HANDOFF_EMPTY ) return 0;
+
+   if( igpu ) {
+      glWaitSync( h->fence, 0, GL_TIMEOUT_IGNORED );
+   } else {
+      GLenum ir = glClientWaitSync( h->fence, 0, 0 );
+      if( ir == GL_TIMEOUT_EXPIRED ) return 0;
+      if( ir == GL_WAIT_FAILED ) {
+         fprintf( stdout, " [OpenGL]  Handoff fence wait failed\n" );
+         return 0;
+      }
+   }
+
+   glDeleteSync( h->fence );
+   h->fence = 0;
+   __atomic_store_n( &( h->state ), INOGL_HANDOFF_READY, __ATOMIC_RELEASE );
+
+   return 1;
+}
+
+void inoglHandoffClear( struct inogl_handoff_s *h )
+{
+   if( h->fence != 0 ) glDeleteSync( h->fence );
+   h->fence = 0;
+   h->name = 0;
+   h->region = -1;
+   __atomic_store_n( &( h->state ), INOGL_HANDOFF_EMPTY, __ATOMIC_RELEASE );
+}
+
+
+//
+// Function to compute the bounding box and a bounding sphere of a group from
+// its vertex positions; the sphere is centred on the box, which is not the
+// tightest sphere but it is close enough and it is made in a single pass
+//
+
+void inoglGroupBounds( struct inogl_grp_s *gp )
+{
+   int i;
+
+   for(i=0;i<3;++i) { gp->bmin[i] = 0.0f; gp->bmax[i] = 0.0f; }
+   for(i=0;i<4;++i) gp->bsph[i] = 0.0f;
+   if( gp->vdata == NULL || gp->vertex_count < 1 ||
+       !( gp->exist & 0x01 ) ) return;
+
+   const GLfloat* v = gp->vdata + gp->moff[0];
+   for(i=0;i<3;++i) { gp->bmin[i] = v[i]; gp->bmax[i] = v[i]; }
+   for(int n=1;n<gp->vertex_count;++n) {
+      v += gp->nglm;
+      for(i=0;i<3;++i) {
+         if( v[i] < gp->bmin[i] ) gp->bmin[i] = v[i];
+         if( v[i] > gp->bmax[i] ) gp->bmax[i] = v[i];
+      }
+   }
+
+   for(i=0;i<3;++i) gp->bsph[i] = 0.5f * (gp->bmin[i] + gp->bmax[i]);
+   float r2 = 0.0f;
+   v = gp->vdata + gp->moff[0];
+   for(int n=0;n<gp->vertex_count;++n, v += gp->nglm) {
+      float dx = v[0] - gp->bsph[0];
+      float dy = v[1] - gp->bsph[1];
+      float dz = v[2] - gp->bsph[2];
+      float d2 = dx*dx + dy*dy + dz*dz;
+      if( d2 > r2 ) r2 = d2;
+   }
+   gp->bsph[3] = sqrtf( r2 );
+}
+
+
+//
+// Functions to save groups to a cache file and to map them back; see the
+// header for the layout of the file. The file is written under a temporary
+// name and renamed when complete, so a cache is never seen half written.
+//
+
+// (the records are the format of the file)
+_Static_assert( sizeof(struct inogl_meshhdr_s) == 64, "mesh file header" );
+_Static_assert( sizeof(struct inogl_meshent_s) == 112, "mesh file entry" );
+
+static uint64_t inoglMeshRound( uint64_t n, uint64_t page )
+{
+   return ( n + page - 1 ) / page * page;
+}
+
+static int inoglMeshPad( FILE *fp, uint64_t to )
+{
+   static const char zero[4096];
+   long pos = ftell( fp );
+   if( pos < 0 ) return 1;
+   uint64_t n = to - (uint64_t) pos;
+   while( n > 0 ) {
+      size_t k = ( n > sizeof(zero) ) ? sizeof(zero) : (size_t) n;
+      if( fwrite( zero, 1, k, fp ) != k ) return 1;
+      n -= (uint64_t) k;
+   }
+   return 0;
+}
+
+int inoglMeshSave( const char *fname, uint64_t tag,
+                   int num, const struct inogl_grp_s *gps )
+{
+   if( num < 1 ) return 1;
+
+   long lpage = sysconf( _SC_PAGESIZE );
+   uint64_t page = ( lpage > 0 ) ? (uint64_t) lpage : 4096;
+
+   struct inogl_meshent_s *ent = (struct inogl_meshent_s*)
+                      calloc( (size_t) num, sizeof(struct inogl_meshent_s) );
+   if( ent == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate mesh table\n" );
+      return -1;
+   }
+
+   uint64_t off = inoglMeshRound( sizeof(struct inogl_meshhdr_s) +
+                      ((uint64_t) num) * sizeof(struct inogl_meshent_s), page );
+   for(int n=0;n<num;++n) {
+      struct inogl_grp_s g = gps[n];
+      if( g.vdata == NULL || g.vertex_count < 1 || g.nglm < 1 ||
+          g.nglm > INOGL_MESH_NGLM ||
+          ( g.index_count > 0 && g.idata == NULL ) ) {
+         fprintf( stdout, " [OpenGL]  Group %d has no data to cache\n", n );
+         free( ent );
+         return 2;
+      }
+      inoglGroupBounds( &g );
+
+      struct inogl_meshent_s *e = &( ent[n] );
+      e->nglm = g.nglm;
+      for(int i=0;i<4;++i) e->moff[i] = g.moff[i];
+      e->exist = g.exist;
+      e->mode = g.mode;
+      e->restart = g.restart;
+      e->vertex_count = (uint64_t) g.vertex_count;
+      e->index_count = ( g.index_count > 0 ) ? (uint64_t) g.index_count : 0;
+      memcpy( e->bmin, g.bmin, sizeof(e->bmin) );
+      memcpy( e->bmax, g.bmax, sizeof(e->bmax) );
+      memcpy( e->bsph, g.bsph, sizeof(e->bsph) );
+      e->voffset = off;
+      off += inoglMeshRound( e->vertex_count * ((uint64_t) g.nglm) *
+                             sizeof(GLfloat), page );
+      if( e->index_count > 0 ) {
+         e->ioffset = off;
+         off += inoglMeshRound( e->index_count * sizeof(GLuint), page );
+      }
+   }
+
+   struct inogl_meshhdr_s hdr;
+   memset( &hdr, 0, sizeof(hdr) );
+   memcpy( hdr.magic, INOGL_MESH_MAGIC, sizeof(hdr.magic) );
+   hdr.version = INOGL_MESH_VERSION;
+   hdr.endian = INOGL_MESH_ENDIAN;
+   hdr.page = (uint32_t) page;
+   hdr.num_groups = (uint32_t) num;
+   hdr.tag = tag;
+   hdr.file_size = off;
+   hdr.table_offset = sizeof(hdr);
+   hdr.entry_size = sizeof(struct inogl_meshent_s);
+
+   size_t isize = strlen( fname ) + 8;
+   char *tname = (char*) malloc( isize );
+   if( tname == NULL ) {
+      free( ent );
+      return -1;
+   }
+   snprintf( tname, isize, "%s.tmp", fname );
+
+   FILE *fp = fopen( tname, "wb" );
+   if( fp == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not write mesh cache \"%s\"\n",
+               tname );
+      free( tname );
+      free( ent );
+      return 1;
+   }
+
+   int ierr = ( fwrite( &hdr, sizeof(hdr), 1, fp ) != 1 ||
+                fwrite( ent, sizeof(struct inogl_meshent_s), (size_t) num,
+                        fp ) != (size_t) num );
+   for(int n=0;n<num && !ierr;++n) {
+      const struct inogl_meshent_s *e = &( ent[n] );
+      size_t nv = (size_t) e->vertex_count * (size_t) e->nglm;
+      ierr = ( inoglMeshPad( fp, e->voffset ) ||
+               fwrite( gps[n].vdata, sizeof(GLfloat), nv, fp ) != nv );
+      if( !ierr && e->index_count > 0 ) {
+         size_t ni = (size_t) e->index_count;
+         ierr = ( inoglMeshPad( fp, e->ioffset ) ||
+                  fwrite( gps[n].idata, sizeof(GLuint), ni, fp ) != ni );
+      }
+   }
+   if( !ierr ) ierr = inoglMeshPad( fp, off );
+   if( fclose( fp ) != 0 ) ierr = 1;
+   if( !ierr ) ierr = ( rename( tname, fname ) != 0 );
+   if( ierr ) {
+      fprintf( stdout, " [OpenGL]  Could not write mesh cache \"%s\"\n",
+               fname );
+      (void) unlink( tname );
+   }
+
+   free( tname );
+   free( ent );
+   return ierr;
+}
+
+//
+// checks an entry of a cache against the file (of "size" bytes at "base"),
+// such that the GL never reads past the data of a group: the layout fits in
+// the vertex, the primitive is one of the GL's, the data are in the file and
+// every index (other than the restart index) is of a vertex; returns 0 if the
+// entry is usable
+//
+static int inoglMeshCheck( const struct inogl_meshent_s *e, uint32_t page,
+                           const void *base, size_t size )
+{
+   const int width[4] = { 3, 3, 2, 4 };   // position, normal, texel, color
+
+   if( e->nglm < 1 || e->nglm > INOGL_MESH_NGLM || ( e->exist & ~0x0fu ) ||
+       e->vertex_count < 1 || e->vertex_count > 0x7fffffffu ||
+       e->index_count > 0x7fffffffu ) return 1;
+   for(int k=0;k<4;++k) {
+      if( !( e->exist & ( 0x01u << k ) ) ) continue;
+      if( e->moff[k] < 0 || e->moff[k] + width[k] > e->nglm ) return 1;
+   }
+   if( e->mode != 0 && e->mode != GL_POINTS &&
+       e->mode != GL_LINES && e->mode != GL_LINE_LOOP &&
+       e->mode != GL_LINE_STRIP && e->mode != GL_TRIANGLES &&
+       e->mode != GL_TRIANGLE_STRIP && e->mode != GL_TRIANGLE_FAN ) return 1;
+
+   uint64_t vbytes = e->vertex_count * ((uint64_t) e->nglm) * sizeof(GLfloat);
+   uint64_t ibytes = e->index_count * sizeof(GLuint);
+   if( e->voffset % page != 0 || e->ioffset % page != 0 ||
+       e->voffset + vbytes > (uint64_t) size ) return 1;
+   if( e->index_count == 0 ) return 0;
+   if( e->ioffset == 0 || e->ioffset + ibytes > (uint64_t) size ) return 1;
+
+   const GLuint *idx = (const GLuint*) ( (const char*) base + e->ioffset );
+   for(uint64_t i=0;i<e->index_count;++i) {
+      if( idx[i] >= e->vertex_count &&
+          ( e->restart == 0 || idx[i] != e->restart ) ) return 1;
+   }
+   return 0;
+}
+
+//
+// maps a cache and makes its groups; the vertices and indices of the groups
+// point into the (read-only) mapping, which stays until the mesh is unmapped,
+// and the groups are then made into VAOs/VBOs as any other groups. Returns 1
+// when there is no cache and 2 when the cache is not usable.
+//
+int inoglMeshMap( struct inogl_mesh_s *m, const char *fname, uint64_t tag )
+{
+   memset( m, 0, sizeof(struct inogl_mesh_s) );
+
+   int fd = open( fname, O_RDONLY );
+   if( fd < 0 ) return 1;
+   struct stat st;
+   if( fstat( fd, &st ) != 0 ||
+       st.st_size < (off_t) sizeof(struct inogl_meshhdr_s) ) {
+      close( fd );
+      return 2;
+   }
+   size_t size = (size_t) st.st_size;
+   void *base = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if( base == MAP_FAILED ) return 1;
+
+   const struct inogl_meshhdr_s *hdr = (const struct inogl_meshhdr_s*) base;
+   const char *cause = NULL;
+   if( memcmp( hdr->magic, INOGL_MESH_MAGIC, sizeof(hdr->magic) ) != 0 ) {
+      cause = "not a mesh cache";
+   } else if( hdr->endian != INOGL_MESH_ENDIAN ) {
+      cause = "byte order";
+   } else if( hdr->version != INOGL_MESH_VERSION ) {
+      cause = "version";
+   } else if( hdr->tag != tag ) {
+      cause = "tag";
+   } else if( hdr->file_size != (uint64_t) size || hdr->page == 0 ||
+              hdr->num_groups < 1 || hdr->num_groups > 0x7fffffffu ||
+              hdr->entry_size != sizeof(struct inogl_meshent_s) ||
+              hdr->table_offset + ((uint64_t) hdr->num_groups) *
+                            hdr->entry_size > (uint64_t) size ) {
+      cause = "size";
+   }
+
+   struct inogl_grp_s *grps = NULL;
+   if( cause == NULL ) {
+      grps = (struct inogl_grp_s*) calloc( (size_t) hdr->num_groups,
+                                           sizeof(struct inogl_grp_s) );
+      if( grps == NULL ) cause = "memory";
+   }
+
+   const struct inogl_meshent_s *ent = (const struct inogl_meshent_s*)
+                             ( (const char*) base + hdr->table_offset );
+   for(uint32_t n=0;cause == NULL && n<hdr->num_groups;++n) {
+      const struct inogl_meshent_s *e = &( ent[n] );
+      if( inoglMeshCheck( e, hdr->page, base, size ) ) {
+         cause = "group";
+         break;
+      }
+
+      struct inogl_grp_s *gp = &( grps[n] );
+      gp->nglm = e->nglm;
+      for(int i=0;i<4;++i) gp->moff[i] = e->moff[i];
+      gp->exist = (unsigned char) e->exist;
+      gp->vertex_count = (int) e->vertex_count;
+      memcpy( gp->bmin, e->bmin, sizeof(gp->bmin) );
+      memcpy( gp->bmax, e->bmax, sizeof(gp->bmax) );
+      memcpy( gp->bsph, e->bsph, sizeof(gp->bsph) );
+      gp->vdata = (GLfloat*) ( (char*) base + e->voffset );
+      gp->mode = e->mode;
+      gp->restart = e->restart;
+      gp->index_count = (int) e->index_count;
+      if( e->index_count > 0 ) {
+         gp->idata = (GLuint*) ( (char*) base + e->ioffset );
+      }
+   }
+
+   if( cause != NULL ) {
+      fprintf( stdout, " [OpenGL]  Mesh cache \"%s\" not used (%s)\n",
+               fname, cause );
+      if( grps != NULL ) free( grps );
+      munmap( base, size );
+      return 2;
+   }
+
+   // the data are about to be read in full to be uploaded
+   (void) madvise( base, size, MADV_WILLNEED );
+
+   m->base = base;
+   m->size = size;
+   m->num_groups = (int) hdr->num_groups;
+   m->grps = grps;
+   return 0;
+}
+
+void inoglMeshUnmap( struct inogl_mesh_s *m )
+{
+   if( m->grps != NULL ) free( m->grps );
+   if( m->base != NULL ) munmap( m->base, m->size );
+   memset( m, 0, sizeof(struct inogl_mesh_s) );
+}
+
+
+//
+// Function to multiply two 4x4 matrices stored in column-major order (as the
+// GL stores them) such that C = A B
+//
+
+void inoglMatMul4( GLfloat *c, const GLfloat *a, const GLfloat *b )
+{
+   GLfloat t[16];
+   for(int j=0;j<4;++j) {
+      for(int i=0;i<4;++i) {
+         t[j*4+i] = a[0*4+i] * b[j*4+0] + a[1*4+i] * b[j*4+1] +
+                    a[2*4+i] * b[j*4+2] + a[3*4+i] * b[j*4+3];
+      }
+   }
+   memcpy( c, t, 16*sizeof(GLfloat) );
+}
+
+
+//
+// Function to extract the six planes of the view frustum from a (column-major)
+// clip matrix, i.e. projection times modelview. Each plane is stored as four
+// numbers (a,b,c,d) normalized such that "a x + b y + c z + d" is the signed
+// distance of a point from the plane, positive on the inside. The order is:
+// left, right, bottom, top, near, far.
+//
+
+void inoglFrustumPlanes( GLfloat *planes, const GLfloat *clip )
+{
+   for(int k=0;k<3;++k) {
+      for(int i=0;i<4;++i) {
+         GLfloat w = clip[i*4+3];
+         GLfloat a = clip[i*4+k];
+         planes[(2*k  )*4 + i] = w + a;
+         planes[(2*k+1)*4 + i] = w - a;
+      }
+   }
+
+   for(int n=0;n<6;++n) {
+      GLfloat* p = &( planes[n*4] );
+      GLfloat d = sqrtf( p[0]*p[0] + p[1]*p[1] + p[2]*p[2] );
+      if( d > 0.0f ) { p[0] /= d; p[1] /= d; p[2] /= d; p[3] /= d; }
+   }
+}
+
+
+//
+// Functions to manage a list of bounding volumes and to cull it against the
+// frustum planes. Entries are set with their model-space bounds and a shift
+// (the translation of the object), and the pass returns the number of entries
+// that are (possibly) visible. A volume is culled when its sphere or its box
+// is entirely on the outer side of any of the planes.
+//
+
+int inoglCullInit( struct inogl_cull_s *c, int max )
+{
+   memset( c, 0, sizeof(struct inogl_cull_s) );
+
+   // capacity is rounded up to full SSE lanes
+   max = (max + 3) & ~3;
+   if( max < 4 ) max = 4;
+   size_t isize = (size_t) max;
+
+   void* mem = NULL;
+   if( posix_memalign( &mem, 16, 10*isize*sizeof(float) ) != 0 ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate cull list of %d \n", max );
+      return 1;
+   }
+   c->visible = (unsigned char*) malloc( isize );
+   if( c->visible == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate cull list of %d \n", max );
+      free( mem );
+      return 1;
+   }
+   memset( mem, 0, 10*isize*sizeof(float) );
+
+   c->mem = (float*) mem;
+   c->cx = c->mem;
+   c->cy = c->cx + isize;
+   c->cz = c->cy + isize;
+   c->r  = c->cz + isize;
+   c->x0 = c->r  + isize;
+   c->y0 = c->x0 + isize;
+   c->z0 = c->y0 + isize;
+   c->x1 = c->z0 + isize;
+   c->y1 = c->x1 + isize;
+   c->z1 = c->y1 + isize;
+   c->max = max;
+
+   return 0;
+}
+
+void inoglCullSet( struct inogl_cull_s *c, int i,
+                   const GLfloat *bmin, const GLfloat *bmax,
+                   const GLfloat *bsph, const GLfloat *shift )
+{
+   GLfloat t[3] = { 0.0f, 0.0f, 0.0f };
+   if( shift != NULL ) memcpy( t, shift, 3*sizeof(GLfloat) );
+
+   c->cx[i] = bsph[0] + t[0];
+   c->cy[i] = bsph[1] + t[1];
+   c->cz[i] = bsph[2] + t[2];
+   c->r[i]  = bsph[3];
+   c->x0[i] = bmin[0] + t[0];
+   c->y0[i] = bmin[1] + t[1];
+   c->z0[i] = bmin[2] + t[2];
+   c->x1[i] = bmax[0] + t[0];
+   c->y1[i] = bmax[1] + t[1];
+   c->z1[i] = bmax[2] + t[2];
+   if( i >= c->num ) c->num = i + 1;
+}
+
+int inoglCullRun( struct inogl_cull_s *c, const GLfloat *planes )
+{
+   int nvis = 0;
+   int n = 0;
+
+#ifdef __SSE__
+   for(;n+4<=c->num;n+=4) {
+      __m128 cx = _mm_load_ps( &( c->cx[n] ) );
+      __m128 cy = _mm_load_ps( &( c->cy[n] ) );
+      __m128 cz = _mm_load_ps( &( c->cz[n] ) );
+      __m128 nr = _mm_sub_ps( _mm_setzero_ps(), _mm_load_ps( &( c->r[n] ) ) );
+      __m128 in = _mm_cmpeq_ps( cx, cx );      // all lanes set
+
+      for(int k=0;k<6;++k) {
+         const GLfloat* p = &( planes[k*4] );
+         __m128 a = _mm_set1_ps( p[0] );
+         __m128 b = _mm_set1_ps( p[1] );
+         __m128 e = _mm_set1_ps( p[2] );
+         __m128 d = _mm_set1_ps( p[3] );
+
+         // sphere: distance of the centre must be greater than minus radius
+         __m128 s = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a, cx ),
+                                            _mm_mul_ps( b, cy ) ),
+                                _mm_add_ps( _mm_mul_ps( e, cz ), d ) );
+         in = _mm_and_ps( in, _mm_cmpgt_ps( s, nr ) );
+
+         // box: the corner furthest along the plane normal must be inside
+         __m128 px = _mm_load_ps( p[0] >= 0.0f ? &( c->x1[n] ) : &( c->x0[n] ) );
+         __m128 py = _mm_load_ps( p[1] >= 0.0f ? &( c->y1[n] ) : &( c->y0[n] ) );
+         __m128 pz = _mm_load_ps( p[2] >= 0.0f ? &( c->z1[n] ) : &( c->z0[n] ) );
+         s = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a, px ), _mm_mul_ps( b, py ) ),
+                         _mm_add_ps( _mm_mul_ps( e, pz ), d ) );
+         in = _mm_and_ps( in, _mm_cmpge_ps( s, _mm_setzero_ps() ) );
+      }
+
+      int mask = _mm_movemask_ps( in );
+      for(int m=0;m<4;++m) {
+         c->visible[n+m] = (unsigned char) ((mask >> m) & 1);
+         nvis += c->visible[n+m];
+      }
+   }
+#endif
+
+   for(;n<c->num;++n) {
+      unsigned char in = 1;
+      for(int k=0;k<6 && in;++k) {
+         const GLfloat* p = &( planes[k*4] );
+         float s = p[0]*c->cx[n] + p[1]*c->cy[n] + p[2]*c->cz[n] + p[3];
+         if( !( s > -c->r[n] ) ) in = 0;
+         float px = ( p[0] >= 0.0f ? c->x1[n] : c->x0[n] );
+         float py = ( p[1] >= 0.0f ? c->y1[n] : c->y0[n] );
+         float pz = ( p[2] >= 0.0f ? c->z1[n] : c->z0[n] );
+         if( p[0]*px + p[1]*py + p[2]*pz + p[3] < 0.0f ) in = 0;
+      }
+      c->visible[n] = in;
+      nvis += in;
+   }
+
+   return nvis;
+}
+
+void inoglCullFree( struct inogl_cull_s *c )
+{
+   if( c->mem != NULL ) free( c->mem );
+   if( c->visible != NULL ) free( c->visible );
+   memset( c, 0, sizeof(struct inogl_cull_s) );
+}
+
+
+//
+// Functions of the set of objects of a scene. Slots are sorted by depth (with
+// a stable counting sort) only when objects were added out of that order, and
+// the update sweeps the slots once: a slot is recomputed if its local
+// transform was set or if its parent was recomputed in the same sweep. The
+// world matrix is the parent's world matrix times the local one, multiplied
+// a column at a time with SSE instructions. The world bounds are those of the
+// group transformed: the box encloses the transformed box and the sphere is
+// scaled by the largest scaling of the axes.
+//
+
+static int inoglObjAlloc( struct inogl_obj_s *o, int max )
+{
+   memset( o, 0, sizeof(struct inogl_obj_s) );
+
+   // capacity is rounded up to full SSE lanes
+   max = (max + 3) & ~3;
+   if( max < 4 ) max = 4;
+   size_t isize = (size_t) max;
+
+   void* mem = NULL;
+   if( posix_memalign( &mem, 16, 42*isize*sizeof(float) ) != 0 ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate objects of %d \n", max );
+      return 1;
+   }
+   o->parent = (int*) malloc( 4*isize*sizeof(int) );
+   o->flags = (unsigned char*) malloc( isize );
+   o->grp = (const struct inogl_grp_s**)
+                            malloc( isize*sizeof(struct inogl_grp_s*) );
+   if( o->parent == NULL || o->flags == NULL || o->grp == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate objects of %d \n", max );
+      if( o->parent != NULL ) free( o->parent );
+      if( o->flags != NULL ) free( o->flags );
+      if( o->grp != NULL ) free( o->grp );
+      free( mem );
+      memset( o, 0, sizeof(struct inogl_obj_s) );
+      return 1;
+   }
+   memset( mem, 0, 42*isize*sizeof(float) );
+
+   o->mem = (float*) mem;
+   o->local = o->mem;
+   o->world = o->local + 16*isize;
+   o->cx = o->world + 16*isize;
+   o->cy = o->cx + isize;
+   o->cz = o->cy + isize;
+   o->r  = o->cz + isize;
+   o->x0 = o->r  + isize;
+   o->y0 = o->x0 + isize;
+   o->z0 = o->y0 + isize;
+   o->x1 = o->z0 + isize;
+   o->y1 = o->x1 + isize;
+   o->z1 = o->y1 + isize;
+   o->depth = o->parent + isize;
+   o->handle = o->depth + isize;
+   o->slot = o->handle + isize;
+   o->max = max;
+   o->sorted = 1;
+
+   return 0;
+}
+
+int inoglObjInit( struct inogl_obj_s *o, int max )
+{
+   return inoglObjAlloc( o, max );
+}
+
+int inoglObjAdd( struct inogl_obj_s *o, int parent,
+                 const struct inogl_grp_s *gp )
+{
+   if( o->num >= o->max ) {
+      fprintf( stdout, " [OpenGL]  Object list is full (%d) \n", o->max );
+      return -1;
+   }
+   if( parent >= o->num ) return -1;
+
+   // handles are given out in the order of adding (objects are not removed)
+   int s = o->num, h = o->num;
+   o->handle[s] = h;
+   o->slot[h] = s;
+   if( parent < 0 ) {
+      o->parent[s] = -1;
+      o->depth[s] = 0;
+   } else {
+      o->parent[s] = o->slot[parent];
+      o->depth[s] = o->depth[ o->parent[s] ] + 1;
+   }
+   if( s > 0 && o->depth[s] < o->depth[s-1] ) o->sorted = 0;
+
+   GLfloat* m = &( o->local[16*s] );
+   memset( m, 0, 16*sizeof(GLfloat) );
+   m[0] = m[5] = m[10] = m[15] = 1.0f;
+   o->flags[s] = INOGL_OBJ_DIRTY;
+   o->grp[s] = gp;
+   ++( o->num );
+
+   return h;
+}
+
+void inoglObjSetLocal( struct inogl_obj_s *o, int h, const GLfloat *m )
+{
+   int s = o->slot[h];
+   memcpy( &( o->local[16*s] ), m, 16*sizeof(GLfloat) );
+   o->flags[s] |= INOGL_OBJ_DIRTY;
+}
+
+void inoglObjPlace( struct inogl_obj_s *o, int h,
+                    const GLfloat *trans, const GLfloat *rot )
+{
+   GLfloat m[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                     0.0f, 1.0f, 0.0f, 0.0f,
+                     0.0f, 0.0f, 1.0f, 0.0f,
+                     0.0f, 0.0f, 0.0f, 1.0f };
+   if( rot != NULL ) {
+      for(int j=0;j<3;++j) {
+         for(int i=0;i<3;++i) m[j*4+i] = rot[j*3+i];
+      }
+   }
+   if( trans != NULL ) memcpy( &( m[12] ), trans, 3*sizeof(GLfloat) );
+   inoglObjSetLocal( o, h, m );
+}
+
+const GLfloat* inoglObjWorld( const struct inogl_obj_s *o, int h )
+{
+   return &( o->world[ 16*o->slot[h] ] );
+}
+
+static int inoglObjSort( struct inogl_obj_s *o )
+{
+   struct inogl_obj_s t;
+   if( inoglObjAlloc( &t, o->max ) ) return 1;
+
+   int maxd = 0;
+   for(int s=0;s<o->num;++s) if( o->depth[s] > maxd ) maxd = o->depth[s];
+   int* pos = (int*) calloc( (size_t) (maxd + 1), sizeof(int) );
+   if( pos == NULL ) {
+      inoglObjFree( &t );
+      return 1;
+   }
+   for(int s=0;s<o->num;++s) ++( pos[ o->depth[s] ] );
+   for(int d=0,n=0;d<=maxd;++d) {
+      int k = pos[d];
+      pos[d] = n;
+      n += k;
+   }
+
+   // new slots go in the handle-to-slot map first, such that the parents'
+   // slots can be translated
+   for(int s=0;s<o->num;++s) t.slot[ o->handle[s] ] = pos[ o->depth[s] ]++;
+   free( pos );
+
+   float* src[10] = { o->cx, o->cy, o->cz, o->r,
+                      o->x0, o->y0, o->z0, o->x1, o->y1, o->z1 };
+   float* dst[10] = { t.cx, t.cy, t.cz, t.r,
+                      t.x0, t.y0, t.z0, t.x1, t.y1, t.z1 };
+   for(int s=0;s<o->num;++s) {
+      int n = t.slot[ o->handle[s] ];
+      memcpy( &( t.local[16*n] ), &( o->local[16*s] ), 16*sizeof(GLfloat) );
+      memcpy( &( t.world[16*n] ), &( o->world[16*s] ), 16*sizeof(GLfloat) );
+      for(int k=0;k<10;++k) dst[k][n] = src[k][s];
+      t.parent[n] = ( o->parent[s] < 0 ? -1 :
+                      t.slot[ o->handle[ o->parent[s] ] ] );
+      t.depth[n] = o->depth[s];
+      t.flags[n] = o->flags[s];
+      t.grp[n] = o->grp[s];
+      t.handle[n] = o->handle[s];
+   }
+   t.num = o->num;
+
+   inoglObjFree( o );
+   *o = t;
+   return 0;
+}
+
+static void inoglObjMul( GLfloat *c, const GLfloat *a, const GLfloat *b )
+{
+#ifdef __SSE__
+   __m128 a0 = _mm_load_ps( &( a[0] ) );
+   __m128 a1 = _mm_load_ps( &( a[4] ) );
+   __m128 a2 = _mm_load_ps( &( a[8] ) );
+   __m128 a3 = _mm_load_ps( &( a[12] ) );
+   for(int j=0;j<4;++j) {
+      __m128 r = _mm_add_ps( _mm_mul_ps( a0, _mm_set1_ps( b[j*4+0] ) ),
+                             _mm_mul_ps( a1, _mm_set1_ps( b[j*4+1] ) ) );
+      r = _mm_add_ps( r,
+                      _mm_add_ps( _mm_mul_ps( a2, _mm_set1_ps( b[j*4+2] ) ),
+                                  _mm_mul_ps( a3, _mm_set1_ps( b[j*4+3] ) ) ) );
+      _mm_store_ps( &( c[j*4] ), r );
+   }
+#else
+   inoglMatMul4( c, a, b );
+#endif
+}
+
+static void inoglObjBounds( struct inogl_obj_s *o, int s )
+{
+   const GLfloat* w = &( o->world[16*s] );
+   const struct inogl_grp_s* gp = o->grp[s];
+
+   if( gp == NULL ) {
+      // a point at the origin of the object
+      o->cx[s] = o->x0[s] = o->x1[s] = w[12];
+      o->cy[s] = o->y0[s] = o->y1[s] = w[13];
+      o->cz[s] = o->z0[s] = o->z1[s] = w[14];
+      o->r[s] = 0.0f;
+      return;
+   }
+
+   GLfloat c[3], lo[3], hi[3], smax = 0.0f;
+   for(int i=0;i<3;++i) {
+      c[i] = w[12+i];
+      lo[i] = w[12+i];
+      hi[i] = w[12+i];
+      for(int j=0;j<3;++j) {
+         GLfloat a = w[j*4+i];
+         c[i] += a * gp->bsph[j];
+         GLfloat e = a * gp->bmin[j], f = a * gp->bmax[j];
+         if( e < f ) { lo[i] += e; hi[i] += f; } else { lo[i] += f; hi[i] += e; }
+      }
+      GLfloat l = w[i*4+0]*w[i*4+0] + w[i*4+1]*w[i*4+1] + w[i*4+2]*w[i*4+2];
+      if( l > smax ) smax = l;
+   }
+
+   o->cx[s] = c[0];
+   o->cy[s] = c[1];
+   o->cz[s] = c[2];
+   o->r[s]  = gp->bsph[3] * sqrtf( smax );
+   o->x0[s] = lo[0];
+   o->y0[s] = lo[1];
+   o->z0[s] = lo[2];
+   o->x1[s] = hi[0];
+   o->y1[s] = hi[1];
+   o->z1[s] = hi[2];
+}
+
+int inoglObjUpdate( struct inogl_obj_s *o )
+{
+   if( !o->sorted ) {
+      if( inoglObjSort( o ) ) return -1;
+   }
+
+   int nmov = 0;
+   for(int s=0;s<o->num;++s) {
+      int p = o->parent[s];
+      if( !( o->flags[s] & INOGL_OBJ_DIRTY ) &&
+          ( p < 0 || !( o->flags[p] & INOGL_OBJ_MOVED ) ) ) {
+         o->flags[s] = 0;
+         continue;
+      }
+
+      GLfloat* w = &( o->world[16*s] );
+      if( p < 0 ) {
+         memcpy( w, &( o->local[16*s] ), 16*sizeof(GLfloat) );
+      } else {
+         inoglObjMul( w, &( o->world[16*p] ), &( o->local[16*s] ) );
+      }
+      inoglObjBounds( o, s );
+      o->flags[s] = INOGL_OBJ_MOVED;
+      ++nmov;
+   }
+
+   return nmov;
+}
+
+void inoglObjCull( const struct inogl_obj_s *o, struct inogl_cull_s *c,
+                   int first )
+{
+   int num = o->num;
+   if( first + num > c->max ) num = c->max - first;
+   if( num <= 0 ) return;
+
+   size_t isize = ((size_t) num) * sizeof(float);
+   memcpy( &( c->cx[first] ), o->cx, isize );
+   memcpy( &( c->cy[first] ), o->cy, isize );
+   memcpy( &( c->cz[first] ), o->cz, isize );
+   memcpy( &( c->r[first] ),  o->r,  isize );
+   memcpy( &( c->x0[first] ), o->x0, isize );
+   memcpy( &( c->y0[first] ), o->y0, isize );
+   memcpy( &( c->z0[first] ), o->z0, isize );
+   memcpy( &( c->x1[first] ), o->x1, isize );
+   memcpy( &( c->y1[first] ), o->y1, isize );
+   memcpy( &( c->z1[first] ), o->z1, isize );
+   if( first + num > c->num ) c->num = first + num;
+}
+
+void inoglObjFree( struct inogl_obj_s *o )
+{
+   if( o->mem != NULL ) free( o->mem );
+   if( o->parent != NULL ) free( o->parent );
+   if( o->flags != NULL ) free( o->flags );
+   if( o->grp != NULL ) free( o->grp );
+   memset( o, 0, sizeof(struct inogl_obj_s) );
+}
+
+
+//
+// Functions for selecting levels of detail. The thresholds are set such that
+// every level is used over a halving of the projected size, starting with the
+// finest level down to "size0" pixels (the size of the object when level 1
+// takes over). The projected size is the diameter in pixels of the bounding
+// sphere (shifted by a translation) in a viewport of the given height.
+//
+
+void inoglLodInit( struct inogl_lod_s *l, int num_levels,
+                   GLfloat size0, GLfloat hyst )
+{
+   if( num_levels < 1 ) num_levels = 1;
+   if( num_levels > INOGL_MAX_LOD ) num_levels = INOGL_MAX_LOD;
+
+   l->num_levels = num_levels;
+   l->hyst = hyst;
+   l->current = 0;
+   for(int n=0;n<INOGL_MAX_LOD;++n) {
+      l->size[n] = size0;
+      size0 *= 0.5f;
+   }
+}
+
+int inoglLodSelect( struct inogl_lod_s *l, GLfloat size )
+{
+   int n = l->current;
+
+   // coarsen while the object is smaller than the current level's threshold
+   while( n < l->num_levels-1 && size < l->size[n] ) ++n;
+
+   // refine only when clearly larger than the finer level's threshold
+   while( n > 0 && size > l->size[n-1] * (1.0f + l->hyst) ) --n;
+
+   l->current = n;
+   return n;
+}
+
+GLfloat inoglProjectedSize( const GLfloat *modelview, const GLfloat *proj,
+                            GLfloat height, const GLfloat *bsph,
+                            const GLfloat *shift )
+{
+   GLfloat c[3] = { bsph[0], bsph[1], bsph[2] };
+   if( shift != NULL ) { c[0] += shift[0]; c[1] += shift[1]; c[2] += shift[2]; }
+
+   // depth of the centre in eye coordinates (the viewer looks down -z)
+   GLfloat z = modelview[2]*c[0] + modelview[6]*c[1] +
+               modelview[10]*c[2] + modelview[14];
+
+   GLfloat d = 2.0f * bsph[3] * proj[5] * 0.5f * height;
+   if( proj[11] == 0.0f ) return d;           // orthographic projection
+
+   if( -z <= bsph[3] ) return 1.0e30f;        // the viewer is inside the sphere
+   return d / (-z);
+}
+
+
+//
+// Functions of the tile pager. The cache is small (a memory budget in tiles),
+// so eviction scans all pages for the least-recently requested one.
+//
+
+static int inoglPagerHash( const struct inogl_pager_s *p, int tx, int ty )
+{
+   unsigned int h = ((unsigned int) tx) * 73856093u ^
+                    ((unsigned int) ty) * 19349663u;
+   return (int) ( h & (unsigned int) p->hash_mask );
+}
+
+static void inoglPagerUnlink( struct inogl_pager_s *p, int ipage )
+{
+   struct inogl_page_s *pg = &( p->page[ipage] );
+   int *link = &( p->hash[ inoglPagerHash( p, pg->tx, pg->ty ) ] );
+
+   while( *link != -1 ) {
+      if( *link == ipage ) {
+         *link = pg->next;
+         break;
+      }
+      link = &( p->page[ *link ].next );
+   }
+   pg->next = -1;
+}
+
+int inoglPagerInit( struct inogl_pager_s *p, int num_pages )
+{
+   memset( p, 0, sizeof(struct inogl_pager_s) );
+   if( num_pages < 1 ) return 1;
+
+   int hash_size = 1;
+   while( hash_size < 2*num_pages ) hash_size *= 2;
+
+   p->page = (struct inogl_page_s*) malloc( ((size_t) num_pages) *
+                                            sizeof(struct inogl_page_s) );
+   p->hash = (int*) malloc( ((size_t) hash_size) * sizeof(int) );
+   p->max_req = 64;
+   p->req = (struct inogl_pagereq_s*) malloc( ((size_t) p->max_req) *
+                                              sizeof(struct inogl_pagereq_s) );
+   if( p->page == NULL || p->hash == NULL || p->req == NULL ) {
+      fprintf( stdout, " [OpenGL]  Could not allocate tile pager \n" );
+      inoglPagerFree( p );
+      return 1;
+   }
+
+   p->num_pages = num_pages;
+   p->hash_mask = hash_size - 1;
+   for(int n=0;n<hash_size;++n) p->hash[n] = -1;
+   for(int n=0;n<num_pages;++n) {
+      p->page[n].tx = 0;
+      p->page[n].ty = 0;
+      p->page[n].used = 0;
+      p->page[n].region = -1;
+      p->page[n].stamp = 0;
+      p->page[n].next = -1;
+   }
+
+   return 0;
+}
+
+void inoglPagerFree( struct inogl_pager_s *p )
+{
+   if( p->page != NULL ) free( p->page );
+   if( p->hash != NULL ) free( p->hash );
+   if( p->req != NULL ) free( p->req );
+   memset( p, 0, sizeof(struct inogl_pager_s) );
+}
+
+//
+// returns the page holding a tile, or -1 if the tile is not resident
+//
+int inoglPagerFind( const struct inogl_pager_s *p, int tx, int ty )
+{
+   int n = p->hash[ inoglPagerHash( p, tx, ty ) ];
+   while( n != -1 ) {
+      if( p->page[n].tx == tx && p->page[n].ty == ty ) return n;
+      n = p->page[n].next;
+   }
+   return -1;
+}
+
+//
+// starts a round of requests; the queue of the last round is dropped
+//
+void inoglPagerBegin( struct inogl_pager_s *p )
+{
+   p->stamp += 1;
+   p->num_req = 0;
+}
+
+//
+// requests a tile; returns its page if it is resident, otherwise it is queued
+// and -1 is returned
+//
+int inoglPagerRequest( struct inogl_pager_s *p, int tx, int ty, GLfloat dist )
+{
+   int n = inoglPagerFind( p, tx, ty );
+   if( n != -1 ) {
+      p->page[n].stamp = p->stamp;
+      return n;
+   }
+
+   if( p->num_req == p->max_req ) {
+      struct inogl_pagereq_s *req = (struct inogl_pagereq_s*)
+                      realloc( p->req, 2*((size_t) p->max_req) *
+                                       sizeof(struct inogl_pagereq_s) );
+      if( req == NULL ) return -1;     // the tile is asked for again later
+      p->req = req;
+      p->max_req *= 2;
+   }
+
+   // sift up
+   int i = p->num_req++;
+   while( i > 0 ) {
+      int ip = (i - 1) / 2;
+      if( p->req[ip].dist <= dist ) break;
+      p->req[i] = p->req[ip];
+      i = ip;
+   }
+   p->req[i].dist = dist;
+   p->req[i].tx = tx;
+   p->req[i].ty = ty;
+
+   return -1;
+}
+
+//
+// takes the nearest queued tile; returns 0 when the queue is empty
+//
+int inoglPagerNext( struct inogl_pager_s *p, int *tx, int *ty )
+{
+   if( p->num_req == 0 ) return 0;
+
+   *tx = p->req[0].tx;
+   *ty = p->req[0].ty;
+
+   // sift down the last element from the top
+   struct inogl_pagereq_s last = p->req[ --p->num_req ];
+   int i = 0;
+   while( 1 ) {
+      int ic = 2*i + 1;
+      if( ic >= p->num_req ) break;
+      if( ic+1 < p->num_req && p->req[ic+1].dist < p->req[ic].dist ) ++ic;
+      if( last.dist <= p->req[ic].dist ) break;
+      p->req[i] = p->req[ic];
+      i = ic;
+   }
+   if( p->num_req > 0 ) p->req[i] = last;
+
+   return 1;
+}
+
+//
+// makes a tile resident; returns its page, or -1 if all pages hold tiles that
+// the current round wants. The storage of an evicted tile is returned in
+// "evicted" (-1 if a free page was used).
+//
+int inoglPagerInsert( struct inogl_pager_s *p, int tx, int ty, int *evicted )
+{
+   int ipage = -1;
+   *evicted = -1;
+
+   for(int n=0;n<p->num_pages;++n) {
+      const struct inogl_page_s *pg = &( p->page[n] );
+      if( !pg->used ) { ipage = n; break; }
+      if( pg->stamp == p->stamp ) continue;
+      if( ipage == -1 || pg->stamp - p->page[ipage].stamp > 0x7fffffffu ) {
+         ipage = n;         // older (in wrap-around order)
+      }
+   }
+   if( ipage == -1 ) return -1;
+
+   struct inogl_page_s *pg = &( p->page[ipage] );
+   if( pg->used ) {
+      *evicted = pg->region;
+      inoglPagerUnlink( p, ipage );
+   }
+
+   pg->tx = tx;
+   pg->ty = ty;
+   pg->used = 1;
+   pg->region = -1;
+   pg->stamp = p->stamp;
+   int ih = inoglPagerHash( p, tx, ty );
+   pg->next = p->hash[ih];
+   p->hash[ih] = ipage;
+
+   return ipage;
+}
+
+//
+// drops a tile from the cache; its storage is the caller's business
+//
+void inoglPagerRemove( struct inogl_pager_s *p, int ipage )
+{
+   if( !p->page[ipage].used ) return;
+   inoglPagerUnlink( p, ipage );
+   p->page[ipage].used = 0;
+   p->page[ipage].region = -1;
+}
@@ -10,10 +10,13 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdint.h>
 
 #include <GL/gl.h>
 #include <GL/glu.h>
 
+#include <pthread.h>
+
 //
 // vertex attribute designations
 // (These are GLSL 3.0 "v130" fixed attribute indixes; adjustable in v330.)
@@ -32,6 +35,12 @@ struct inogl_s {
    GLint maxVertexUniform;
    GLint maxFragmentUniform;
    GLint maxUniformBlockSize;
+   GLint majorVersion, minorVersion;
+   unsigned char hasBaseVertex;         // GL 3.2 or ARB_draw_elements_base_vertex
+   unsigned char hasMultiDrawIndirect;  // GL 4.3 or ARB_multi_draw_indirect
+   unsigned char hasBufferStorage;      // GL 4.4 or ARB_buffer_storage
+   unsigned char hasPrimitiveRestart;   // GL 3.1 (primitive restart index)
+   unsigned char hasInstancedArrays;    // GL 3.3 or ARB_instanced_arrays
 };
 
 struct inogl_shader_s {
@@ -43,6 +52,11 @@ struct inogl_shader_s {
    GLfloat lpos[3], tvec[3], rmat[9];
 };
 
+//
+// A group of vertices (and possibly of indices) that is drawn as one. A group
+// must be set up with "inoglGroupInit()" before its members are filled, such
+// that what is not filled (the indices, the primitive) takes the defaults.
+//
 struct inogl_grp_s {
    GLuint VAO, VBO;
    GLsizei nglm;         // number of float members per vertex
@@ -54,11 +68,432 @@ struct inogl_grp_s {
    unsigned char exist;  // 4-bit switches for pos,normal,texel,color components
                          // Switches allow for uniform size arrays, with some
                          // functionality skipped (e.g. texels but no normals).
-   int vertex_count;     // assumes "num_tri * 3" for drawing purposes
+   int vertex_count;     // assumes "num_tri * 3" for drawing purposes when
+                         // the group has no indices
+   GLint first;          // first vertex of the group in its VBO; groups that
+                         // share a VBO (and VAO) are placed back-to-back
+   GLfloat bmin[3], bmax[3];   // axis-aligned bounding box (model space)
+   GLfloat bsph[4];            // bounding sphere; centre and radius
    GLfloat* vdata;
+   GLenum mode;          // primitive drawn; zero means GL_TRIANGLES
+   GLuint EBO;           // element buffer of an indexed group (in its VAO)
+   int index_count;      // number of indices (zero for array draws)
+   GLint ifirst;         // first index of the group in its element buffer
+   GLuint restart;       // primitive restart index in the indices, or zero
+   GLuint* idata;        // indices (unsigned int) into the group's vertices
+};
+
+//
+// A list of bounding volumes (spheres and boxes) to be culled against the
+// view frustum. The list is stored as a structure of arrays, such that the
+// plane tests are done for four volumes at a time with SSE instructions. The
+// caller sets the world-space bounds of each entry, runs the culling pass,
+// and reads back the visibility flags.
+//
+struct inogl_cull_s {
+   int num, max;            // number of entries and allocated capacity
+   float* mem;              // single aligned allocation of all arrays below
+   float *cx, *cy, *cz, *r;                 // spheres
+   float *x0, *y0, *z0, *x1, *y1, *z1;      // boxes (min and max corners)
+   unsigned char* visible;  // result of the pass for each entry
+};
+
+//
+// A batch of draw commands that share a shader program and a vertex format.
+// Draws are collected over a frame and submitted with one multi-draw call per
+// run of draws on the same VAO. The indirect draw buffer is used when the
+// context supports it; otherwise the draws go through glMultiDrawArrays() or
+// glMultiDrawElementsBaseVertex() from client-side arrays.
+//
+struct inogl_batch_s {
+   GLenum mode;          // primitive type of all draws (e.g. GL_TRIANGLES)
+   GLenum itype;         // index type for indexed draws; zero for arrays
+   int num, max;         // number of collected draws and allocated capacity
+   GLuint* vao;          // vertex array object of each draw
+   GLint* first;         // first vertex (or first index) of each draw
+   GLsizei* count;       // vertex (or index) count of each draw
+   GLint* basevertex;    // base vertex of each indexed draw
+   const void** ioff;    // byte offsets of indices (non-indirect path)
+   GLuint* cmd;          // client-side copy of the indirect commands
+   GLuint IBO;           // indirect draw buffer; zero if not in use
+   GLsizeiptr ibo_size;  // bytes allocated in the indirect draw buffer
+};
+
+//
+// A streaming vertex buffer made of a number of equally sized regions. The
+// producer of vertex data acquires a free region and writes directly into
+// mapped memory (a persistent mapping with ARB_buffer_storage, otherwise the
+// region is mapped for the duration of the write). The renderer draws from
+// the region's offset and releases it when it is no longer drawn; a fence is
+// placed at release, and the region is reused only after the fence signals.
+// Regions have one of the following states.
+//
+enum inogl_stream_state {
+   INOGL_REGION_FREE = 0,   // available to be acquired
+   INOGL_REGION_WRITE = 1,  // acquired by the producer, being written
+   INOGL_REGION_USE = 2,    // committed; can be drawn from
+   INOGL_REGION_FENCE = 3,  // released; waiting on the GPU to be done with it
+};
+
+struct inogl_stream_s {
+   GLuint VBO;
+   GLsizeiptr size;          // bytes in the whole buffer
+   GLsizeiptr region_size;   // bytes in each region
+   int num_regions;
+   int head;                 // where the search for a free region starts
+   int* state;               // state of each region (accessed atomically)
+   GLsync* fence;            // fence of each released region
+   unsigned char* map;       // persistent mapping of the buffer; or NULL
+   unsigned char* wmap;      // transient mapping of the region being written
+};
+
+//
+// A pool of equally sized 2D images kept as the layers of one 2D array
+// texture, which are used like the regions of a stream buffer: a free layer
+// is acquired and filled with a sub-image upload, drawn from until it is
+// released, and reused after the fence placed at release has signaled.
+//
+struct inogl_texpool_s {
+   GLuint tex;               // the 2D array texture
+   GLsizei width, height;    // size of each layer
+   GLenum format, type;      // of the data that is uploaded
+   int num_layers;
+   int head;                 // where the search for a free layer starts
+   int *state;               // state of each layer (accessed atomically)
+   GLsync *fence;            // fence of each released layer
+};
+
+//
+// The state of the level-of-detail selection for one drawn object; level 0 is
+// the finest. The object's projected size (in pixels) is compared against a
+// threshold per level, below which the next (coarser) level is used. To avoid
+// popping back and forth, a coarser level is only left when the size exceeds
+// its threshold by the hysteresis fraction. The geometry of the levels is
+// kept by the caller (as groups, or ranges in a buffer).
+//
+#define INOGL_MAX_LOD 8
+
+struct inogl_lod_s {
+   int num_levels;
+   GLfloat size[INOGL_MAX_LOD];   // size below which level n+1 is used
+   GLfloat hyst;                  // fraction for switching to a finer level
+   int current;                   // level in use
+};
+
+//
+// A pager of tiles of an unbounded 2D tile space. It keeps a cache of a fixed
+// number of pages (the memory budget in tiles), each holding one tile that
+// lives in some GPU storage (typically a region of a stream buffer), found by
+// the tile's coordinates through a hash. Every round of requests is stamped;
+// requested tiles that are resident are touched, the others are queued by
+// distance to the viewer, nearest first. A missing tile takes a free page or
+// evicts the least-recently requested page that the current round does not
+// want; the evicted storage is handed back to the caller, who deletes it once
+// the GPU is done with it (deferred deletion). The caller sets the storage of
+// a page once it has it.
+//
+struct inogl_page_s {
+   int tx, ty;               // tile coordinates
+   int used;                 // the page holds a tile
+   int region;               // storage of the tile; -1 if it has none yet
+   unsigned int stamp;       // last round that requested the tile
+   int next;                 // next page in the hash chain; -1 ends it
+};
+
+struct inogl_pagereq_s {
+   GLfloat dist;             // distance of the tile to the viewer
+   int tx, ty;
+};
+
+struct inogl_pager_s {
+   int num_pages;
+   struct inogl_page_s *page;
+   int *hash;                // first page of each hash chain; -1 if empty
+   int hash_mask;
+   unsigned int stamp;       // current round of requests
+   int num_req, max_req;
+   struct inogl_pagereq_s *req;   // binary heap of the missing tiles
+};
+
+//
+// A handoff of a GL object (a buffer, or a region of a stream buffer) from
+// the context that uploads it to the context that draws it. The producer
+// publishes the object together with a fence that follows the upload; the
+// consumer checks the fence (or makes the GPU wait on it) before first use,
+// and keeps drawing what it had until then.
+//
+enum inogl_handoff_state {
+   INOGL_HANDOFF_EMPTY = 0,    // nothing published
+   INOGL_HANDOFF_FENCED = 1,   // published; upload may still be in flight
+   INOGL_HANDOFF_READY = 2,    // the consumer may use the object
 };
 
+struct inogl_handoff_s {
+   GLuint name;              // handle of the object
+   int region;               // region of a stream buffer; -1 if not used
+   GLsync fence;             // fence placed after the upload
+   int state;                // one of the above (accessed atomically)
+};
+
+//
+// A manager of the lifetime of GL resources that are used by more than one
+// context. Every resource has a type, an explicit state that changes
+// atomically (created, ready to be used, retired), and an owner: VAOs are not
+// shared between contexts, so a VAO belongs to the context that made it and
+// is only deleted there; buffers and textures are shared (owner -1). A retired
+// resource goes into a retirement queue of a context, stamped with the frame
+// of that context in which it was retired, and it is deleted once a fence
+// that ends that frame (or a later one) has signaled; a context ends its
+// frames by calling the frame function (a renderer after drawing, a producer
+// after a batch of work), which never blocks on the GPU.
+// Sub-allocations (regions of a stream buffer, layers of a texture pool) are
+// retired in the same way and handed back through a recycle function.
+//
+#define INOGL_RES_FRAMES   4      // frames in flight that are fenced
+#define INOGL_RES_CONTEXTS 4      // contexts that can be registered
+
+enum inogl_res_type {
+   INOGL_RES_BUFFER = 1,
+   INOGL_RES_VAO = 2,
+   INOGL_RES_TEXTURE = 3,
+   INOGL_RES_REGION = 4,       // a part of some object; recycled, not deleted
+};
+
+enum inogl_res_state {
+   INOGL_RES_FREE = 0,         // the slot is not used
+   INOGL_RES_CREATED = 1,      // made (or being filled); not to be used yet
+   INOGL_RES_READY = 2,        // may be used
+   INOGL_RES_RETIRED = 3,      // waiting on a fence to be deleted
+};
+
+struct inogl_res_s {
+   int type;
+   GLuint name;                // GL name; index of a region
+   int owner;                  // context that owns it; -1 if shared
+   int state;                  // accessed atomically
+   unsigned int frame;         // frame of the retiring context at retirement
+   int next;                   // next slot in the free list or a queue
+   void (*recycle)( void *obj, int index );   // for regions
+   void *obj;                  // object the region belongs to
+};
+
+struct inogl_resctx_s {
+   unsigned int frame;         // the frame in progress
+   unsigned int done;          // all frames before this one have completed
+   GLsync fence[INOGL_RES_FRAMES];
+   unsigned int fframe[INOGL_RES_FRAMES];
+   int retired, retired_tail;  // queue of retired resources
+};
+
+struct inogl_resmgr_s {
+   pthread_mutex_t mtx;        // guards the free list and the queues
+   int max;
+   struct inogl_res_s *res;
+   int free_head;
+   int num_ctx;
+   struct inogl_resctx_s ctx[INOGL_RES_CONTEXTS];
+};
+
+//
+// A pool of worker threads that upload data to the GPU, each in its own GL
+// context that shares objects with the rendering context. The contexts are
+// made by the windowing code and are bound through the given function. Jobs
+// are queued (the caller owns the job and its data until it has been issued;
+// see the wait function) and each job is completed with a fence that is
+// published through its handoff, which other contexts check before using what
+// was uploaded.
+//
+#define INOGL_UPLOAD_QUEUE 256    // jobs that can be waiting
+
+enum inogl_upload_type {
+   INOGL_UPLOAD_BUFFER = 1,    // a range of a buffer (or a new buffer)
+   INOGL_UPLOAD_TEXTURE = 2,   // a sub-image of a texture
+   INOGL_UPLOAD_PROGRAM = 3,   // compile and link a shader program
+};
+
+struct inogl_upload_s {
+   int type;
+   GLenum target;              // buffer or texture target
+   GLuint name;                // object to upload to; a new buffer if zero
+   GLintptr offset;            // range in a buffer (the size of a new one)
+   GLsizeiptr size;
+   GLint level, xoff, yoff, zoff;   // texture sub-image
+   GLsizei width, height, depth;    // (depth of 0 for 2D targets)
+   GLenum format, dtype;
+   const void *data;
+   struct inogl_shader_s *prog;     // program and its sources
+   const GLchar *vsrc, *fsrc;
+   struct inogl_handoff_s *h;  // where the completion is published; optional
+   int region;                 // region index given to the handoff
+   int status;                 // result (0 for success) once issued
+   void (*done)( struct inogl_upload_s *j );   // called once issued; optional
+   void *user;                 // for the caller
+};
+
+struct inogl_uploader_s {
+   int num_workers;
+   pthread_t *tid;
+   pthread_mutex_t mtx;
+   pthread_cond_t cv_work, cv_done;
+   struct inogl_upload_s *queue[INOGL_UPLOAD_QUEUE];
+   int head, count;            // jobs waiting
+   int busy;                   // jobs taken by workers and not yet issued
+   int num_ready;              // workers that tried to make their context
+   int num_live;               // current, and those that did (the others
+                               // have ended)
+   int istop;
+   int (*bind)( void *arg, int worker );   // make worker's context current
+   void *arg;
+};
+
+//
+// A queue of commands for the thread that renders, so that any thread can ask
+// for GL work without a context of its own. Producers link commands in with a
+// single atomic exchange (there are no locks) and the render thread runs them
+// at a fixed point of its frame, for no longer than a budget of time; what is
+// left runs in the next frame (in order). Commands are allocated by the post
+// functions and freed after they run; the data of a sub-range upload is
+// copied into the command. A poster may pass a flag that is set once its
+// command has run (and a place for the name of a created object).
+//
+enum inogl_cmd_type {
+   INOGL_CMD_CALL = 1,         // a function and its argument
+   INOGL_CMD_VAO = 2,          // make a VAO (and set it up with a function)
+   INOGL_CMD_DELETE = 3,       // delete an object of a resource type
+   INOGL_CMD_UNIFORM = 4,      // set a uniform of a program
+   INOGL_CMD_SUBDATA = 5,      // upload a sub-range of a buffer
+};
+
+struct inogl_cmd_s {
+   struct inogl_cmd_s *next;   // (accessed atomically)
+   int type;
+   void (*func)( void *arg, GLuint name );
+   void *arg;
+   GLuint name;                // object or program
+   GLenum target;              // resource type, buffer target or uniform kind
+   GLint loc;                  // uniform location
+   GLsizei count;              // components of a uniform
+   GLfloat val[16];
+   GLintptr offset;
+   GLsizeiptr size;
+   GLuint *result;             // where a created object's name goes
+   int *done;                  // set to 1 once the command ran
+   unsigned char data[];       // data of an upload
+};
+
+struct inogl_cmdq_s {
+   struct inogl_cmd_s *head;   // last command in (producers exchange it)
+   struct inogl_cmd_s *tail;   // next command out (the consumer's)
+   struct inogl_cmd_s stub;
+   unsigned long num_run;      // commands run
+   unsigned long num_late;     // frames that left commands for later
+};
+
+//
+// A binary cache of groups (vertices and optional indices) that is mapped
+// into memory instead of being read. The file has a header, a table with an
+// entry per group (its vertex layout in the terms of the group structure,
+// counts, primitive and bounds), and the payloads; every payload starts at a
+// page boundary, so that the mapped data is handed to the GL as is (with no
+// parsing or copying). The file is written in the byte order of the machine,
+// which the header records, and a cache of another version, byte order or
+// tag (a number that the user derives from whatever made the data) is
+// rejected such that the data are made again.
+//
+#define INOGL_MESH_MAGIC   "INOGLMSH"
+#define INOGL_MESH_VERSION 1
+#define INOGL_MESH_ENDIAN  0x01020304u
+#define INOGL_MESH_NGLM    64     // floats per vertex, at most
+
+struct inogl_meshhdr_s {       // (64 bytes)
+   char magic[8];
+   uint32_t version;
+   uint32_t endian;            // reads as INOGL_MESH_ENDIAN when it matches
+   uint32_t page;              // alignment of payloads in the file
+   uint32_t num_groups;
+   uint64_t tag;               // the user's; must match when mapping
+   uint64_t file_size;
+   uint64_t table_offset;      // of the first group entry
+   uint32_t entry_size;        // size of group entries
+   uint32_t reserved[3];
+};
+
+struct inogl_meshent_s {       // (112 bytes)
+   int32_t nglm;
+   int32_t moff[4];
+   uint32_t exist;
+   uint32_t mode;              // zero means GL_TRIANGLES
+   uint32_t restart;
+   uint64_t vertex_count;
+   uint64_t index_count;       // zero when there are no indices
+   uint64_t voffset;           // of vertices (page aligned)
+   uint64_t ioffset;           // of indices (page aligned), or zero
+   float bmin[3], bmax[3];
+   float bsph[4];
+   uint32_t reserved[2];
+};
+
+struct inogl_mesh_s {
+   void *base;                 // the mapping
+   size_t size;
+   int num_groups;
+   struct inogl_grp_s *grps;   // groups with data pointing into the mapping
+};
+
+//
+// Drawing of parametric shapes with no vertex data: the vertex shader makes
+// every vertex from "gl_VertexID" and a few uniforms, and the draw call binds
+// a VAO that has no attributes. A shape has "im" by "jm" nodes and is drawn
+// as independent triangles (six vertices per quad), and a draw makes many
+// copies of it on a lattice; the vertex index counts through the copies, so
+// copy "n" is "procInst.y + gl_VertexID / (vertices per shape)". Programs
+// must have these uniforms:
+//  ivec2 procNodes;   nodes in the i and j directions ("im", "jm")
+//  int procShape;     the shape (see below)
+//  ivec2 procInst;    copies per row of the lattice, and the first copy
+//  vec4 procStep;     spacing of the lattice (x,y,z) and size of the shape
+//  mat4 procXform;    placement of the whole lattice
+// (The view uniforms and others are the caller's to set.)
+//
+enum inogl_proc_shape {
+   INOGL_PROC_SPHERE = 1,      // the axis sphere; the size is the radius
+   INOGL_PROC_GRID = 2,        // a flat grid in x-y; the size is its side
+};
+
+struct inogl_proc_s {
+   GLuint VAO;                 // has no attributes
+   GLuint program;
+   GLint nodesLoc, shapeLoc, instLoc, stepLoc, xformLoc;
+};
+
+//
+// A set of objects placed in the scene by a hierarchy of transforms. Every
+// object has a local transform (relative to its parent), a world transform,
+// bounds in world space, and it may draw a group (the first of its levels of
+// detail). The objects are kept as a structure of arrays sorted by their depth
+// in the hierarchy, so parents come before their children and all world
+// transforms are updated in one sweep over the arrays; only objects whose
+// local transform was set since the last update, and their descendants, are
+// recomputed. The world bounds have the layout of the cull list and are
+// copied into it as they are. Objects are referred to by handles, which do
+// not change when the arrays are sorted.
+//
+#define INOGL_OBJ_DIRTY  0x01    // the local transform was set
+#define INOGL_OBJ_MOVED  0x02    // the world transform changed in the update
+
 struct inogl_obj_s {
+   int num, max;            // number of objects and allocated capacity
+   int sorted;              // the slots are in the order of depth
+   float* mem;              // single aligned allocation of all floats below
+   GLfloat *local, *world;  // transforms (4x4 column-major) of each slot
+   float *cx, *cy, *cz, *r;                 // world bounding spheres
+   float *x0, *y0, *z0, *x1, *y1, *z1;      // world bounding boxes
+   int* parent;             // slot of the parent; -1 for roots
+   int* depth;              // zero for roots
+   unsigned char* flags;    // INOGL_OBJ_* bits of each slot
+   const struct inogl_grp_s** grp;          // group drawn; NULL if none
+   int* handle;             // handle of the object in each slot
+   int* slot;               // slot of each handle
 };
 
 
@@ -134,7 +569,209 @@ int inoglMakeProgram1( struct inogl_shader_s *p,
                        const GLchar* vertexShaderSource,
                        const GLchar* fragmentShaderSource );
 
+void inoglGroupInit( struct inogl_grp_s *gp );
+
 int inoglMakeGroupVAOVBO( struct inogl_grp_s *gp );
 
+int inoglMakeGroupsSharedVAOVBO( int num, struct inogl_grp_s *gps );
+
+void inoglDrawGroup( const struct inogl_grp_s *gp );
+
+int inoglHasExtension( const struct inogl_s* p, const char* name );
+
+int inoglBatchInit( struct inogl_batch_s *b, GLenum mode, GLenum itype,
+                    int max, const struct inogl_s* ogl );
+
+void inoglBatchReset( struct inogl_batch_s *b );
+
+int inoglBatchAddArrays( struct inogl_batch_s *b,
+                         GLuint vao, GLint first, GLsizei count );
+
+int inoglBatchAddElements( struct inogl_batch_s *b, GLuint vao,
+                           GLint first, GLsizei count, GLint basevertex );
+
+int inoglBatchAddGroup( struct inogl_batch_s *b,
+                        const struct inogl_grp_s *gp );
+
+void inoglBatchSubmit( struct inogl_batch_s *b );
+
+void inoglBatchFree( struct inogl_batch_s *b );
+
+int inoglStreamInit( struct inogl_stream_s *s, GLsizeiptr region_size,
+                     int num_regions, const struct inogl_s* ogl );
+
+void* inoglStreamAcquire( struct inogl_stream_s *s, int *region );
+
+void inoglStreamCommit( struct inogl_stream_s *s, int region );
+
+void inoglStreamRelease( struct inogl_stream_s *s, int region );
+
+GLint inoglStreamFirst( const struct inogl_stream_s *s, int region,
+                        GLsizei stride );
+
+void inoglStreamFree( struct inogl_stream_s *s );
+
+int inoglTexPoolInit( struct inogl_texpool_s *t, GLenum iformat,
+                      GLsizei width, GLsizei height, int num_layers,
+                      GLenum format, GLenum type );
+
+int inoglTexPoolAcquire( struct inogl_texpool_s *t );
+
+void inoglTexPoolCommit( struct inogl_texpool_s *t, int layer );
+
+void inoglTexPoolUpload( struct inogl_texpool_s *t, int layer,
+                         const void *data );
+
+void inoglTexPoolRelease( struct inogl_texpool_s *t, int layer );
+
+void inoglTexPoolFree( struct inogl_texpool_s *t );
+
+void inoglGroupBounds( struct inogl_grp_s *gp );
+
+int inoglMeshSave( const char *fname, uint64_t tag,
+                   int num, const struct inogl_grp_s *gps );
+
+int inoglMeshMap( struct inogl_mesh_s *m, const char *fname, uint64_t tag );
+
+void inoglMeshUnmap( struct inogl_mesh_s *m );
+
+void inoglMatMul4( GLfloat *c, const GLfloat *a, const GLfloat *b );
+
+void inoglFrustumPlanes( GLfloat *planes, const GLfloat *clip );
+
+int inoglCullInit( struct inogl_cull_s *c, int max );
+
+void inoglCullSet( struct inogl_cull_s *c, int i,
+                   const GLfloat *bmin, const GLfloat *bmax,
+                   const GLfloat *bsph, const GLfloat *shift );
+
+int inoglCullRun( struct inogl_cull_s *c, const GLfloat *planes );
+
+void inoglCullFree( struct inogl_cull_s *c );
+
+int inoglProcInit( struct inogl_proc_s *pr, GLuint program );
+
+GLsizei inoglProcVertices( int im, int jm );
+
+void inoglProcDraw( const struct inogl_proc_s *pr, int shape, int im, int jm,
+                    GLfloat size, long num, int per_row,
+                    const GLfloat *step, const GLfloat *xform );
+
+void inoglProcFree( struct inogl_proc_s *pr );
+
+int inoglObjInit( struct inogl_obj_s *o, int max );
+
+int inoglObjAdd( struct inogl_obj_s *o, int parent,
+                 const struct inogl_grp_s *gp );
+
+void inoglObjSetLocal( struct inogl_obj_s *o, int h, const GLfloat *m );
+
+void inoglObjPlace( struct inogl_obj_s *o, int h,
+                    const GLfloat *trans, const GLfloat *rot );
+
+const GLfloat* inoglObjWorld( const struct inogl_obj_s *o, int h );
+
+int inoglObjUpdate( struct inogl_obj_s *o );
+
+void inoglObjCull( const struct inogl_obj_s *o, struct inogl_cull_s *c,
+                   int first );
+
+void inoglObjFree( struct inogl_obj_s *o );
+
+void inoglLodInit( struct inogl_lod_s *l, int num_levels,
+                   GLfloat size0, GLfloat hyst );
+
+int inoglLodSelect( struct inogl_lod_s *l, GLfloat size );
+
+GLfloat inoglProjectedSize( const GLfloat *modelview, const GLfloat *proj,
+                            GLfloat height, const GLfloat *bsph,
+                            const GLfloat *shift );
+
+int inoglPagerInit( struct inogl_pager_s *p, int num_pages );
+
+void inoglPagerFree( struct inogl_pager_s *p );
+
+int inoglPagerFind( const struct inogl_pager_s *p, int tx, int ty );
+
+void inoglPagerBegin( struct inogl_pager_s *p );
+
+int inoglPagerRequest( struct inogl_pager_s *p, int tx, int ty, GLfloat dist );
+
+int inoglPagerNext( struct inogl_pager_s *p, int *tx, int *ty );
+
+int inoglPagerInsert( struct inogl_pager_s *p, int tx, int ty, int *evicted );
+
+void inoglPagerRemove( struct inogl_pager_s *p, int ipage );
+
+int inoglResInit( struct inogl_resmgr_s *m, int max );
+
+int inoglResContext( struct inogl_resmgr_s *m );
+
+int inoglResCreate( struct inogl_resmgr_s *m, int type, int ctx );
+
+int inoglResAdopt( struct inogl_resmgr_s *m, int type, GLuint name, int ctx );
+
+int inoglResRegion( struct inogl_resmgr_s *m,
+                    void (*recycle)( void *obj, int index ),
+                    void *obj, int index );
+
+GLuint inoglResName( const struct inogl_resmgr_s *m, int id );
+
+int inoglResPublish( struct inogl_resmgr_s *m, int id );
+
+int inoglResReady( const struct inogl_resmgr_s *m, int id );
+
+int inoglResRetire( struct inogl_resmgr_s *m, int id, int ctx );
+
+void inoglResFrame( struct inogl_resmgr_s *m, int ctx );
+
+int inoglResPending( struct inogl_resmgr_s *m, int ctx );
+
+void inoglResFree( struct inogl_resmgr_s *m );
+
+int inoglUploaderInit( struct inogl_uploader_s *u, int num_workers,
+                       int (*bind)( void *arg, int worker ), void *arg );
+
+int inoglUploadSubmit( struct inogl_uploader_s *u, struct inogl_upload_s *j );
+
+void inoglUploadWait( struct inogl_uploader_s *u );
+
+int inoglUploadReady( struct inogl_upload_s *j, int igpu );
+
+void inoglUploaderFree( struct inogl_uploader_s *u );
+
+void inoglCmdInit( struct inogl_cmdq_s *q );
+
+int inoglCmdPostCall( struct inogl_cmdq_s *q,
+                      void (*func)( void *arg, GLuint name ), void *arg,
+                      int *done );
+
+int inoglCmdPostVAO( struct inogl_cmdq_s *q,
+                     void (*setup)( void *arg, GLuint vao ), void *arg,
+                     GLuint *result, int *done );
+
+int inoglCmdPostDelete( struct inogl_cmdq_s *q, int type, GLuint name );
+
+int inoglCmdPostUniform( struct inogl_cmdq_s *q, GLuint program, GLint loc,
+                         GLenum kind, GLsizei count, const GLfloat *val );
+
+int inoglCmdPostSubData( struct inogl_cmdq_s *q, GLenum target, GLuint name,
+                         GLintptr offset, GLsizeiptr size, const void *data,
+                         int *done );
+
+int inoglCmdRun( struct inogl_cmdq_s *q, long budget_us );
+
+void inoglCmdFree( struct inogl_cmdq_s *q );
+
+void inoglStreamRecycle( void *obj, int region );
+
+void inoglTexPoolRecycle( void *obj, int layer );
+
+void inoglHandoffPublish( struct inogl_handoff_s *h, GLuint name, int region );
+
+int inoglHandoffReady( struct inogl_handoff_s *h, int igpu );
+
+void inoglHandoffClear( struct inogl_handoff_s *h );
+
 
 #endif
@@ -0,0 +1,606 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "inthreads.h"
+
+
+//
+// Function to set up a triple buffer over three user buffers; the consumer
+// starts out holding the third one, so it should be valid (if empty) data
+//
+
+void inTripleInit( struct in_triple_s *t, void *s0, void *s1, void *s2 )
+{
+   t->slot[0] = s0;
+   t->slot[1] = s1;
+   t->slot[2] = s2;
+   t->write = 0;
+   t->read = 2;
+   __atomic_store_n( &( t->middle ), 1, __ATOMIC_RELEASE );
+}
+
+
+//
+// Function to return the buffer the producer should fill next (producer side)
+//
+
+void* inTripleWriteSlot( struct in_triple_s *t )
+{
+   return t->slot[ t->write ];
+}
+
+
+//
+// Function to publish the buffer that was filled (producer side); the slot
+// that comes back from the middle becomes the next one to write. It returns
+// 1 if the previous publication was replaced before the consumer took it,
+// which is the only way the producer learns what the consumer never saw.
+//
+
+int inTriplePublish( struct in_triple_s *t )
+{
+   unsigned int old = __atomic_exchange_n( &( t->middle ),
+                                   ((unsigned int) t->write) | IN_TRIPLE_NEW,
+                                           __ATOMIC_ACQ_REL );
+   t->write = (int) ( old & 0x03 );
+
+   return ( old & IN_TRIPLE_NEW ) ? 1 : 0;
+}
+
+
+//
+// Function to get the newest complete buffer (consumer side); if something
+// was published since the last call the slots are swapped and "inew" is set,
+// otherwise the buffer that was held is returned again
+//
+
+void* inTripleAcquire( struct in_triple_s *t, int *inew )
+{
+   int i = 0;
+
+   if( __atomic_load_n( &( t->middle ), __ATOMIC_ACQUIRE ) & IN_TRIPLE_NEW ) {
+      unsigned int old = __atomic_exchange_n( &( t->middle ),
+                                              (unsigned int) t->read,
+                                              __ATOMIC_ACQ_REL );
+      t->read = (int) ( old & 0x03 );
+      i = 1;
+   }
+
+   if( inew != NULL ) *inew = i;
+   return t->slot[ t->read ];
+}
+
+
+//
+// Functions of the deques of the work-stealing pool. A deque is short-lived
+// contention (a push or a pop), so a mutex per deque is good enough; workers
+// contend only when they steal.
+//
+
+static int inDequeInit( struct in_deque_s *d, int size )
+{
+   d->ring = (struct in_task_s*) malloc( ((size_t) size) *
+                                         sizeof(struct in_task_s) );
+   if( d->ring == NULL ) return 1;
+   d->size = size;
+   d->top = 0;
+   d->bottom = 0;
+   pthread_mutex_init( &( d->mtx ), NULL );
+
+   return 0;
+}
+
+static int inDequePush( struct in_deque_s *d, const struct in_task_s *t )
+{
+   pthread_mutex_lock( &( d->mtx ) );
+   if( d->bottom - d->top == (long) d->size ) {
+      // full; double the ring and unwrap the tasks into the new one
+      struct in_task_s *ring = (struct in_task_s*)
+                               malloc( 2*((size_t) d->size) *
+                                       sizeof(struct in_task_s) );
+      if( ring == NULL ) {
+         pthread_mutex_unlock( &( d->mtx ) );
+         return 1;
+      }
+      for(long n=d->top;n<d->bottom;++n) {
+         ring[ n & (2*d->size-1) ] = d->ring[ n & (d->size-1) ];
+      }
+      free( d->ring );
+      d->ring = ring;
+      d->size *= 2;
+   }
+   d->ring[ d->bottom & (d->size-1) ] = *t;
+   d->bottom += 1;
+   pthread_mutex_unlock( &( d->mtx ) );
+
+   return 0;
+}
+
+static int inDequePop( struct in_deque_s *d, struct in_task_s *t, int isteal )
+{
+   int iret = 0;
+
+   pthread_mutex_lock( &( d->mtx ) );
+   if( d->bottom > d->top ) {
+      if( isteal ) {
+         *t = d->ring[ d->top & (d->size-1) ];
+         d->top += 1;
+      } else {
+         d->bottom -= 1;
+         *t = d->ring[ d->bottom & (d->size-1) ];
+      }
+      iret = 1;
+   }
+   pthread_mutex_unlock( &( d->mtx ) );
+
+   return iret;
+}
+
+static void inDequeFree( struct in_deque_s *d )
+{
+   if( d->ring != NULL ) free( d->ring );
+   d->ring = NULL;
+   pthread_mutex_destroy( &( d->mtx ) );
+}
+
+
+//
+// the pool and worker index of the calling thread; -1 outside of any pool
+//
+
+static __thread struct in_pool_s *in_pool_self = NULL;
+static __thread int in_pool_worker = -1;
+
+
+//
+// Function to find a task for worker "iw" (or for an outside thread, with
+// iw=-1); its own deque first, then stealing from the others in turn
+//
+
+static int inPoolFind( struct in_pool_s *p, int iw, struct in_task_s *t )
+{
+   if( iw >= 0 && inDequePop( &( p->dq[iw] ), t, 0 ) ) return 1;
+
+   int n0 = ( iw >= 0 ) ? iw + 1 : 0;
+   for(int m=0;m<p->num_workers;++m) {
+      int n = (n0 + m) % p->num_workers;
+      if( n == iw ) continue;
+      if( inDequePop( &( p->dq[n] ), t, 1 ) ) return 1;
+   }
+
+   return 0;
+}
+
+static void inPoolRun( struct in_pool_s *p, const struct in_task_s *t )
+{
+   __atomic_sub_fetch( &( p->queued ), 1, __ATOMIC_ACQ_REL );
+
+   t->func( t->arg );
+
+   if( __atomic_sub_fetch( &( p->pending ), 1, __ATOMIC_ACQ_REL ) == 0 ) {
+      pthread_mutex_lock( &( p->mtx ) );
+      pthread_cond_broadcast( &( p->cv_done ) );
+      pthread_mutex_unlock( &( p->mtx ) );
+   }
+}
+
+struct in_worker_s {
+   struct in_pool_s *p;
+   int iw;
+};
+
+static void* inPoolWorker( void *arg )
+{
+   struct in_worker_s *w = (struct in_worker_s*) arg;
+   struct in_pool_s *p = w->p;
+   int iw = w->iw;
+   free( w );
+
+   in_pool_self = p;
+   in_pool_worker = iw;
+
+   while( 1 ) {
+      struct in_task_s t;
+      if( inPoolFind( p, iw, &t ) ) {
+         inPoolRun( p, &t );
+         continue;
+      }
+
+      // nothing to do; sleep until something is queued (checked under the
+      // lock that submitters signal with, so a wake-up cannot be missed)
+      pthread_mutex_lock( &( p->mtx ) );
+      while( __atomic_load_n( &( p->queued ), __ATOMIC_ACQUIRE ) == 0 &&
+             !p->istop ) {
+         pthread_cond_wait( &( p->cv_work ), &( p->mtx ) );
+      }
+      int istop = p->istop;
+      pthread_mutex_unlock( &( p->mtx ) );
+      if( istop ) break;
+   }
+
+   return NULL;
+}
+
+
+//
+// Function to start a pool; with "num_workers" less than one the pool is
+// sized to the number of online processors
+//
+
+int inPoolInit( struct in_pool_s *p, int num_workers )
+{
+   memset( p, 0, sizeof(struct in_pool_s) );
+
+   if( num_workers < 1 ) {
+      long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+      num_workers = ( ncpu > 0 ) ? (int) ncpu : 1;
+   }
+
+   p->dq = (struct in_deque_s*) malloc( ((size_t) num_workers) *
+                                        sizeof(struct in_deque_s) );
+   p->tid = (pthread_t*) malloc( ((size_t) num_workers) * sizeof(pthread_t) );
+   if( p->dq == NULL || p->tid == NULL ) {
+      fprintf( stdout, " [Threads]  Could not allocate pool \n" );
+      if( p->dq != NULL ) free( p->dq );
+      if( p->tid != NULL ) free( p->tid );
+      memset( p, 0, sizeof(struct in_pool_s) );
+      return 1;
+   }
+   for(int n=0;n<num_workers;++n) {
+      if( inDequeInit( &( p->dq[n] ), 64 ) ) {
+         fprintf( stdout, " [Threads]  Could not allocate pool \n" );
+         for(int m=0;m<n;++m) inDequeFree( &( p->dq[m] ) );
+         free( p->dq );
+         free( p->tid );
+         memset( p, 0, sizeof(struct in_pool_s) );
+         return 1;
+      }
+   }
+
+   pthread_mutex_init( &( p->mtx ), NULL );
+   pthread_cond_init( &( p->cv_work ), NULL );
+   pthread_cond_init( &( p->cv_done ), NULL );
+
+   // the count is set first; the workers read it when they steal
+   p->num_workers = num_workers;
+   for(int n=0;n<num_workers;++n) {
+      struct in_worker_s *w = (struct in_worker_s*)
+                              malloc( sizeof(struct in_worker_s) );
+      if( w != NULL ) {
+         w->p = p;
+         w->iw = n;
+      }
+      if( w == NULL ||
+          pthread_create( &( p->tid[n] ), NULL, &inPoolWorker, (void*) w ) ) {
+         fprintf( stdout, " [Threads]  Could not create worker %d \n", n );
+         if( w != NULL ) free( w );
+         // stop the ones that were started and drop everything
+         pthread_mutex_lock( &( p->mtx ) );
+         p->istop = 1;
+         pthread_cond_broadcast( &( p->cv_work ) );
+         pthread_mutex_unlock( &( p->mtx ) );
+         for(int m=0;m<n;++m) pthread_join( p->tid[m], NULL );
+         p->num_workers = 0;
+         for(int m=0;m<num_workers;++m) inDequeFree( &( p->dq[m] ) );
+         free( p->dq );
+         free( p->tid );
+         pthread_mutex_destroy( &( p->mtx ) );
+         pthread_cond_destroy( &( p->cv_work ) );
+         pthread_cond_destroy( &( p->cv_done ) );
+         memset( p, 0, sizeof(struct in_pool_s) );
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+
+//
+// Function to queue a task
+//
+
+int inPoolSubmit( struct in_pool_s *p, void (*func)( void *arg ), void *arg )
+{
+   struct in_task_s t = { func, arg };
+
+   int n = in_pool_worker;
+   if( in_pool_self != p || n < 0 ) {
+      n = (int) ( __atomic_fetch_add( &( p->next ), 1, __ATOMIC_RELAXED ) %
+                  (unsigned int) p->num_workers );
+   }
+
+   __atomic_add_fetch( &( p->pending ), 1, __ATOMIC_ACQ_REL );
+   if( inDequePush( &( p->dq[n] ), &t ) ) {
+      __atomic_sub_fetch( &( p->pending ), 1, __ATOMIC_ACQ_REL );
+      return 1;
+   }
+   __atomic_add_fetch( &( p->queued ), 1, __ATOMIC_ACQ_REL );
+
+   pthread_mutex_lock( &( p->mtx ) );
+   pthread_cond_signal( &( p->cv_work ) );
+   pthread_mutex_unlock( &( p->mtx ) );
+
+   return 0;
+}
+
+
+//
+// Function to wait until all submitted tasks have completed; the caller runs
+// tasks while there are any to take
+//
+
+void inPoolWait( struct in_pool_s *p )
+{
+   int iw = ( in_pool_self == p ) ? in_pool_worker : -1;
+
+   while( __atomic_load_n( &( p->pending ), __ATOMIC_ACQUIRE ) > 0 ) {
+      struct in_task_s t;
+      if( inPoolFind( p, iw, &t ) ) {
+         inPoolRun( p, &t );
+         continue;
+      }
+
+      // the remaining tasks are running elsewhere
+      pthread_mutex_lock( &( p->mtx ) );
+      while( __atomic_load_n( &( p->pending ), __ATOMIC_ACQUIRE ) > 0 &&
+             __atomic_load_n( &( p->queued ), __ATOMIC_ACQUIRE ) == 0 ) {
+         pthread_cond_wait( &( p->cv_done ), &( p->mtx ) );
+      }
+      pthread_mutex_unlock( &( p->mtx ) );
+   }
+}
+
+
+//
+// Function to stop the workers and drop the pool; tasks still queued are not
+// run, so a wait should come first
+//
+
+void inPoolFree( struct in_pool_s *p )
+{
+   pthread_mutex_lock( &( p->mtx ) );
+   p->istop = 1;
+   pthread_cond_broadcast( &( p->cv_work ) );
+   pthread_mutex_unlock( &( p->mtx ) );
+
+   for(int n=0;n<p->num_workers;++n) pthread_join( p->tid[n], NULL );
+
+   if( p->dq != NULL ) {
+      for(int n=0;n<p->num_workers;++n) inDequeFree( &( p->dq[n] ) );
+      free( p->dq );
+   }
+   if( p->tid != NULL ) free( p->tid );
+
+   pthread_mutex_destroy( &( p->mtx ) );
+   pthread_cond_destroy( &( p->cv_work ) );
+   pthread_cond_destroy( &( p->cv_done ) );
+   memset( p, 0, sizeof(struct in_pool_s) );
+}
+
+
+//
+// Function to set up a bounded queue of "size" items
+//
+
+int inQueueInit( struct in_queue_s *q, int size )
+{
+   memset( q, 0, sizeof(struct in_queue_s) );
+   q->ring = (void**) malloc( ((size_t) size)*sizeof(void*) );
+   if( q->ring == NULL ) {
+      fprintf( stdout, " [Threads]  Could not allocate queue \n" );
+      return 1;
+   }
+   q->size = size;
+
+   pthread_mutex_init( &( q->mtx ), NULL );
+   pthread_cond_init( &( q->cv_put ), NULL );
+   pthread_cond_init( &( q->cv_get ), NULL );
+
+   return 0;
+}
+
+
+//
+// Function to add an item to the tail of a queue; it waits for room
+//
+
+void inQueuePut( struct in_queue_s *q, void *item )
+{
+   pthread_mutex_lock( &( q->mtx ) );
+   if( q->count == q->size ) q->num_full += 1;
+   while( q->count == q->size ) {
+      pthread_cond_wait( &( q->cv_put ), &( q->mtx ) );
+   }
+
+   q->ring[ (q->head + q->count) % q->size ] = item;
+   q->count += 1;
+   q->num_put += 1;
+   if( q->count > q->max_count ) q->max_count = q->count;
+
+   pthread_cond_signal( &( q->cv_get ) );
+   pthread_mutex_unlock( &( q->mtx ) );
+}
+
+
+//
+// Function to take the item at the head of a queue; if it is empty, this
+// waits for an item when "iblock" is set and returns NULL otherwise
+//
+
+void* inQueueGet( struct in_queue_s *q, int iblock )
+{
+   void *item = NULL;
+
+   pthread_mutex_lock( &( q->mtx ) );
+   while( iblock && q->count == 0 ) {
+      pthread_cond_wait( &( q->cv_get ), &( q->mtx ) );
+   }
+   if( q->count > 0 ) {
+      item = q->ring[ q->head ];
+      q->head = (q->head + 1) % q->size;
+      q->count -= 1;
+      pthread_cond_signal( &( q->cv_put ) );
+   }
+   pthread_mutex_unlock( &( q->mtx ) );
+
+   return item;
+}
+
+
+//
+// Function to return the number of items in a queue (a snapshot)
+//
+
+int inQueueDepth( struct in_queue_s *q )
+{
+   pthread_mutex_lock( &( q->mtx ) );
+   int n = q->count;
+   pthread_mutex_unlock( &( q->mtx ) );
+
+   return n;
+}
+
+
+//
+// Function to drop a queue (the items belong to the user)
+//
+
+void inQueueFree( struct in_queue_s *q )
+{
+   if( q->ring != NULL ) free( q->ring );
+   pthread_mutex_destroy( &( q->mtx ) );
+   pthread_cond_destroy( &( q->cv_put ) );
+   pthread_cond_destroy( &( q->cv_get ) );
+   memset( q, 0, sizeof(struct in_queue_s) );
+}
+
+
+//
+// Function to set up a place for events with room for "max_keys" pending
+// invalidations
+//
+
+int inEventsInit( struct in_events_s *e, int max_keys )
+{
+   memset( e, 0, sizeof(struct in_events_s) );
+   e->keys = (long*) malloc( ((size_t) max_keys)*sizeof(long) );
+   if( e->keys == NULL ) {
+      fprintf( stdout, " [Threads]  Could not allocate events \n" );
+      return 1;
+   }
+   e->max_keys = max_keys;
+
+   pthread_mutex_init( &( e->mtx ), NULL );
+   pthread_cond_init( &( e->cv ), NULL );
+
+   return 0;
+}
+
+
+//
+// Function to post event bits (from any thread)
+//
+
+void inEventsPost( struct in_events_s *e, unsigned int flags )
+{
+   pthread_mutex_lock( &( e->mtx ) );
+   e->num_posted += 1;
+   if( ( e->flags & flags ) == flags ) {
+      e->num_dropped += 1;
+   } else {
+      e->flags |= flags;
+      pthread_cond_signal( &( e->cv ) );
+   }
+   pthread_mutex_unlock( &( e->mtx ) );
+}
+
+
+//
+// Function to post an invalidation of something by its key (from any thread)
+//
+
+void inEventsInvalidate( struct in_events_s *e, long key )
+{
+   pthread_mutex_lock( &( e->mtx ) );
+   e->num_posted += 1;
+
+   int idup = ( e->flags & IN_EVENT_OVERFLOW ) ? 1 : 0;
+   for(int n=0;n<e->num_keys && !idup;++n) {
+      if( e->keys[n] == key ) idup = 1;
+   }
+   if( idup ) {
+      e->num_dropped += 1;
+   } else {
+      if( e->num_keys < e->max_keys ) {
+         e->keys[ e->num_keys++ ] = key;
+      } else {
+         e->num_keys = 0;
+         e->flags |= IN_EVENT_OVERFLOW;
+      }
+      pthread_cond_signal( &( e->cv ) );
+   }
+   pthread_mutex_unlock( &( e->mtx ) );
+}
+
+
+//
+// Function to wait until something was posted, or for at most "msec"
+// milliseconds (forever if negative); the pending bits and keys are taken
+// (keys that do not fit stay pending) and the number of keys is returned
+//
+
+int inEventsWait( struct in_events_s *e, long msec,
+                  unsigned int *flags, long *keys, int max_keys )
+{
+   struct timespec ts;
+   if( msec >= 0 ) {
+      clock_gettime( CLOCK_REALTIME, &ts );
+      ts.tv_sec += msec / 1000;
+      ts.tv_nsec += (msec % 1000) * 1000000;
+      if( ts.tv_nsec >= 1000000000 ) {
+         ts.tv_sec += 1;
+         ts.tv_nsec -= 1000000000;
+      }
+   }
+
+   pthread_mutex_lock( &( e->mtx ) );
+   while( e->flags == 0 && e->num_keys == 0 ) {
+      if( msec < 0 ) {
+         pthread_cond_wait( &( e->cv ), &( e->mtx ) );
+      } else {
+         if( pthread_cond_timedwait( &( e->cv ), &( e->mtx ), &ts ) ==
+             ETIMEDOUT ) break;
+      }
+   }
+
+   *flags = e->flags;
+   e->flags = 0;
+   int n = e->num_keys < max_keys ? e->num_keys : max_keys;
+   memcpy( keys, e->keys, ((size_t) n)*sizeof(long) );
+   memmove( e->keys, &( e->keys[n] ), ((size_t) (e->num_keys-n))*sizeof(long) );
+   e->num_keys -= n;
+   if( *flags != 0 || n > 0 ) e->num_wakes += 1;
+   pthread_mutex_unlock( &( e->mtx ) );
+
+   return n;
+}
+
+
+//
+// Function to drop the place for events
+//
+
+void inEventsFree( struct in_events_s *e )
+{
+   if( e->keys != NULL ) free( e->keys );
+   pthread_mutex_destroy( &( e->mtx ) );
+   pthread_cond_destroy( &( e->cv ) );
+   memset( e, 0, sizeof(struct in_events_s) );
+}
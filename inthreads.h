@@ -0,0 +1,148 @@
+#ifndef _INTHREADS_H_
+#define _INTHREADS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <pthread.h>
+
+//
+// A triple buffer to hand data from one producer thread to one consumer
+// thread without locks. The producer always has a slot to write into and the
+// consumer always gets the newest complete slot; nothing ever blocks. The
+// middle slot index and a "new data" bit are packed in one word that is
+// swapped atomically; the other two indices are private to each side.
+//
+#define IN_TRIPLE_NEW   0x04
+
+struct in_triple_s {
+   void *slot[3];            // the three buffers (owned by the user)
+   unsigned int middle;      // middle slot and "new" bit (accessed atomically)
+   int write;                // slot of the producer
+   int read;                 // slot of the consumer
+};
+
+
+//
+// A pool of worker threads for CPU jobs (geometry, etc.) with work-stealing.
+// Each worker has its own deque; it runs its own tasks newest-first and takes
+// the oldest tasks of the others when it runs dry. Tasks submitted from
+// outside the pool are spread over the deques; tasks submitted from inside a
+// task go to the deque of the worker that runs it. A thread that waits for
+// the pool to drain runs tasks too. Nothing here touches OpenGL; GL objects
+// stay with the thread that owns the context.
+//
+struct in_task_s {
+   void (*func)( void *arg );
+   void *arg;
+};
+
+struct in_deque_s {
+   pthread_mutex_t mtx;
+   struct in_task_s *ring;   // circular array of tasks
+   int size;                 // capacity (a power of two)
+   long top, bottom;         // thieves take from the top, the owner the bottom
+};
+
+struct in_pool_s {
+   int num_workers;
+   pthread_t *tid;
+   struct in_deque_s *dq;    // one deque per worker
+   pthread_mutex_t mtx;      // guards sleeping and waking only
+   pthread_cond_t cv_work;   // workers sleep on this when all deques are empty
+   pthread_cond_t cv_done;   // waiters sleep on this until nothing is pending
+   int queued;               // tasks in the deques (accessed atomically)
+   int pending;              // tasks not completed (accessed atomically)
+   int istop;                // set to make the workers exit
+   unsigned int next;        // round-robin deque for outside submissions
+};
+
+
+//
+// A bounded queue of pointers that connects stages of a pipeline; any number
+// of threads put and get. A put blocks while the queue is full (which holds
+// an earlier stage back), and a get can either block or return right away.
+// The high-water mark and the number of puts that found the queue full are
+// kept, to see which stage is the bottleneck.
+//
+struct in_queue_s {
+   pthread_mutex_t mtx;
+   pthread_cond_t cv_put;    // putters sleep on this while it is full
+   pthread_cond_t cv_get;    // getters sleep on this while it is empty
+   void **ring;
+   int size;                 // capacity
+   int head, count;
+   int max_count;            // high-water mark
+   unsigned long num_put;    // items that went through
+   unsigned long num_full;   // puts that had to wait
+};
+
+
+//
+// A place where any thread posts work for a thread that sleeps until there is
+// some: events are bits (their meaning is up to the user) and invalidations
+// are keys (of tiles, groups, etc). Both are coalesced: a bit that is already
+// set and a key that is already pending are dropped, so a burst of the same
+// request wakes the consumer once. When more keys are posted than fit, the
+// keys are dropped and the overflow bit is set instead (meaning "everything").
+//
+#define IN_EVENT_OVERFLOW  0x80000000u
+
+struct in_events_s {
+   pthread_mutex_t mtx;
+   pthread_cond_t cv;
+   unsigned int flags;       // pending event bits
+   long *keys;               // pending invalidations (no duplicates)
+   int num_keys, max_keys;
+   unsigned long num_posted; // posts, and posts dropped as duplicates
+   unsigned long num_dropped;
+   unsigned long num_wakes;  // waits that returned with work
+};
+
+
+//
+// function prototypes
+//
+
+void inTripleInit( struct in_triple_s *t, void *s0, void *s1, void *s2 );
+
+void* inTripleWriteSlot( struct in_triple_s *t );
+
+int inTriplePublish( struct in_triple_s *t );
+
+void* inTripleAcquire( struct in_triple_s *t, int *inew );
+
+int inPoolInit( struct in_pool_s *p, int num_workers );
+
+int inPoolSubmit( struct in_pool_s *p, void (*func)( void *arg ), void *arg );
+
+void inPoolWait( struct in_pool_s *p );
+
+void inPoolFree( struct in_pool_s *p );
+
+int inQueueInit( struct in_queue_s *q, int size );
+
+void inQueuePut( struct in_queue_s *q, void *item );
+
+void* inQueueGet( struct in_queue_s *q, int iblock );
+
+int inQueueDepth( struct in_queue_s *q );
+
+void inQueueFree( struct in_queue_s *q );
+
+int inEventsInit( struct in_events_s *e, int max_keys );
+
+void inEventsPost( struct in_events_s *e, unsigned int flags );
+
+void inEventsInvalidate( struct in_events_s *e, long key );
+
+int inEventsWait( struct in_events_s *e, long msec,
+                  unsigned int *flags, long *keys, int max_keys );
+
+void inEventsFree( struct in_events_s *e );
+
+
+#endif
+
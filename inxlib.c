@@ -354,6 +354,9 @@ int xwindow_setup( struct my_xwin_vars *xvars,
 #ifndef _OLDSTYLE_
    xvars->pbuffer = 0;
    xvars->glxcoff = 0;
+   xvars->num_glxw = 0;
+   xvars->glxw = NULL;
+   xvars->glxwpb = NULL;
 #endif
 
    //
@@ -691,6 +694,9 @@ int xwindow_setup_dualglx( struct my_xwin_vars *xvars,
 #ifndef _OLDSTYLE_
    xvars->pbuffer = 0;
    xvars->glxcoff = 0;
+   xvars->num_glxw = 0;
+   xvars->glxw = NULL;
+   xvars->glxwpb = NULL;
 #endif
 
    //
@@ -791,6 +797,127 @@ int xwindow_setup_offscreen( struct my_xwin_vars *xvars,
 #endif
 
 
+#ifndef _OLDSTYLE_
+/**
+// @details
+//
+// Function to create a pool of OpenGL contexts that share resources with the
+// first (rendering) context, such that worker threads can upload data to the
+// GPU in parallel; each context gets a tiny pbuffer to be made current with,
+// as worker threads never draw to the window
+//
+// @author Ioannis Nompelis <nompelis@nobelware.com>
+*/
+int xwindow_setup_workerglx( struct my_xwin_vars *xvars, int num )
+{
+   int fbw_attr[] ={
+                     GLX_X_RENDERABLE, True,
+                     GLX_DRAWABLE_TYPE, GLX_PBUFFER_BIT,
+                     GLX_RENDER_TYPE, GLX_RGBA_BIT,
+                     GLX_X_VISUAL_TYPE, GLX_TRUE_COLOR,
+                     GLX_RED_SIZE, 8,
+                     GLX_GREEN_SIZE, 8,
+                     GLX_BLUE_SIZE, 8,
+                     GLX_ALPHA_SIZE, 8,
+                     None };   // this line terminates the list
+   int pbuffer_attribs[] = {
+      GLX_PBUFFER_WIDTH, 1,
+      GLX_PBUFFER_HEIGHT, 1,
+      None
+   };
+   // the same kind of context as the rendering context
+   int context_attribs[] = {
+      GLX_CONTEXT_MAJOR_VERSION_ARB, 3,   // Compatibility profile
+      GLX_CONTEXT_MINOR_VERSION_ARB, 0,
+      GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_COMPATIBILITY_PROFILE_BIT_ARB,
+      None
+   };
+
+   if( num < 1 || xvars->glxc == NULL ) return 1;
+
+   typedef GLXContext (*my_func)( Display*, GLXFBConfig, GLXContext,
+                                  Bool, const int* );
+   my_func glXCreateContextAttribsARB = NULL;
+   glXCreateContextAttribsARB = (my_func)
+           glXGetProcAddressARB( (const GLubyte*)"glXCreateContextAttribsARB" );
+   if( glXCreateContextAttribsARB == NULL ) {
+      fprintf( stderr, " [Error]  No glXCreateContextAttribsARB() \n" );
+      return 2;
+   }
+
+   int fbcount;
+   GLXFBConfig *fbconfig = glXChooseFBConfig( xvars->xdisplay, xvars->xscreen,
+                                              fbw_attr, &fbcount );
+   if( !fbconfig ) {
+      fprintf( stderr, " [Error]  Failed to retrieve a framebuffer config\n" );
+      return 3;
+   }
+
+   xvars->glxw = (GLXContext*) malloc( ((size_t) num)*sizeof(GLXContext) );
+   xvars->glxwpb = (GLXPbuffer*) malloc( ((size_t) num)*sizeof(GLXPbuffer) );
+   if( xvars->glxw == NULL || xvars->glxwpb == NULL ) {
+      fprintf( stderr, " [Error]  Could not allocate worker contexts \n" );
+      if( xvars->glxw != NULL ) free( xvars->glxw );
+      if( xvars->glxwpb != NULL ) free( xvars->glxwpb );
+      xvars->glxw = NULL;
+      xvars->glxwpb = NULL;
+      XFree( fbconfig );
+      return 4;
+   }
+
+   // (as many as can be made are kept)
+   int n;
+   for(n=0;n<num;++n) {
+      xvars->glxwpb[n] = glXCreatePbuffer( xvars->xdisplay, fbconfig[0],
+                                           pbuffer_attribs );
+      if( !(xvars->glxwpb[n]) ) break;
+      xvars->glxw[n] = glXCreateContextAttribsARB( xvars->xdisplay,
+                                                   fbconfig[0], xvars->glxc,
+                                                   True, context_attribs );
+      if( xvars->glxw[n] == NULL ) {
+         glXDestroyPbuffer( xvars->xdisplay, xvars->glxwpb[n] );
+         break;
+      }
+   }
+   xvars->num_glxw = n;
+   XFree( fbconfig );
+
+   fprintf( stderr, " [INFO]  Created %d of %d worker GLX contexts \n", n, num );
+   if( n == 0 ) {
+      free( xvars->glxw );
+      free( xvars->glxwpb );
+      xvars->glxw = NULL;
+      xvars->glxwpb = NULL;
+      return 5;
+   }
+
+   return 0;
+}
+
+/**
+// @details
+//
+// Function to make a worker context current in the calling thread; a negative
+// index releases the thread's current context
+//
+// @author Ioannis Nompelis <nompelis@nobelware.com>
+*/
+int xwindow_bind_workerglx( struct my_xwin_vars *xvars, int k )
+{
+   Bool ir;
+   if( k < 0 ) {
+      ir = glXMakeContextCurrent( xvars->xdisplay, None, None, NULL );
+   } else {
+      if( k >= xvars->num_glxw ) return 1;
+      ir = glXMakeContextCurrent( xvars->xdisplay, xvars->glxwpb[k],
+                                  xvars->glxwpb[k], xvars->glxw[k] );
+   }
+
+   return ( ir == True ) ? 0 : 2;
+}
+#endif
+
+
 void xwindow_query_glxversion( struct my_xwin_vars *xvars )
 {
    int glxMajor, glxMinor;
@@ -820,6 +947,23 @@ int xwindow_close( struct my_xwin_vars *xvars )
       glXDestroyContext( xvars->xdisplay, xvars->glxcoff );
       fprintf( stderr, " [INFO]  Released Pbuffer and its GLX context \n" );
    }
+
+   //
+   // Destroy the worker contexts (their threads must be done with them)
+   //
+   for(int n=0;n<xvars->num_glxw;++n) {
+      glXDestroyContext( xvars->xdisplay, xvars->glxw[n] );
+      glXDestroyPbuffer( xvars->xdisplay, xvars->glxwpb[n] );
+   }
+   if( xvars->num_glxw > 0 ) {
+      free( xvars->glxw );
+      free( xvars->glxwpb );
+      fprintf( stderr, " [INFO]  Released %d worker GLX contexts \n",
+               xvars->num_glxw );
+   }
+   xvars->num_glxw = 0;
+   xvars->glxw = NULL;
+   xvars->glxwpb = NULL;
 #endif
 
    //
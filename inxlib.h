@@ -43,6 +43,9 @@ struct my_xwin_vars {
    GLXPbuffer pbuffer;
    GLXContext glxcoff;
    unsigned int pb_width, pb_height;
+   int num_glxw;              // worker contexts that share with the first
+   GLXContext *glxw;
+   GLXPbuffer *glxwpb;        // (their drawables)
 #endif
 
    char window_name[100];
@@ -118,6 +121,20 @@ int xwindow_setup_dualglx( struct my_xwin_vars *xvars,
 */
 int xwindow_setup_offscreen( struct my_xwin_vars *xvars,
                              unsigned int width, unsigned int height );
+
+/**
+// @brief
+// A function to create a number of GLX OpenGL contexts that share resources
+// with the first context, for worker threads (each has a small pbuffer)
+*/
+int xwindow_setup_workerglx( struct my_xwin_vars *xvars, int num );
+
+/**
+// @brief
+// A function to make one of the worker contexts current in the calling thread
+// (or to release the thread's context with a negative index)
+*/
+int xwindow_bind_workerglx( struct my_xwin_vars *xvars, int k );
 #endif
 
 void xwindow_query_glxversion( struct my_xwin_vars *xvars );
@@ -137,6 +137,16 @@ int user_keypress( struct my_xwin_vars *xvars, XEvent *event )
    (void) ingl_events_handle_keypress( xvars, (void *) event );
 #endif
 
+#ifdef _CASE3_
+   // the tiles are made again: "r" for all resident ones, "t" for the one
+   // under the viewer
+   KeySym ikey = XLookupKeysym( &( event->xkey ), 0 );
+   if( ikey == XK_r ) invalidateTiles( &payload );
+   if( ikey == XK_t ) invalidateTile( &payload,
+                                      (int) floor( payload.view_last[0] ),
+                                      (int) floor( payload.view_last[1] ) );
+#endif
+
    return 0;
 }
 
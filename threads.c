@@ -1,143 +1,234 @@
 
+//
+// functions to pack the coordinates of a tile into one key (for invalidations)
+// and to unpack them
+//
+
+long tileKey( int tx, int ty )
+{
+   return (long) ( ( ((unsigned long) (unsigned int) tx) << 32 ) |
+                   ((unsigned long) (unsigned int) ty) );
+}
+
+int tileKeyX( long key )
+{
+   return (int) (unsigned int) ( ((unsigned long) key) >> 32 );
+}
+
+int tileKeyY( long key )
+{
+   return (int) (unsigned int) ( ((unsigned long) key) & 0xffffffffu );
+}
+
+
+//
+// function to return the bounding box and sphere of a tile given its tile
+// coordinates; tile (tx,ty) spans [tx,tx+1] x [ty,ty+1]
+// (The height of the surface is bounded by its amplitude; see below.)
+//
+
+void tileBounds( int tx, int ty, GLfloat *bmin, GLfloat *bmax, GLfloat *bsph )
+{
+   float xr = (float) tx, yr = (float) ty;
+
+   bmin[0] = xr;       bmin[1] = yr;       bmin[2] = -0.1;
+   bmax[0] = xr + 1.0; bmax[1] = yr + 1.0; bmax[2] = +0.1;
+   for(int i=0;i<3;++i) bsph[i] = 0.5 * (bmin[i] + bmax[i]);
+   bsph[3] = (float) sqrt( 0.5*0.5 + 0.5*0.5 + 0.1*0.1 );
+}
+
+
+//
+// function to evaluate sin() on four floats at a time; the argument is brought
+// to [-pi,pi] and then folded to [-pi/2,pi/2], where an odd polynomial of the
+// 11th degree is good to a few units of the last place of a float
+//
+
+#ifdef __SSE2__
+static __m128 tileSin4( __m128 x )
+{
+   const __m128 inv2pi = _mm_set1_ps( 0.15915494309f );
+   const __m128 twopi_hi = _mm_set1_ps( 6.28125f );
+   const __m128 twopi_lo = _mm_set1_ps( 0.0019353071795864769f );
+   const __m128 pi = _mm_set1_ps( 3.14159265359f );
+   const __m128 halfpi = _mm_set1_ps( 1.57079632679f );
+
+   // nearest multiple of 2 pi, removed in two parts to keep the bits
+   __m128 k = _mm_cvtepi32_ps( _mm_cvtps_epi32( _mm_mul_ps( x, inv2pi ) ) );
+   x = _mm_sub_ps( x, _mm_mul_ps( k, twopi_hi ) );
+   x = _mm_sub_ps( x, _mm_mul_ps( k, twopi_lo ) );
+
+   // sin(x) = sin(pi - x) for x > pi/2, and sin(-pi - x) for x < -pi/2
+   __m128 hi = _mm_cmpgt_ps( x, halfpi );
+   __m128 lo = _mm_cmplt_ps( x, _mm_sub_ps( _mm_setzero_ps(), halfpi ) );
+   x = _mm_or_ps( _mm_andnot_ps( _mm_or_ps( hi, lo ), x ),
+       _mm_or_ps( _mm_and_ps( hi, _mm_sub_ps( pi, x ) ),
+                  _mm_and_ps( lo, _mm_sub_ps( _mm_sub_ps( _mm_setzero_ps(),
+                                                          pi ), x ) ) ) );
+
+   __m128 x2 = _mm_mul_ps( x, x );
+   __m128 p = _mm_set1_ps( -2.5052108385e-8f );
+   p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 2.7557319224e-6f ) );
+   p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( -1.9841269841e-4f ) );
+   p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 8.3333333333e-3f ) );
+   p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( -1.6666666667e-1f ) );
+   p = _mm_add_ps( _mm_mul_ps( p, x2 ), _mm_set1_ps( 1.0f ) );
+
+   return _mm_mul_ps( p, x );
+}
+#endif
+
+
+//
+// the default height function of the tiles, evaluated along a row of nodes
+// (Any function with this signature can be used instead; it gets the "x"
+// coordinates of "n" nodes on the row at "y" and returns their heights.)
+//
+
+void tileHeightSines( int n, const float *x, float y, float *h )
+{
+   float sy = -0.1f * (float) sin( 5.0*y );
+   int i=0;
+#ifdef __SSE2__
+   const __m128 five = _mm_set1_ps( 5.0f );
+   const __m128 vsy = _mm_set1_ps( sy );
+   for(;i+4<=n;i+=4) {
+      __m128 sx = tileSin4( _mm_mul_ps( five, _mm_loadu_ps( &( x[i] ) ) ) );
+      _mm_storeu_ps( &( h[i] ), _mm_mul_ps( sx, vsy ) );
+   }
+#endif
+   for(;i<n;++i) h[i] = sy * (float) sin( 5.0*x[i] );
+}
+
+
+//
+// function to evaluate the heights of a tile's nodes into a grid (row-major,
+// "im" nodes per row) with the given height function; the nodes of a row are
+// spaced evenly and the last one lands exactly on the next tile
+//
+
+void makeTileHeights( float *h, int im, int jm, int tx, int ty,
+                      tile_height_f hf )
+{
+   float *xn = (float*) malloc( ((size_t) im) * sizeof(float) );
+   if( xn == NULL ) {
+      printf(" [Thread]  Could not allocate tile nodes \n");
+      return;
+   }
+
+   for(int i=0;i<im;++i) xn[i] = ((float) tx) + ((float) i) / ((float) (im-1));
+   for(int j=0;j<jm;++j) {
+      hf( im, xn, ((float) ty) + ((float) j) / ((float) (jm-1)),
+          &( h[j*im] ) );
+   }
+
+   free( xn );
+}
+
+
 //
 // function to absorb all details of creating vertex data
-// (Takes sizes and an index of a tile in order to create the data for the
-// tile that corresponds to this index; this abstracts all implied logic on
-// which tile it is, etc, but keeps the sizing of the object general.)
-//
-
-void makeTileData( GLfloat *vdata, int im, int jm, int idx )
-{
-   const float pi = (float) acos(-1.0);
-   float xr,yr;
-   switch( idx ) {
-    case 0: xr =-1.0;    yr =-1.0; break;
-    case 1: xr = 0.0;    yr =-1.0; break;
-    case 2: xr = 1.0;    yr =-1.0; break;
-    case 3: xr =-1.0;    yr = 0.0; break;
-    case 4: xr = 0.0;    yr = 0.0; break;
-    case 5: xr = 1.0;    yr = 0.0; break;
-    case 6: xr =-1.0;    yr = 1.0; break;
-    case 7: xr = 0.0;    yr = 1.0; break;
-    case 8: xr = 1.0;    yr = 1.0; break;
-   }
-
-   if(1) {
-      float dx = 1.0/((float) (im-1));
-      float dy = 1.0/((float) (jm-1));
-      int nn = 0;
-      for(int j=0;j<jm-1;++j) {
-      for(int i=0;i<im-1;++i) {
-         float x = ((float) i) * dx + xr;
-         float y = ((float) j) * dy + yr;
-
-         vdata[nn+0] = x;
-         vdata[nn+1] = y;
-         vdata[nn+2] = -0.1 * (float) (sin(5.0*x)*sin(5.0*y));
-         vdata[nn+3] = 0.0;
-         vdata[nn+4] = 0.0;
-         vdata[nn+5] = 1.0;
-         vdata[nn+6] = +0.0;
-         vdata[nn+7] = +0.0;
-         vdata[nn+8]  = 0.5;
-         vdata[nn+9]  = 0.5;
-         vdata[nn+10] = 0.8;
-         vdata[nn+11] = 1.0;
-         nn += 12;
-
-         vdata[nn+0] = x + dx;
-         vdata[nn+1] = y;
-         vdata[nn+2] = -0.1 * (float) (sin(5.0*(x+dx))*sin(5.0*y));
-         vdata[nn+3] = 0.0;
-         vdata[nn+4] = 0.0;
-         vdata[nn+5] = 1.0;
-         vdata[nn+6] = +0.0;
-         vdata[nn+7] = +0.0;
-         vdata[nn+8]  = 0.5;
-         vdata[nn+9]  = 0.5;
-         vdata[nn+10] = 0.8;
-         vdata[nn+11] = 1.0;
-         nn += 12;
-
-         vdata[nn+0] = x;
-         vdata[nn+1] = y + dy;
-         vdata[nn+2] = -0.1 * (float) (sin(5.0*x)*sin(5.0*(y+dy)));
-         vdata[nn+3] = 0.0;
-         vdata[nn+4] = 0.0;
-         vdata[nn+5] = 1.0;
-         vdata[nn+6] = +0.0;
-         vdata[nn+7] = +0.0;
-         vdata[nn+8]  = 0.5;
-         vdata[nn+9]  = 0.5;
-         vdata[nn+10] = 0.8;
-         vdata[nn+11] = 1.0;
-         nn += 12;
-
-         vdata[nn+0] = x;
-         vdata[nn+1] = y + dy;
-         vdata[nn+2] = -0.1 * (float) (sin(5.0*x)*sin(5.0*(y+dy)));
-         vdata[nn+3] = 0.0;
-         vdata[nn+4] = 0.0;
-         vdata[nn+5] = 1.0;
-         vdata[nn+6] = +0.0;
-         vdata[nn+7] = +0.0;
-         vdata[nn+8]  = 0.5;
-         vdata[nn+9]  = 0.5;
-         vdata[nn+10] = 0.8;
-         vdata[nn+11] = 1.0;
-         nn += 12;
-
-         vdata[nn+0] = x + dx;
-         vdata[nn+1] = y;
-         vdata[nn+2] = -0.1 * (float) (sin(5.0*(x+dx))*sin(5.0*y));
-         vdata[nn+3] = 0.0;
-         vdata[nn+4] = 0.0;
-         vdata[nn+5] = 1.0;
-         vdata[nn+6] = +0.0;
-         vdata[nn+7] = +0.0;
-         vdata[nn+8]  = 0.5;
-         vdata[nn+9]  = 0.5;
-         vdata[nn+10] = 0.8;
-         vdata[nn+11] = 1.0;
-         nn += 12;
-
-         vdata[nn+0] = x + dx;
-         vdata[nn+1] = y + dy;
-         vdata[nn+2] = -0.1 * (float) (sin(5.0*(x+dx))*sin(5.0*(y+dy)));
-         vdata[nn+3] = 0.0;
-         vdata[nn+4] = 0.0;
-         vdata[nn+5] = 1.0;
-         vdata[nn+6] = +0.0;
-         vdata[nn+7] = +0.0;
-         vdata[nn+8]  = 0.5;
-         vdata[nn+9]  = 0.5;
-         vdata[nn+10] = 0.8;
-         vdata[nn+11] = 1.0;
-         nn += 12;
+// (Takes sizes and the coordinates of a tile in order to create the data for
+// the tile; the surface is continuous across tiles, and the sizing of the
+// object is kept general.)
+// The heights are evaluated once per node into a grid, row by row, with the
+// given height function, and then the six vertices of every quad are
+// scattered from the grid; only position varies between vertices, so the
+// rest of each vertex is stored from a constant template.
+//
 
-      }}
+void makeTileData( GLfloat *vdata, int im, int jm, int tx, int ty,
+                   tile_height_f hf )
+{
+   float xr = (float) tx, yr = (float) ty;
+   float *xn = (float*) malloc( ((size_t) (im + jm + im*jm)) * sizeof(float) );
+   if( xn == NULL ) {
+      printf(" [Thread]  Could not allocate tile height grid \n");
+      return;
    }
+   float *yn = &( xn[im] );
+   float *h = &( yn[jm] );
+
+   // nodes and heights; the last node of a row lands exactly on the next tile
+   for(int i=0;i<im;++i) xn[i] = xr + ((float) i) / ((float) (im-1));
+   for(int j=0;j<jm;++j) yn[j] = yr + ((float) j) / ((float) (jm-1));
+   makeTileHeights( h, im, jm, tx, ty, hf );
+
+   // the corners of the two triangles of a quad, as offsets (i,j)
+   const int ci[6] = { 0, 1, 0, 0, 1, 1 };
+   const int cj[6] = { 0, 0, 1, 1, 0, 1 };
+
+   GLfloat* v = vdata;
+#ifdef __SSE2__
+   const __m128 t1 = _mm_setr_ps( 0.0f, 1.0f, 0.0f, 0.0f );  // floats 4-7
+   const __m128 t2 = _mm_setr_ps( 0.5f, 0.5f, 0.8f, 1.0f );  // floats 8-11
+   for(int j=0;j<jm-1;++j) {
+   for(int i=0;i<im-1;++i) {
+      for(int m=0;m<6;++m) {
+         int ii = i + ci[m], jj = j + cj[m];
+         // floats 0-3: position and the x of the normal (zero)
+         _mm_storeu_ps( &( v[0] ),
+                        _mm_setr_ps( xn[ii], yn[jj], h[jj*im+ii], 0.0f ) );
+         _mm_storeu_ps( &( v[4] ), t1 );
+         _mm_storeu_ps( &( v[8] ), t2 );
+         v += 12;
+      }
+   }}
+#else
+   const GLfloat tv[12] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+                            0.0f, 0.0f, 0.5f, 0.5f, 0.8f, 1.0f };
+   for(int j=0;j<jm-1;++j) {
+   for(int i=0;i<im-1;++i) {
+      for(int m=0;m<6;++m) {
+         int ii = i + ci[m], jj = j + cj[m];
+         memcpy( v, tv, 12*sizeof(GLfloat) );
+         v[0] = xn[ii];
+         v[1] = yn[jj];
+         v[2] = h[jj*im+ii];
+         v += 12;
+      }
+   }}
+#endif
+
+   free( xn );
 }
 
 
 //
-// function to run through OpenGL operations for building a new VBO
-// (This function should simply push data to the graphics context --and to
-// the underlying rendering hardware-- and return a handle for the VBO.)
+// function to create the data of all levels of detail of a tile back-to-back
+// (Level "l" has half the intervals of level "l-1" in each direction; the
+// offsets and counts of vertices of the levels are returned in arrays.)
 //
 
-void makeVBO( GLuint *vbo, int vertex_count, float* data )
+int makeTileLods( GLfloat *vdata, int im, int jm, int tx, int ty,
+                  tile_height_f hf, int nlod, int *first, int *count )
 {
-   size_t isize = 12*((size_t) vertex_count)*sizeof(GLfloat);
+   int nn = 0;
+   for(int l=0;l<nlod;++l) {
+      int iml = ((im-1) >> l) + 1;
+      int jml = ((jm-1) >> l) + 1;
+      first[l] = nn;
+      count[l] = 3 * 2 * (iml-1) * (jml-1);
+      if( vdata != NULL ) makeTileData( &( vdata[12*nn] ), iml, jml,
+                                        tx, ty, hf );
+      nn += count[l];
+   }
 
-   glGenBuffers( 1, vbo );
-   glBindBuffer( GL_ARRAY_BUFFER, *vbo );
-// glBufferData( GL_ARRAY_BUFFER, isize, data, GL_DYNAMIC_DRAW );
-   glBufferData( GL_ARRAY_BUFFER, isize, data, GL_STATIC_DRAW );
-   /// My attempt to completely flush data movement. Make this thread sit here
-   /// until the VBO operations in the GPU have completed. If I were to send
-   /// this to the rendering thread to properly fence, it would block, and thus
-   /// I am accepting that it can glitch. Waiting here
+   return nn;   // the total number of vertices
+}
+
+
+//
+// function to make the calling thread wait until the GL commands it issued
+// (uploads) have completed
+// (My attempt to completely flush data movement. Make this thread sit here
+// until the VBO operations in the GPU have completed. If I were to send this
+// to the rendering thread to properly fence, it would block, and thus I am
+// accepting that it can glitch.)
+//
+
+void waitUpload( void )
+{
    /// Rendering thread still glitches...
    GLsync syncObj = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
    GLenum unum = glClientWaitSync( syncObj,
@@ -156,6 +247,25 @@ void makeVBO( GLuint *vbo, int vertex_count, float* data )
       fprintf( stdout, " [Thread]  Fence: \"Wait failed\"\n" );
     break;
    };
+   glDeleteSync( syncObj );
+}
+
+
+//
+// function to run through OpenGL operations for building a new VBO
+// (This function should simply push data to the graphics context --and to
+// the underlying rendering hardware-- and return a handle for the VBO.)
+//
+
+void makeVBO( GLuint *vbo, int vertex_count, float* data )
+{
+   size_t isize = 12*((size_t) vertex_count)*sizeof(GLfloat);
+
+   glGenBuffers( 1, vbo );
+   glBindBuffer( GL_ARRAY_BUFFER, *vbo );
+// glBufferData( GL_ARRAY_BUFFER, isize, data, GL_DYNAMIC_DRAW );
+   glBufferData( GL_ARRAY_BUFFER, isize, data, GL_STATIC_DRAW );
+   waitUpload();
 
    glBindBuffer( GL_ARRAY_BUFFER, 0 );
   printf("Made (new) VBO handle: %d \n", *vbo );//HACK
@@ -197,70 +307,653 @@ void makeVAO( GLuint *vao, GLuint vbo )
 }
 
 
+//
+// function to build the grid that all heightfield tiles are drawn with; its
+// vertices are only the (i,j) indices of nodes of the finest level, and the
+// levels of detail are placed back-to-back (as in "makeTileLods()") and use
+// every 2^l-th node (the last one is clamped to the edge of the tile);
+// returns 1 if it could not be made
+//
+
+int makeNodeVAO( GLuint *vao, GLuint *vbo, int im, int jm, int nlod,
+                 const int *first, const int *count )
+{
+   const int ci[6] = { 0, 1, 0, 0, 1, 1 };
+   const int cj[6] = { 0, 0, 1, 1, 0, 1 };
+   size_t isize = (size_t) ( first[nlod-1] + count[nlod-1] );
+   GLshort* ndata = (GLshort*) malloc( 2*isize*sizeof(GLshort) );
+   if( ndata == NULL ) {
+      printf(" [Thread]  Could not allocate heightfield grid \n");
+      return 1;
+   }
+
+   for(int l=0;l<nlod;++l) {
+      int iml = ((im-1) >> l) + 1;
+      int jml = ((jm-1) >> l) + 1;
+      GLshort* v = &( ndata[ 2*first[l] ] );
+      for(int j=0;j<jml-1;++j) {
+      for(int i=0;i<iml-1;++i) {
+         for(int m=0;m<6;++m) {
+            int ii = (i + ci[m]) << l, jj = (j + cj[m]) << l;
+            if( i+ci[m] == iml-1 ) ii = im-1;
+            if( j+cj[m] == jml-1 ) jj = jm-1;
+            v[0] = (GLshort) ii;
+            v[1] = (GLshort) jj;
+            v += 2;
+         }
+      }}
+   }
+
+   glGenBuffers( 1, vbo );
+   glBindBuffer( GL_ARRAY_BUFFER, *vbo );
+   glBufferData( GL_ARRAY_BUFFER, (GLsizeiptr) (2*isize*sizeof(GLshort)),
+                 ndata, GL_STATIC_DRAW );
+   free( ndata );
+
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+   // (its attributes are set once the program is made; see below)
+   glGenVertexArrays( 1, vao );
+
+   return 0;
+}
+
+
+//
+// function to point the attributes of the heightfield program at the shared
+// grid (the node of each vertex) and at the tiles that are drawn: one tile
+// per instance from a buffer, or one set for each draw when the GL cannot
+// step an attribute per instance
+//
+
+int setNodeAttribs( struct my_payload* p, GLuint program )
+{
+   GLint posLoc = glGetAttribLocation( program, "inPosition" );
+   p->grid_infoLoc = glGetAttribLocation( program, "tileInfo" );
+   if( posLoc < 0 || p->grid_infoLoc < 0 ) {
+      printf(" [Thread]  No attributes in the heightfield program \n");
+      return 1;
+   }
+
+   glBindVertexArray( p->grid_VAO );
+   glBindBuffer( GL_ARRAY_BUFFER, p->grid_nodeVBO );
+   glVertexAttribPointer( (GLuint) posLoc, 2, GL_SHORT, GL_FALSE,
+                          2 * sizeof(GLshort), (void*)0 );
+   glEnableVertexAttribArray( (GLuint) posLoc );
+   if( p->ogl.hasInstancedArrays ) {
+      glGenBuffers( 1, &( p->grid_infoVBO ) );
+      glBindBuffer( GL_ARRAY_BUFFER, p->grid_infoVBO );
+      glBufferData( GL_ARRAY_BUFFER,
+                    (GLsizeiptr) (3*((size_t) p->grid_pages)*sizeof(GLint)),
+                    NULL, GL_STREAM_DRAW );
+      glVertexAttribIPointer( (GLuint) p->grid_infoLoc, 3, GL_INT,
+                              3 * sizeof(GLint), (void*)0 );
+      glVertexAttribDivisor( (GLuint) p->grid_infoLoc, 1 );
+      glEnableVertexAttribArray( (GLuint) p->grid_infoLoc );
+   }
+   glBindVertexArray(0);
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+   return 0;
+}
+
+
+//
+// function to draw the heightfield tiles that were picked in a frame ("nlev"
+// of them at each level): they are sorted by level and each level of the grid
+// is drawn once, instanced for its tiles (the VAO of the grid is bound)
+//
+
+void drawHeightTiles( struct my_payload* p, const int *nlev )
+{
+   int base[INOGL_MAX_LOD], next[INOGL_MAX_LOD], nt = 0;
+   for(int l=0;l<p->grid_nlod;++l) {
+      base[l] = next[l] = nt;
+      nt += nlev[l];
+   }
+   if( nt == 0 || p->grid_infoLoc < 0 ) return;
+
+   for(int n=0;n<p->grid_pages;++n) {
+      int l = p->grid_tlod[n];
+      if( l < 0 ) continue;
+      int ir = p->draw_rgn[n];
+      GLint* v = &( p->grid_info[ 3*next[l]++ ] );
+      v[0] = p->grid_rtx[ir];
+      v[1] = p->grid_rty[ir];
+      v[2] = ir;
+   }
+
+   GLuint loc = (GLuint) p->grid_infoLoc;
+   if( !p->ogl.hasInstancedArrays ) {
+      for(int l=0;l<p->grid_nlod;++l) {
+         for(int k=base[l];k<base[l]+nlev[l];++k) {
+            const GLint* v = &( p->grid_info[3*k] );
+            glVertexAttribI3i( loc, v[0], v[1], v[2] );
+            glDrawArrays( GL_TRIANGLES, p->grid_lod_first[l],
+                          p->grid_lod_count[l] );
+         }
+      }
+      return;
+   }
+
+   // the buffer is orphaned, such that the draws of the last frame are not
+   // waited on
+   GLsizeiptr isize = (GLsizeiptr) (3*((size_t) p->grid_pages)*sizeof(GLint));
+   glBindBuffer( GL_ARRAY_BUFFER, p->grid_infoVBO );
+   glBufferData( GL_ARRAY_BUFFER, isize, NULL, GL_STREAM_DRAW );
+   glBufferSubData( GL_ARRAY_BUFFER, 0,
+                    (GLsizeiptr) (3*((size_t) nt)*sizeof(GLint)),
+                    p->grid_info );
+   for(int l=0;l<p->grid_nlod;++l) {
+      if( nlev[l] == 0 ) continue;
+      glVertexAttribIPointer( loc, 3, GL_INT, 3 * sizeof(GLint),
+                              (void*) (3*((size_t) base[l])*sizeof(GLint)) );
+      glDrawArraysInstanced( GL_TRIANGLES, p->grid_lod_first[l],
+                             p->grid_lod_count[l], nlev[l] );
+   }
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
+//
+// function that recycles a tile's stream region (or heightfield layer) when
+// the frame it was retired in has completed (in either thread); the producer
+// is woken up, as it may be waiting for a region to start a tile
+//
+
+void recycleTile( void* arg, int ir )
+{
+   struct my_payload* p = (struct my_payload*) arg;
+
+   if( p->grid_hfield ) {
+      inoglTexPoolRecycle( (void*) &( p->grid_tex ), ir );
+   } else {
+      inoglStreamRecycle( (void*) &( p->grid_stream ), ir );
+   }
+   inEventsPost( &( p->grid_ev ), GRID_EV_TILE );
+}
+
+
+//
+// function to give a tile's stream region (or heightfield layer) back; the
+// handoff goes first, such that the region is not recycled while its old
+// fence is still around, and the region is retired in the calling thread's
+// context: it is recycled once the frame of that context has completed
+// (either thread may call this, and only for regions the other one never uses)
+//
+
+void releaseTile( struct my_payload* p, int ir, int ctx )
+{
+   if( ir < 0 ) return;
+
+   // an upload that is still in flight (possibly in a worker's context) is
+   // made to precede the end of this context's frame, which recycles it
+   (void) inoglHandoffReady( &( p->grid_hoff[ir] ), 1 );
+   inoglHandoffClear( &( p->grid_hoff[ir] ) );
+   int id = inoglResRegion( &( p->res ), recycleTile, (void*) p, ir );
+   if( id == -1 ) {
+      // (should not happen; the manager has a slot for every region)
+      glFinish();
+      recycleTile( (void*) p, ir );
+      return;
+   }
+   inoglResRetire( &( p->res ), id, ctx );
+}
+
+
+//
+// function that makes a worker's shared context current in an upload thread
+//
+
+int bindUploader( void* arg, int worker )
+{
+   return xwindow_bind_workerglx( (struct my_xwin_vars*) arg, worker );
+}
+
+
+//
+// function to generate one level of detail of one tile (or the heights of a
+// heightfield tile); it runs as a task of the worker pool and only touches
+// the memory it was given (no OpenGL); the last job of a tile hands the tile
+// on to the upload stage
+//
+
+void tileJob( void* arg )
+{
+   struct my_tile_job* j = (struct my_tile_job*) arg;
+   struct my_tile* t = j->t;
+   struct my_payload* p = t->p;
+
+   if( p->grid_hfield ) {
+      makeTileHeights( t->vdata, p->im, p->jm, t->tx, t->ty, p->grid_height );
+   } else {
+      int iml = ((p->im-1) >> j->lod) + 1;
+      int jml = ((p->jm-1) >> j->lod) + 1;
+      makeTileData( &( t->vdata[ 12*p->grid_lod_first[ j->lod ] ] ),
+                    iml, jml, t->tx, t->ty, p->grid_height );
+   }
+
+   if( __atomic_sub_fetch( &( t->njobs ), 1, __ATOMIC_ACQ_REL ) == 0 ) {
+      inQueuePut( &( p->q_made ), (void*) t );
+      inEventsPost( &( p->grid_ev ), GRID_EV_TILE );
+   }
+}
+
+
+//
+// function called by an upload worker once a tile's upload was issued; the
+// tile goes on to be published
+//
+
+void tileUploaded( struct inogl_upload_s* u )
+{
+   struct my_tile* t = (struct my_tile*) u->user;
+   inQueuePut( &( t->p->q_sent ), (void*) t );
+   inEventsPost( &( t->p->grid_ev ), GRID_EV_TILE );
+}
+
+
+//
+// function to request the tiles around the viewer from the pager; tiles with
+// their centre within the radius (in tile units) are wanted
+//
+
+void requestTiles( struct my_payload* p, GLfloat cx, GLfloat cy )
+{
+   struct inogl_pager_s* pg = &( p->pager );
+   GLfloat r = p->grid_radius;
+
+   inoglPagerBegin( pg );
+   for(int ty=(int) floor(cy-r);ty<=(int) floor(cy+r);++ty) {
+   for(int tx=(int) floor(cx-r);tx<=(int) floor(cx+r);++tx) {
+      GLfloat dx = ((GLfloat) tx) + 0.5f - cx;
+      GLfloat dy = ((GLfloat) ty) + 0.5f - cy;
+      GLfloat d = (GLfloat) sqrt( dx*dx + dy*dy );
+      if( d <= r ) inoglPagerRequest( pg, tx, ty, d );
+   }}
+}
+
+
+//
+// function to send a free tile into the pipeline for page "ip": it gets its
+// storage and its generation jobs go to the worker pool; returns 1 if there
+// was no storage for it (the tile is then free again)
+//
+
+int makeTile( struct my_payload* p, struct my_tile* t, int ip, int tx, int ty )
+{
+   p->grid_pseq[ip] += 1;           // tiles in flight for the page are stale
+
+   t->tx = tx;
+   t->ty = ty;
+   t->ipage = ip;
+   t->seq = p->grid_pseq[ip];
+   t->ir = -1;
+   t->up.status = 0;
+   // with a persistent mapping the workers write straight into a region
+   t->vdata = t->scratch;
+   if( !p->grid_hfield && p->grid_stream.map != NULL ) {
+      t->vdata = (GLfloat*) inoglStreamAcquire( &( p->grid_stream ),
+                                                &( t->ir ) );
+   }
+   if( t->vdata == NULL ) {
+      inQueuePut( &( p->q_free ), (void*) t );
+      return 1;
+   }
+
+   // heightfields have one job; vertices have one per level of detail
+   int nl = p->grid_hfield ? 1 : p->grid_nlod;
+   t->njobs = nl;
+   p->stage_gen += 1;
+   for(int l=0;l<nl;++l) {
+      struct my_tile_job* j = &( t->jobs[l] );
+      j->t = t;
+      j->lod = l;
+      inPoolSubmit( &( p->pool ), &tileJob, (void*) j );
+   }
+
+   return 0;
+}
+
+
+//
+// function for the generation stage: invalidated tiles that are resident are
+// made again first (their old data is drawn until the new data lands; those
+// not resident are made anyway once they are wanted), and then the nearest
+// missing tiles get a page of the tile cache (evicting the least-recently
+// wanted tile if needed), as long as there are free tiles to carry them;
+// returns whether a tile was evicted from the scene
+//
+
+int startTiles( struct my_payload* p )
+{
+   struct inogl_pager_s* pg = &( p->pager );
+   struct my_tile* t;
+   int ichg=0, tx, ty;
+
+   while( p->num_inval > 0 ) {
+      long key = p->grid_inval[ p->num_inval-1 ];
+      tx = tileKeyX( key );
+      ty = tileKeyY( key );
+      int ip = inoglPagerFind( pg, tx, ty );
+      if( ip != -1 ) {
+         t = (struct my_tile*) inQueueGet( &( p->q_free ), 0 );
+         if( t == NULL ) return ichg;  // the rest waits for free tiles
+         if( makeTile( p, t, ip, tx, ty ) ) return ichg;
+      }
+      p->num_inval -= 1;
+   }
+
+   while( inoglPagerNext( pg, &tx, &ty ) ) {
+      // (a tile that cannot start now is requested again next time)
+      t = (struct my_tile*) inQueueGet( &( p->q_free ), 0 );
+      if( t == NULL ) break;           // all tiles are in the pipeline
+
+      int ievict;
+      int ip = inoglPagerInsert( pg, tx, ty, &ievict );
+      if( ip == -1 ) {                 // the cache is full of wanted tiles
+         inQueuePut( &( p->q_free ), (void*) t );
+         break;
+      }
+      if( ievict >= 0 ) ichg = 1;      // the evicted tile leaves the scene
+
+      if( makeTile( p, t, ip, tx, ty ) ) {
+         inoglPagerRemove( pg, ip );
+         break;
+      }
+   }
+
+   return ichg;
+}
+
+
+//
+// function for the upload stage of a generated tile: it gets a region (or a
+// layer) and its data is uploaded, by an upload worker for heightfields when
+// there are workers, or else right here through a mapping of the region; the
+// upload is published with a fence and the tile goes on to be published
+//
+
+void sendTile( struct my_payload* p, struct my_tile* t )
+{
+   GLuint name = p->grid_stream.VBO;
+
+   if( p->grid_hfield ) {
+      t->ir = inoglTexPoolAcquire( &( p->grid_tex ) );
+      if( t->ir < 0 ) {
+         printf(" [Thread]  No free texture layer for tile %d,%d \n",
+                t->tx, t->ty );
+         inQueuePut( &( p->q_sent ), (void*) t );
+         return;
+      }
+      name = p->grid_tex.tex;
+
+      if( p->uploader.num_workers > 0 ) {
+         struct inogl_upload_s* u = &( t->up );
+         memset( u, 0, sizeof(struct inogl_upload_s) );
+         u->type = INOGL_UPLOAD_TEXTURE;
+         u->target = GL_TEXTURE_2D_ARRAY;
+         u->name = name;
+         u->zoff = (GLint) t->ir;
+         u->width = p->grid_tex.width;
+         u->height = p->grid_tex.height;
+         u->depth = 1;
+         u->format = p->grid_tex.format;
+         u->dtype = p->grid_tex.type;
+         u->data = (const void*) t->vdata;
+         u->h = &( p->grid_hoff[ t->ir ] );
+         u->region = t->ir;
+         u->done = &tileUploaded;
+         u->user = (void*) t;
+         if( inoglUploadSubmit( &( p->uploader ), u ) == 0 ) return;
+      }
+      inoglTexPoolUpload( &( p->grid_tex ), t->ir, t->vdata );
+   } else {
+      if( t->ir < 0 ) {
+         GLfloat* vdata = (GLfloat*)
+                          inoglStreamAcquire( &( p->grid_stream ), &( t->ir ) );
+         if( vdata == NULL ) {
+            printf(" [Thread]  No free stream region for tile %d,%d \n",
+                   t->tx, t->ty );
+            inQueuePut( &( p->q_sent ), (void*) t );
+            return;
+         }
+         memcpy( vdata, t->vdata, 12*((size_t) p->grid_vertex_total) *
+                                  sizeof(GLfloat) );
+      }
+      inoglStreamCommit( &( p->grid_stream ), t->ir );
+   }
+#ifdef _DEBUG_
+  printf(" ========== FILLING stream region %d for tile %d,%d ======== \n",t->ir,t->tx,t->ty);
+#endif
+
+   // publish with a fence; the renderer checks it before use
+   inoglHandoffPublish( &( p->grid_hoff[ t->ir ] ), name, t->ir );
+   inQueuePut( &( p->q_sent ), (void*) t );
+}
+
+
+//
+// function for the publishing stage of an uploaded tile: it goes into its
+// page, unless the page was given to another tile in the meantime (then its
+// region is released) or it got no region (then the page is dropped and the
+// tile is requested again); returns whether the scene changed
+//
+
+int landTile( struct my_payload* p, struct my_tile* t )
+{
+   struct inogl_pager_s* pg = &( p->pager );
+   struct inogl_page_s* page = &( pg->page[ t->ipage ] );
+   int icur = ( page->used && p->grid_pseq[ t->ipage ] == t->seq );
+
+   if( t->ir < 0 ) {
+      if( icur ) inoglPagerRemove( pg, t->ipage );
+      return 0;
+   }
+
+   if( p->grid_hfield ) {
+      if( t->up.status != 0 ) {
+         printf(" [Thread]  Upload to layer %d failed (%d) \n",
+                t->ir, t->up.status );
+      }
+      inoglTexPoolCommit( &( p->grid_tex ), t->ir );
+   }
+
+   if( !icur ) {
+      releaseTile( p, t->ir, p->res_make );
+      return 0;
+   }
+
+   // the renderer finds where the tile goes through its region
+   p->grid_rtx[ t->ir ] = t->tx;
+   p->grid_rty[ t->ir ] = t->ty;
+   page->region = t->ir;
+
+   return 1;
+}
+
+
+//
+// function to keep track of how many tiles are in each stage of the pipeline
+// (sampled once per call and reported every so often, with the high-water
+// marks of the queues between stages and how often they were full)
+//
+
+void sampleStages( struct my_payload* p )
+{
+   int imade = inQueueDepth( &( p->q_made ) );
+   int isent = inQueueDepth( &( p->q_sent ) );
+   p->stage_sum[0] += (double) ( p->stage_gen - imade );   // generating
+   p->stage_sum[1] += (double) imade;                      // awaiting upload
+   p->stage_sum[2] += (double) ( p->stage_up - isent );    // uploading
+   p->stage_sum[3] += (double) isent;                      // awaiting publish
+   p->stage_samples += 1;
+   if( p->stage_samples < 250 ) return;   // (calls, not time)
+
+   double r = 1.0 / ((double) p->stage_samples);
+   if( p->stage_sum[0] + p->stage_sum[1] + p->stage_sum[2] +
+       p->stage_sum[3] > 0.0 ) {
+      printf(" [Thread]  Tiles in stages (of %d): generating %.2f, "
+             "waiting %.2f, uploading %.2f, waiting %.2f; "
+             "queue peaks %d/%d (full %lu/%lu) \n", GRID_INFLIGHT,
+             p->stage_sum[0]*r, p->stage_sum[1]*r,
+             p->stage_sum[2]*r, p->stage_sum[3]*r,
+             p->q_made.max_count, p->q_sent.max_count,
+             p->q_made.num_full, p->q_sent.num_full );
+   }
+   for(int n=0;n<4;++n) p->stage_sum[n] = 0.0;
+   p->stage_samples = 0;
+}
+
+
 //
 // function to absorb all details of the dynamic scene generation
-// (if this function is called, a swap will happen for the rendering thread)
+// (Every call takes the newest position of the viewer from the renderer and
+// requests the tiles around it. Tiles move through a pipeline of stages that
+// are connected by queues: generation on the worker pool, upload (by upload
+// workers, or by this thread), and publication in a scene descriptor. Each
+// call starts the nearest missing tiles, as long as there are free tiles to
+// carry them, and moves the tiles that finished a stage on to the next one,
+// such that new tiles are generated while others upload and others are
+// published. With a persistent mapping the workers write straight into the
+// stream regions; otherwise they write into the tile's scratch memory that
+// is uploaded later. Heightfield tiles are only heights, which go into a
+// layer of a texture with a single sub-image upload, and the layer plays the
+// part of the region. A new scene descriptor lists the region of every page;
+// the renderer releases the regions of evicted tiles once it stops drawing
+// them. The producer never waits for the renderer: if the last descriptor
+// was replaced before the renderer took it, the regions that only that
+// descriptor referenced were never seen and are released right here.)
 //
 
 void updateScene( struct my_payload* p )
 {
-   // select book-keeping VAO/VBO "name" set to modify
-   // (there is set "0" and set "1", addressed by index "i" on the tiled grid)
-   int ics=0,icd=1;
-   if( p->iuse == 1 ) { ics=1; icd=0; }
-
-   // copy buffer "names" from the set in use to the set that will be used
-   for(int i=0;i<9;++i) {
-      p->grid_VAO[icd][i] = p->grid_VAO[ics][i];
-      p->grid_VBO[icd][i] = p->grid_VBO[ics][i];
-      p->bstat[icd][i]    = p->bstat[ics][i];
-   }
-
-   // this variable keeps track of which tile on the 3x3 grid to generate
-   // (this construct makes this function act as an independent "producer"
-   // in a producer/consumer pattern)
-   static int ik=-1;
-   if( ++ik == 9 ) ik=0;
-   // generates data for the appropriate tile (loads the single array)
-   makeTileData( p->grid_vdata, p->im, p->jm, ik );
-
-  printf("RENDERING: iuse %d  UPDATING: icd %d \n", p->iuse, icd );//HACK
-   // flag the buffer "names" that will be used or deleted
-   for(int k=0;k<9;++k) {
-      if( k == ik ) {               // the chosen tile
-         if( p->bstat[icd][k] == 0 ) {
-  printf(" ========== BUILDING Vertex Buffer Obj %d ======== \n",k);//HACK
-            makeVBO( &( p->grid_VBO[icd][k] ),
-                        p->grid_vertex_count, p->grid_vdata );
-            p->bstat[icd][k] = 1;        // flag for "has new VBO, needs VAO"
-         }
+   struct inogl_pager_s* pg = &( p->pager );
+   struct my_tile* t;
+   int ichg=0;
+
+   sampleStages( p );
+
+   const struct my_view* v = (const struct my_view*)
+                             inTripleAcquire( &( p->view_tb ), NULL );
+   requestTiles( p, v->cx, v->cy );
+
+   // tiles that land are free to carry the next ones right away; this goes
+   // on until no tile moves on
+   int nmoved;
+   do {
+      ichg |= startTiles( p );
+      nmoved = 0;
+
+      while(( t = (struct my_tile*) inQueueGet( &( p->q_made ), 0 ) ) != NULL) {
+         p->stage_gen -= 1;
+         p->stage_up += 1;
+         sendTile( p, t );
+         ++nmoved;
       }
 
-      // all tiles
-      if( p->bstat[icd][k] == 2 ) {      // check if it is being rendered
-  printf(" ========== FLAG TO-DELETE Vertex Buffer Obj %d ======== \n",k);//HACK
-         p->bstat[icd][k] = 4;           // flagged for delection
+      while(( t = (struct my_tile*) inQueueGet( &( p->q_sent ), 0 ) ) != NULL) {
+         p->stage_up -= 1;
+         ichg |= landTile( p, t );
+         inQueuePut( &( p->q_free ), (void*) t );
+         inEventsPost( &( p->grid_ev ), GRID_EV_TILE );   // (a free tile)
+         ++nmoved;
+      }
+   } while( nmoved > 0 );
+
+   if( !ichg ) {                     // the scene is as it was
+      inoglResFrame( &( p->res ), p->res_make );   // (regions may be waiting)
+      return;
+   }
+
+   // fill the free descriptor and hand it over
+   struct my_scene* s = (struct my_scene*) inTripleWriteSlot( &( p->scene_tb ) );
+   for(int n=0;n<p->grid_pages;++n) {
+      s->rgn[n] = pg->page[n].used ? pg->page[n].region : -1;
+   }
+
+   if( inTriplePublish( &( p->scene_tb ) ) ) {
+      // the last descriptor was dropped unseen
+      for(int n=0;n<p->grid_pages;++n) {
+         int jr = p->live_rgn[n];
+         if( jr >= 0 && jr != p->seen_rgn[n] && jr != s->rgn[n] ) {
+#ifdef _DEBUG_
+  printf(" ========== RELEASING unseen stream region %d ======== \n",jr);
+#endif
+            releaseTile( p, jr, p->res_make );
+         }
       }
+   } else {
+      // the last descriptor was taken by the renderer
+      for(int n=0;n<p->grid_pages;++n) p->seen_rgn[n] = p->live_rgn[n];
    }
+   for(int n=0;n<p->grid_pages;++n) p->live_rgn[n] = s->rgn[n];
+
+   // end the producer's frame; uploads are flushed and retired regions whose
+   // frame has completed are recycled
+   inoglResFrame( &( p->res ), p->res_make );
 }
 
 
 //
-// This function is called by the rendering thread when it needs to clean-up
-// the VBOs that or not being rendered; it is supposed to be called right after
-// a scene swap and it is not expected to be expennsive.)
+// functions to ask the producer to make tiles again (from any thread), one
+// tile or all resident tiles; repeated requests are coalesced (the demo asks
+// for them from its keys; see "user_keypress()")
 //
 
-void cleanScene( struct my_payload* p )
+void invalidateTile( struct my_payload* p, int tx, int ty )
+{
+   inEventsInvalidate( &( p->grid_ev ), tileKey( tx, ty ) );
+}
+
+void invalidateTiles( struct my_payload* p )
 {
-   // select arrays to delete; get the blcok of data that was just rendered
-   int iuse = payload.iuse;
+   inEventsPost( &( p->grid_ev ), GRID_EV_ALL );
+}
+
 
-   for(int i=0;i<9;++i) {
-      if( payload.bstat[ iuse ][i] == 8 ) {   // flagged for deletion
-  printf(" ========== DELETING Vertex Buffer Obj %d -> %d ======== \n",i,payload.grid_VBO[ iuse ][i]);//HACK
-         glDeleteBuffers( 1, &(payload.grid_VBO[ iuse ][i]) );
-         payload.bstat[ iuse ][i] = 0;   // flag as "not being rendered"
+//
+// function for the producer to sleep until there is work: a move of the
+// viewer, a tile that finished a stage, a tile or a region that is free
+// again, or invalidated tiles; it only wakes up by itself while regions it
+// retired wait on its fences to be recycled (wanted tiles that have no page
+// wait for the viewer to move, as only that frees pages of wanted tiles)
+// (invalidations of resident tiles are added to those still pending, without
+// duplicates; when they do not fit, all resident tiles are made again, as
+// they are when the events overflow, such that none is lost)
+//
+
+void waitScene( struct my_payload* p )
+{
+   long keys[GRID_MAX_INVAL];
+   unsigned int flags;
+
+   long msec = inoglResPending( &( p->res ), p->res_make ) ? 50 : -1;
+   int nk = inEventsWait( &( p->grid_ev ), msec, &flags, keys, GRID_MAX_INVAL );
+
+   int iall = ( flags & ( GRID_EV_ALL | IN_EVENT_OVERFLOW ) ) != 0;
+   for(int k=0;k<nk && !iall;++k) {
+      // (tiles that are not resident are made anyway once they are wanted)
+      if( inoglPagerFind( &( p->pager ), tileKeyX( keys[k] ),
+                          tileKeyY( keys[k] ) ) == -1 ) continue;
+      int idup=0;
+      for(int n=0;n<p->num_inval && !idup;++n) {
+         if( p->grid_inval[n] == keys[k] ) idup = 1;
+      }
+      if( idup ) continue;
+      if( p->num_inval == p->grid_pages ) {
+         iall = 1;
+      } else {
+         p->grid_inval[ p->num_inval++ ] = keys[k];
+      }
+   }
+
+   if( iall ) {
+      p->num_inval = 0;
+      for(int n=0;n<p->grid_pages;++n) {
+         if( !p->pager.page[n].used ) continue;
+         p->grid_inval[ p->num_inval++ ] = tileKey( p->pager.page[n].tx,
+                                                    p->pager.page[n].ty );
       }
    }
 }
@@ -268,26 +961,18 @@ void cleanScene( struct my_payload* p )
 
 //
 // function to become the thread that keeps generating the scene/graphics
-// (This thread only generates and deletes VBOs, but also sets the flags that
-// the rendering thread uses to generate and delete VAOs.)
+// (This thread only fills regions of the stream buffer and publishes which
+// region each tile uses; the rendering thread draws and releases them.)
 //
 
 void* sceneMakerThread( void* arg )
 {
    struct my_payload* p = (struct my_payload*) arg;
 // struct inogl_s* ogl = (struct inogl_s*) &(p->ogl);
-   fd_set rfds;
-   struct timeval tv;
-   int nfds;
    int istate=1;
 
-   nfds = p->pipefd[0] + 1;     // count of file descriptors to monitor is fixed
-
-   // a long break is needed to initially synchronize (insteading of using a
-   // mutex and confusing the kids)
-   sleep(1);
-
    // make the scene creation OpenGL context current for this thread
+   // (everything it touches was set up before it was spawned)
 // glXMakeCurrent( p->xdisplay, p->xwindow, p->glxc );
    glXMakeContextCurrent( p->xdisplay, p->glxwin, p->glxwin, p->glxc );
 
@@ -296,40 +981,10 @@ void* sceneMakerThread( void* arg )
 
       // state of the scene maker
       if( istate == 1 ) { // maker is doing things it needs to be doing...
-//printf("Scene maker sleeping \n");
-         usleep(700000);
          updateScene( p );
-         istate = 2;
-
-      } else if( istate == 2 ) { // maker must synchronize with renderer
-         // set the common variable to the new rendering set
-         if( payload.iuse == 0 ) { payload.ichg = 1; } 
-                            else { payload.ichg = 0; } 
-         // enter a perpetual sweep to monitor for ack from renderer
-         while( istate == 2 ) {   // allow for exit from loop
-            // adding socket descriptor to the set to monitor with select
-            FD_ZERO( &rfds );
-            FD_SET( p->pipefd[0], &rfds );
-
-            // setting timeout values for select
-            tv.tv_sec = 1;
-            tv.tv_usec = 0;
-
-            int isel = select( nfds, &rfds, NULL, NULL, &tv );
-            if( isel > 0 ) {
-               char buffer[4];
-               isel = (int) read( payload.pipefd[0], buffer, 4 );
-               // ignore outcome; assume what is expected
-
-               // clean buffers not being rendered
-               cleanScene( p );
-
-               // return to the state of generating graphics
-               istate = 1;
-            } else {
-               printf("Miss. (Misses should be rare!) \n");
-            }
-         }
+//printf("Scene maker sleeping \n");
+         waitScene( p );
+
       } else {
          //. potential to do something before exiting
       }
@@ -353,55 +1008,171 @@ void init_threads( void* arg )
    pthread_attr_init( &(payload.tattr) );
 // pthread_mutex_init( &(payload.mtx), NULL );
 
-   // open a (communication) pipe
-// pipe2( payload.pipefd, O_DIRECT | O_NONBLOCK );
-   pipe( payload.pipefd );
-   // state that rendering thread uses
-   payload.iuse = 0;    // initial set to use is "0" (the first one)
-   // state the rendering thread must switch to as dictated by the scene maker
-   payload.ichg = 0;    // make it the same; no change initially
-
    //
    // data for what is to be rendered
    //
-   size_t isize = 3*3;    // grid of tiles
-   // first state arrays
-   payload.grid_VAO[0] = (GLuint*) malloc( isize*sizeof(GLuint) );
-   payload.grid_VAO[1] = (GLuint*) malloc( isize*sizeof(GLuint) );
-   payload.grid_VBO[0] = (GLuint*) malloc( isize*sizeof(GLuint) );
-   payload.grid_VBO[1] = (GLuint*) malloc( isize*sizeof(GLuint) );
-   payload.bstat[0] = (unsigned char*) malloc( isize*sizeof(unsigned char) );
-   payload.bstat[1] = (unsigned char*) malloc( isize*sizeof(unsigned char) );
-   for(size_t n=0;n<isize;++n) {
-      payload.grid_VAO[0][n] = 0;
-      payload.grid_VAO[1][n] = 0;
-      payload.grid_VBO[0][n] = 0;
-      payload.grid_VBO[1][n] = 0;
-      payload.bstat[0][n] = 0;
-      payload.bstat[1][n] = 0;
-   }
    payload.im = 110 *  1;
    payload.jm = 110 *  1;
    payload.grid_vertex_count = 3 * 2 * (payload.im-1) * (payload.jm-1);
-   // array of data for setting up each VBO dynamically
-   isize = (size_t) payload.grid_vertex_count;
-   payload.grid_vdata = (GLfloat*) malloc( 12*isize*sizeof(GLfloat) );
+
+   // levels of detail of the tiles; all are stored in the tile's region
+   payload.grid_nlod = 3;
+   payload.grid_height = &tileHeightSines;
+   size_t isize = (size_t) makeTileLods( NULL, payload.im, payload.jm, 0, 0,
+                                         NULL, payload.grid_nlod,
+                                         payload.grid_lod_first,
+                                         payload.grid_lod_count );
+   payload.grid_vertex_total = (int) isize;
+
+   // heightfield tiles are a layer of heights each, drawn with a shared grid
+   payload.grid_hfield = GRID_HFIELD;
+
+   // the memory budget decides how many tiles can be resident; a region for
+   // every tile in the pipeline and two more are kept for tiles that are
+   // replacing others and for regions that are waiting on their fences
+   size_t rsize = 0;
+   int nregions = 0;
+   if( payload.grid_hfield ) {
+      rsize = ((size_t) (payload.im*payload.jm)) * sizeof(GLfloat);
+      nregions = (int) ( ((size_t) GRID_BUDGET) / rsize );
+      if( nregions > GRID_MAX_LAYERS ) nregions = GRID_MAX_LAYERS;
+      if( nregions < GRID_INFLIGHT + 3 ) nregions = GRID_INFLIGHT + 3;
+      // (the number of layers may be limited by the context; without enough
+      // of them the tiles are made of vertices after all)
+      if( inoglTexPoolInit( &( payload.grid_tex ), GL_R32F,
+                            (GLsizei) payload.im, (GLsizei) payload.jm,
+                            nregions, GL_RED, GL_FLOAT ) != 0 ) {
+         payload.grid_hfield = 0;
+      } else if( payload.grid_tex.num_layers < GRID_INFLIGHT + 3 ) {
+         inoglTexPoolFree( &( payload.grid_tex ) );
+         payload.grid_hfield = 0;
+      } else {
+         nregions = payload.grid_tex.num_layers;
+      }
+      if( !payload.grid_hfield ) {
+         printf(" [Thread]  No texture layers for heightfield tiles \n");
+      }
+   }
+   if( !payload.grid_hfield ) {
+      rsize = 12*isize*sizeof(GLfloat);
+      nregions = (int) ( ((size_t) GRID_BUDGET) / rsize );
+      if( nregions < GRID_INFLIGHT + 3 ) nregions = GRID_INFLIGHT + 3;
+   }
+   payload.grid_pages = nregions - GRID_INFLIGHT - 2;
+   payload.grid_radius = 1.5f;
+   printf(" [Thread]  Tile cache of %d pages in %d regions of %zu bytes \n",
+          payload.grid_pages, nregions, rsize );
+
+   // the pager belongs to the producer; the descriptors list its pages
+   inoglPagerInit( &( payload.pager ), payload.grid_pages );
+   size_t np = (size_t) payload.grid_pages;
+   for(int m=0;m<3;++m) {
+      payload.scene[m].rgn = (int*) malloc( np*sizeof(int) );
+      for(int n=0;n<payload.grid_pages;++n) payload.scene[m].rgn[n] = -1;
+      payload.view[m].cx = 0.5f;
+      payload.view[m].cy = 0.5f;
+   }
+   // the three scene descriptors start out empty; the renderer holds one
+   inTripleInit( &( payload.scene_tb ), (void*) &( payload.scene[0] ),
+                 (void*) &( payload.scene[1] ), (void*) &( payload.scene[2] ) );
+   // the views go the other way; the producer holds one
+   inTripleInit( &( payload.view_tb ), (void*) &( payload.view[0] ),
+                 (void*) &( payload.view[1] ), (void*) &( payload.view[2] ) );
+   payload.live_rgn = (int*) malloc( np*sizeof(int) );
+   payload.seen_rgn = (int*) malloc( np*sizeof(int) );
+   payload.pend_rgn = (int*) malloc( np*sizeof(int) );
+   payload.draw_rgn = (int*) malloc( np*sizeof(int) );
+   payload.grid_lod = (struct inogl_lod_s*)
+                      malloc( np*sizeof(struct inogl_lod_s) );
+   payload.grid_tlod = (int*) malloc( np*sizeof(int) );
+   payload.grid_info = (GLint*) malloc( 3*np*sizeof(GLint) );
+   for(int n=0;n<payload.grid_pages;++n) {
+      payload.live_rgn[n] = -1;
+      payload.seen_rgn[n] = -1;
+      payload.pend_rgn[n] = -1;
+      payload.draw_rgn[n] = -1;
+      payload.grid_tlod[n] = -1;
+      inoglLodInit( &( payload.grid_lod[n] ), payload.grid_nlod, 240.0f, 0.2f );
+   }
+
+   // a stream buffer holding all tiles, and a single VAO to draw all tiles
+   // from it (made in this context), or the grid of the heightfield tiles
+   // (this is done here in the rendering thread's context)
+   if( payload.grid_hfield ) {
+      memset( &( payload.grid_stream ), 0, sizeof(struct inogl_stream_s) );
+      if( makeNodeVAO( &( payload.grid_VAO ), &( payload.grid_nodeVBO ),
+                       payload.im, payload.jm, payload.grid_nlod,
+                       payload.grid_lod_first, payload.grid_lod_count ) ) {
+         exit(1);
+      }
+   } else {
+      memset( &( payload.grid_tex ), 0, sizeof(struct inogl_texpool_s) );
+      if( inoglStreamInit( &( payload.grid_stream ), (GLsizeiptr) rsize,
+                           nregions, &( payload.ogl ) ) != 0 ) {
+         printf(" [Thread]  No stream buffer for the tiles \n");
+         exit(1);
+      }
+      makeVAO( &( payload.grid_VAO ), payload.grid_stream.VBO );
+   }
+   // retired regions wait on the frames of the thread that retired them; the
+   // rendering thread registers first, and the producer second
+   inoglResInit( &( payload.res ), 2*nregions + 16 );
+   payload.res_draw = inoglResContext( &( payload.res ) );
+   payload.res_make = inoglResContext( &( payload.res ) );
+   (void) inoglResAdopt( &( payload.res ), INOGL_RES_VAO, payload.grid_VAO,
+                         payload.res_draw );
+
+   payload.grid_hoff = (struct inogl_handoff_s*)
+             calloc( (size_t) nregions, sizeof(struct inogl_handoff_s) );
+   payload.grid_rtx = (int*) calloc( (size_t) nregions, sizeof(int) );
+   payload.grid_rty = (int*) calloc( (size_t) nregions, sizeof(int) );
+   for(int n=0;n<nregions;++n) {
+      inoglHandoffClear( &( payload.grid_hoff[n] ) );
+   }
+
+   // the workers that generate the tiles (one per core), and the tiles that
+   // move through the stages of the pipeline; without a persistent mapping of
+   // the stream buffer (and for heights) each tile has its own scratch memory
+   inPoolInit( &( payload.pool ), 0 );
+   inQueueInit( &( payload.q_free ), GRID_INFLIGHT );
+   inQueueInit( &( payload.q_made ), GRID_INFLIGHT );
+   inQueueInit( &( payload.q_sent ), GRID_INFLIGHT );
+   for(int n=0;n<GRID_INFLIGHT;++n) {
+      struct my_tile* t = &( payload.grid_tile[n] );
+      memset( t, 0, sizeof(struct my_tile) );
+      t->p = &payload;
+      t->ir = -1;
+      if( payload.grid_hfield || payload.grid_stream.map == NULL ) {
+         t->scratch = (GLfloat*) malloc( rsize );
+      }
+      inQueuePut( &( payload.q_free ), (void*) t );
+   }
+   payload.grid_pseq = (unsigned int*) calloc( np, sizeof(unsigned int) );
+   // the producer sleeps until something is posted here
+   inEventsInit( &( payload.grid_ev ), GRID_MAX_INVAL );
+   payload.grid_inval = (long*) malloc( np*sizeof(long) );
+   payload.num_inval = 0;
+   payload.stage_gen = 0;
+   payload.stage_up = 0;
+   payload.stage_samples = 0;
+   for(int n=0;n<4;++n) payload.stage_sum[n] = 0.0;
 
    // assign the 2nd GLX context access variable(s)
    struct my_xwin_vars* xvars = (struct my_xwin_vars*) arg;
+
+   // contexts of the workers that upload tiles for the producer (without them
+   // the producer uploads in its own context)
+   memset( &( payload.uploader ), 0, sizeof(struct inogl_uploader_s) );
+   if( payload.grid_hfield &&
+       xwindow_setup_workerglx( xvars, GRID_UPLOADERS ) == 0 ) {
+      inoglUploaderInit( &( payload.uploader ), xvars->num_glxw,
+                         &bindUploader, (void*) xvars );
+   }
    payload.xdisplay = xvars->xdisplay;
    payload.xwindow = xvars->xwindow;
    payload.glxwin = xvars->glxwin;
    payload.glxc = xvars->glxc2;
 
-/********** build all VBOs on the rendering thread and keep them *******
-for(int i=0;i<9;++i) {
-   makeTileData( payload.grid_vdata, payload.im, payload.jm, i );
-            makeVBO( &( payload.grid_VBO[0][i] ),
-                        payload.grid_vertex_count, payload.grid_vdata );
-            payload.grid_VBO[1][i] = payload.grid_VBO[0][i];
-} **/
-
    // spawn the scene maker thread
    pthread_create( &(payload.tid), &(payload.tattr),
                    &sceneMakerThread, (void*) &payload );